@@ -214,6 +214,24 @@
         The dispatch args define the number of 'compute workgroups' processed
         by the currently applied compute shader.
 
+    --- draw or dispatch with arguments sourced from a GPU buffer (GL only):
+
+            sg_draw_indirect(sg_buffer buf, int offset)
+            sg_dispatch_indirect(sg_buffer buf, int offset)
+
+        The arguments are read at byte offset 'offset' in 'buf' (which must be
+        a multiple of 4) with the layout of the underlying GL commands:
+
+            draw (non-indexed): uint32_t count, instance_count, first, base_instance
+            draw (indexed):     uint32_t count, instance_count, first_index, base_vertex, base_instance
+            dispatch:           uint32_t num_groups_x, num_groups_y, num_groups_z
+
+        Typically the argument buffer is a storage buffer which is written by
+        a compute shader, the required command barrier is issued automatically.
+        For indexed rendering, the index buffer offset in sg_bindings is ignored,
+        use first_index in the draw arguments instead. On other backends
+        the calls are ignored and an error is logged.
+
     --- finish the current pass with:
 
             sg_end_pass()
@@ -811,6 +829,11 @@
 
         sg_dispatch(int num_groups_x, int num_groups_y, int num_groups_z)
 
+    ...or on the GL backend, call sg_dispatch_indirect() to read the number of
+    workgroups from a buffer which has been written by a previous dispatch:
+
+        sg_dispatch_indirect(sg_buffer buf, int offset)
+
     Also see the following compute-shader samples:
 
         - https://floooh.github.io/sokol-webgpu/instancing-compute-sapp.html
@@ -2156,6 +2179,7 @@ typedef struct sg_features {
     bool compute;                       // storage buffers and compute shaders are supported
     bool msaa_image_bindings;           // if true, multisampled images can be bound as texture resources
     bool separate_buffer_types;         // cannot use the same buffer for vertex and indices (onlu WebGL2)
+    bool compute_subgroups;             // compute shaders can use subgroup arithmetic and ballot ops (GL_KHR_shader_subgroup on GL)
 } sg_features;
 
 /*
@@ -2170,6 +2194,7 @@ typedef struct sg_limits {
     int max_vertex_attrs;           // max number of vertex attributes, clamped to SG_MAX_VERTEX_ATTRIBUTES
     int gl_max_vertex_uniform_components;    // <= GL_MAX_VERTEX_UNIFORM_COMPONENTS (only on GL backends)
     int gl_max_combined_texture_image_units; // <= GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS (only on GL backends)
+    int gl_subgroup_size;                    // GL_SUBGROUP_SIZE_KHR, 0 without GL_KHR_shader_subgroup (only on GL backends)
 } sg_limits;
 
 /*
@@ -4097,6 +4122,7 @@ typedef struct sg_frame_stats {
 #define _SG_LOG_ITEMS \
     _SG_LOGITEM_XMACRO(OK, "Ok") \
     _SG_LOGITEM_XMACRO(MALLOC_FAILED, "memory allocation failed") \
+    _SG_LOGITEM_XMACRO(INDIRECT_NOT_SUPPORTED, "sg_draw_indirect() and sg_dispatch_indirect() are only supported on the GL backend (call ignored)") \
     _SG_LOGITEM_XMACRO(GL_TEXTURE_FORMAT_NOT_SUPPORTED, "pixel format not supported for texture (gl)") \
     _SG_LOGITEM_XMACRO(GL_3D_TEXTURES_NOT_SUPPORTED, "3d textures not supported (gl)") \
     _SG_LOGITEM_XMACRO(GL_ARRAY_TEXTURES_NOT_SUPPORTED, "array textures not supported (gl)") \
@@ -4490,6 +4516,14 @@ typedef struct sg_frame_stats {
     _SG_LOGITEM_XMACRO(VALIDATE_DISPATCH_NUMGROUPSY, "sg_dispatch: num_groups_y must be >=0 and <65536") \
     _SG_LOGITEM_XMACRO(VALIDATE_DISPATCH_NUMGROUPSZ, "sg_dispatch: num_groups_z must be >=0 and <65536") \
     _SG_LOGITEM_XMACRO(VALIDATE_DISPATCH_REQUIRED_BINDINGS_OR_UNIFORMS_MISSING, "sg_dispatch: call to sg_apply_bindings() and/or sg_apply_uniforms() missing after sg_apply_pipeline()") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DRAW_INDIRECT_RENDERPASS_EXPECTED, "sg_draw_indirect: must be called in a render pass") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DRAW_INDIRECT_BUFFER, "sg_draw_indirect: indirect buffer handle is invalid or the buffer is no longer alive") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DRAW_INDIRECT_OFFSET, "sg_draw_indirect: offset must be >= 0 and a multiple of 4") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DRAW_INDIRECT_SIZE, "sg_draw_indirect: draw arguments at offset exceed the buffer size") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DISPATCH_INDIRECT_COMPUTEPASS_EXPECTED, "sg_dispatch_indirect: must be called in a compute pass") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DISPATCH_INDIRECT_BUFFER, "sg_dispatch_indirect: indirect buffer handle is invalid or the buffer is no longer alive") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DISPATCH_INDIRECT_OFFSET, "sg_dispatch_indirect: offset must be >= 0 and a multiple of 4") \
+    _SG_LOGITEM_XMACRO(VALIDATE_DISPATCH_INDIRECT_SIZE, "sg_dispatch_indirect: dispatch arguments at offset exceed the buffer size") \
     _SG_LOGITEM_XMACRO(VALIDATE_UPDATEBUF_USAGE, "sg_update_buffer: cannot update immutable buffer") \
     _SG_LOGITEM_XMACRO(VALIDATE_UPDATEBUF_SIZE, "sg_update_buffer: update size is bigger than buffer size") \
     _SG_LOGITEM_XMACRO(VALIDATE_UPDATEBUF_ONCE, "sg_update_buffer: only one update allowed per buffer and frame") \
@@ -4738,6 +4772,8 @@ SOKOL_GFX_API_DECL void sg_apply_bindings(const sg_bindings* bindings);
 SOKOL_GFX_API_DECL void sg_apply_uniforms(int ub_slot, const sg_range* data);
 SOKOL_GFX_API_DECL void sg_draw(int base_element, int num_elements, int num_instances);
 SOKOL_GFX_API_DECL void sg_dispatch(int num_groups_x, int num_groups_y, int num_groups_z);
+SOKOL_GFX_API_DECL void sg_draw_indirect(sg_buffer buf, int offset);
+SOKOL_GFX_API_DECL void sg_dispatch_indirect(sg_buffer buf, int offset);
 SOKOL_GFX_API_DECL void sg_end_pass(void);
 SOKOL_GFX_API_DECL void sg_commit(void);
 
@@ -5490,6 +5526,9 @@ inline int sg_append_buffer(sg_buffer buf_id, const sg_range& data) { return sg_
         #define GL_ELEMENT_ARRAY_BARRIER_BIT 0x00000002
         #define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
         #define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+        #define GL_COMMAND_BARRIER_BIT 0x00000040
+        #define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+        #define GL_DISPATCH_INDIRECT_BUFFER 0x90EE
         #define GL_MIN 0x8007
         #define GL_MAX 0x8008
         #define GL_WRITE_ONLY 0x88B9
@@ -5508,6 +5547,27 @@ inline int sg_append_buffer(sg_buffer buf_id, const sg_range& data) { return sg_
     #ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
     #define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
     #endif
+    #ifndef GL_SUBGROUP_SIZE_KHR
+    #define GL_SUBGROUP_SIZE_KHR 0x9532
+    #endif
+    #ifndef GL_SUBGROUP_SUPPORTED_STAGES_KHR
+    #define GL_SUBGROUP_SUPPORTED_STAGES_KHR 0x9533
+    #endif
+    #ifndef GL_SUBGROUP_SUPPORTED_FEATURES_KHR
+    #define GL_SUBGROUP_SUPPORTED_FEATURES_KHR 0x9534
+    #endif
+    #ifndef GL_COMPUTE_SHADER_BIT
+    #define GL_COMPUTE_SHADER_BIT 0x00000020
+    #endif
+    #ifndef GL_SUBGROUP_FEATURE_BASIC_BIT_KHR
+    #define GL_SUBGROUP_FEATURE_BASIC_BIT_KHR 0x00000001
+    #endif
+    #ifndef GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR
+    #define GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR 0x00000004
+    #endif
+    #ifndef GL_SUBGROUP_FEATURE_BALLOT_BIT_KHR
+    #define GL_SUBGROUP_FEATURE_BALLOT_BIT_KHR 0x00000008
+    #endif
     #ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
     #define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
     #endif
@@ -5880,7 +5940,8 @@ typedef enum {
     _SG_GL_GPUDIRTY_VERTEXBUFFER = (1<<0),
     _SG_GL_GPUDIRTY_INDEXBUFFER = (1<<1),
     _SG_GL_GPUDIRTY_STORAGEBUFFER = (1<<2),
-    _SG_GL_GPUDIRTY_BUFFER_ALL = _SG_GL_GPUDIRTY_VERTEXBUFFER | _SG_GL_GPUDIRTY_INDEXBUFFER | _SG_GL_GPUDIRTY_STORAGEBUFFER,
+    _SG_GL_GPUDIRTY_INDIRECTBUFFER = (1<<3),
+    _SG_GL_GPUDIRTY_BUFFER_ALL = _SG_GL_GPUDIRTY_VERTEXBUFFER | _SG_GL_GPUDIRTY_INDEXBUFFER | _SG_GL_GPUDIRTY_STORAGEBUFFER | _SG_GL_GPUDIRTY_INDIRECTBUFFER,
 } _sg_gl_gpudirty_t;
 
 typedef struct _sg_buffer_s {
@@ -6033,6 +6094,7 @@ typedef struct {
     GLuint vao;
     _sg_gl_state_cache_t cache;
     bool ext_anisotropic;
+    bool ext_subgroup;
     GLint max_anisotropy;
     sg_store_action color_store_actions[SG_MAX_COLOR_ATTACHMENTS];
     sg_store_action depth_store_action;
@@ -8270,6 +8332,9 @@ _SOKOL_PRIVATE void _sg_dummy_update_image(_sg_image_t* img, const sg_image_data
     _SG_XMACRO(glTexImage2DMultisample,           void, (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLboolean fixedsamplelocations)) \
     _SG_XMACRO(glTexImage3DMultisample,           void, (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLboolean fixedsamplelocations)) \
     _SG_XMACRO(glDispatchCompute,                 void, (GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z)) \
+    _SG_XMACRO(glDispatchComputeIndirect,         void, (GLintptr indirect)) \
+    _SG_XMACRO(glDrawArraysIndirect,              void, (GLenum mode, const void * indirect)) \
+    _SG_XMACRO(glDrawElementsIndirect,            void, (GLenum mode, GLenum type, const void * indirect)) \
     _SG_XMACRO(glMemoryBarrier,                   void, (GLbitfield barriers)) \
     _SG_XMACRO(glBindImageTexture,                void, (GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format)) \
     _SG_XMACRO(glTexStorage2DMultisample,         void, (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLboolean fixedsamplelocations)) \
@@ -9088,6 +9153,8 @@ _SOKOL_PRIVATE void _sg_gl_init_caps_glcore(void) {
                 _sg.gl.ext_anisotropic = true;
             } else if (strstr(ext, "_texture_compression_astc_ldr")) {
                 has_astc = true;
+            } else if (strstr(ext, "_KHR_shader_subgroup")) {
+                _sg.gl.ext_subgroup = true;
             }
         }
     }
@@ -9095,6 +9162,21 @@ _SOKOL_PRIVATE void _sg_gl_init_caps_glcore(void) {
     // limits
     _sg_gl_init_limits();
 
+    // subgroup ops, only reported when compute shaders get at least the
+    // basic, arithmetic and ballot features
+    if (_sg.features.compute && _sg.gl.ext_subgroup) {
+        GLint stages = 0;
+        GLint features = 0;
+        GLint subgroup_size = 0;
+        glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+        glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+        glGetIntegerv(GL_SUBGROUP_SIZE_KHR, &subgroup_size);
+        _SG_GL_CHECK_ERROR();
+        const GLint required = GL_SUBGROUP_FEATURE_BASIC_BIT_KHR | GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR | GL_SUBGROUP_FEATURE_BALLOT_BIT_KHR;
+        _sg.features.compute_subgroups = (0 != (stages & GL_COMPUTE_SHADER_BIT)) && (required == (features & required)) && (subgroup_size > 0);
+        _sg.limits.gl_subgroup_size = subgroup_size;
+    }
+
     // pixel formats
     const bool has_bgra = false;    // not a bug
     const bool has_colorbuffer_float = true;
@@ -11105,6 +11187,52 @@ _SOKOL_PRIVATE void _sg_gl_dispatch(int num_groups_x, int num_groups_y, int num_
     #endif
 }
 
+#if defined(_SOKOL_GL_HAS_COMPUTE)
+// if the indirect arguments have been written by a compute shader,
+// a command barrier must be issued before GL may source them
+_SOKOL_PRIVATE void _sg_gl_bind_indirect_buffer(GLenum target, _sg_buffer_t* buf) {
+    if (buf->gl.gpu_dirty_flags & _SG_GL_GPUDIRTY_INDIRECTBUFFER) {
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        _sg_stats_add(gl.num_memory_barriers, 1);
+        buf->gl.gpu_dirty_flags &= (uint8_t)~_SG_GL_GPUDIRTY_INDIRECTBUFFER;
+    }
+    glBindBuffer(target, buf->gl.buf[buf->cmn.active_slot]);
+}
+#endif
+
+_SOKOL_PRIVATE void _sg_gl_draw_indirect(_sg_buffer_t* buf, int offset) {
+    #if defined(_SOKOL_GL_HAS_COMPUTE)
+    if (!_sg.features.compute) {
+        return;
+    }
+    _sg_gl_bind_indirect_buffer(GL_DRAW_INDIRECT_BUFFER, buf);
+    const GLenum i_type = _sg.gl.cache.cur_index_type;
+    const GLenum p_type = _sg.gl.cache.cur_primitive_type;
+    const GLvoid* indirect = (const GLvoid*)(GLintptr)offset;
+    if (0 != i_type) {
+        glDrawElementsIndirect(p_type, i_type, indirect);
+    } else {
+        glDrawArraysIndirect(p_type, indirect);
+    }
+    _SG_GL_CHECK_ERROR();
+    #else
+    (void)buf; (void)offset;
+    #endif
+}
+
+_SOKOL_PRIVATE void _sg_gl_dispatch_indirect(_sg_buffer_t* buf, int offset) {
+    #if defined(_SOKOL_GL_HAS_COMPUTE)
+    if (!_sg.features.compute) {
+        return;
+    }
+    _sg_gl_bind_indirect_buffer(GL_DISPATCH_INDIRECT_BUFFER, buf);
+    glDispatchComputeIndirect((GLintptr)offset);
+    _SG_GL_CHECK_ERROR();
+    #else
+    (void)buf; (void)offset;
+    #endif
+}
+
 _SOKOL_PRIVATE void _sg_gl_commit(void) {
     // "soft" clear bindings (only those that are actually bound)
     _sg_gl_cache_clear_buffer_bindings(false);
@@ -18159,6 +18287,25 @@ static inline void _sg_dispatch(int num_groups_x, int num_groups_y, int num_grou
     #endif
 }
 
+// indirect draws and dispatches are currently only implemented for GL
+static inline void _sg_draw_indirect(_sg_buffer_t* buf, int offset) {
+    #if defined(_SOKOL_ANY_GL)
+    _sg_gl_draw_indirect(buf, offset);
+    #else
+    _SOKOL_UNUSED(buf); _SOKOL_UNUSED(offset);
+    _SG_ERROR(INDIRECT_NOT_SUPPORTED);
+    #endif
+}
+
+static inline void _sg_dispatch_indirect(_sg_buffer_t* buf, int offset) {
+    #if defined(_SOKOL_ANY_GL)
+    _sg_gl_dispatch_indirect(buf, offset);
+    #else
+    _SOKOL_UNUSED(buf); _SOKOL_UNUSED(offset);
+    _SG_ERROR(INDIRECT_NOT_SUPPORTED);
+    #endif
+}
+
 static inline void _sg_commit(void) {
     #if defined(_SOKOL_ANY_GL)
     _sg_gl_commit();
@@ -19558,11 +19705,55 @@ _SOKOL_PRIVATE bool _sg_validate_dispatch(int num_groups_x, int num_groups_y, in
         _SG_VALIDATE((num_groups_x >= 0) && (num_groups_x < (1<<16)), VALIDATE_DISPATCH_NUMGROUPSX);
         _SG_VALIDATE((num_groups_y >= 0) && (num_groups_y < (1<<16)), VALIDATE_DISPATCH_NUMGROUPSY);
         _SG_VALIDATE((num_groups_z >= 0) && (num_groups_z < (1<<16)), VALIDATE_DISPATCH_NUMGROUPSZ);
+        _SG_VALIDATE(_sg.required_bindings_and_uniforms == _sg.applied_bindings_and_uniforms, VALIDATE_DISPATCH_REQUIRED_BINDINGS_OR_UNIFORMS_MISSING);
+        return _sg_validate_end();
+    #endif
+}
+
+_SOKOL_PRIVATE bool _sg_validate_draw_indirect(const _sg_buffer_t* buf, int offset) {
+    #if !defined(SOKOL_DEBUG)
+        _SOKOL_UNUSED(buf);
+        _SOKOL_UNUSED(offset);
+        return true;
+    #else
+        if (_sg.desc.disable_validation) {
+            return true;
+        }
+        _sg_validate_begin();
+        _SG_VALIDATE(_sg.cur_pass.in_pass && !_sg.cur_pass.is_compute, VALIDATE_DRAW_INDIRECT_RENDERPASS_EXPECTED);
+        _SG_VALIDATE(buf != 0, VALIDATE_DRAW_INDIRECT_BUFFER);
+        _SG_VALIDATE((offset >= 0) && ((offset & 3) == 0), VALIDATE_DRAW_INDIRECT_OFFSET);
+        if (buf && !_sg_pipeline_ref_null(&_sg.cur_pip)) {
+            const bool indexed = _sg_pipeline_ref_ptr(&_sg.cur_pip)->cmn.index_type != SG_INDEXTYPE_NONE;
+            const int args_size = (indexed ? 5 : 4) * (int)sizeof(uint32_t);
+            _SG_VALIDATE((offset + args_size) <= buf->cmn.size, VALIDATE_DRAW_INDIRECT_SIZE);
+        }
         _SG_VALIDATE(_sg.required_bindings_and_uniforms == _sg.applied_bindings_and_uniforms, VALIDATE_DRAW_REQUIRED_BINDINGS_OR_UNIFORMS_MISSING);
         return _sg_validate_end();
     #endif
 }
 
+_SOKOL_PRIVATE bool _sg_validate_dispatch_indirect(const _sg_buffer_t* buf, int offset) {
+    #if !defined(SOKOL_DEBUG)
+        _SOKOL_UNUSED(buf);
+        _SOKOL_UNUSED(offset);
+        return true;
+    #else
+        if (_sg.desc.disable_validation) {
+            return true;
+        }
+        _sg_validate_begin();
+        _SG_VALIDATE(_sg.cur_pass.in_pass && _sg.cur_pass.is_compute, VALIDATE_DISPATCH_INDIRECT_COMPUTEPASS_EXPECTED);
+        _SG_VALIDATE(buf != 0, VALIDATE_DISPATCH_INDIRECT_BUFFER);
+        _SG_VALIDATE((offset >= 0) && ((offset & 3) == 0), VALIDATE_DISPATCH_INDIRECT_OFFSET);
+        if (buf) {
+            _SG_VALIDATE((offset + 3 * (int)sizeof(uint32_t)) <= buf->cmn.size, VALIDATE_DISPATCH_INDIRECT_SIZE);
+        }
+        _SG_VALIDATE(_sg.required_bindings_and_uniforms == _sg.applied_bindings_and_uniforms, VALIDATE_DISPATCH_REQUIRED_BINDINGS_OR_UNIFORMS_MISSING);
+        return _sg_validate_end();
+    #endif
+}
+
 _SOKOL_PRIVATE bool _sg_validate_update_buffer(const _sg_buffer_t* buf, const sg_range* data) {
     #if !defined(SOKOL_DEBUG)
         _SOKOL_UNUSED(buf);
@@ -21280,6 +21471,48 @@ SOKOL_API_IMPL void sg_dispatch(int num_groups_x, int num_groups_y, int num_grou
     _SG_TRACE_ARGS(dispatch, num_groups_x, num_groups_y, num_groups_z);
 }
 
+SOKOL_API_IMPL void sg_draw_indirect(sg_buffer buf_id, int offset) {
+    SOKOL_ASSERT(_sg.valid);
+    _sg_buffer_t* buf = _sg_lookup_buffer(buf_id.id);
+    #if defined(SOKOL_DEBUG)
+    if (!_sg_validate_draw_indirect(buf, offset)) {
+        return;
+    }
+    #endif
+    _sg_stats_add(num_draw, 1);
+    if (!_sg.cur_pass.valid) {
+        return;
+    }
+    if (!_sg.next_draw_valid) {
+        return;
+    }
+    if (!buf || (SG_RESOURCESTATE_VALID != buf->slot.state)) {
+        return;
+    }
+    _sg_draw_indirect(buf, offset);
+}
+
+SOKOL_API_IMPL void sg_dispatch_indirect(sg_buffer buf_id, int offset) {
+    SOKOL_ASSERT(_sg.valid);
+    _sg_buffer_t* buf = _sg_lookup_buffer(buf_id.id);
+    #if defined(SOKOL_DEBUG)
+    if (!_sg_validate_dispatch_indirect(buf, offset)) {
+        return;
+    }
+    #endif
+    _sg_stats_add(num_dispatch, 1);
+    if (!_sg.cur_pass.valid) {
+        return;
+    }
+    if (!_sg.next_draw_valid) {
+        return;
+    }
+    if (!buf || (SG_RESOURCESTATE_VALID != buf->slot.state)) {
+        return;
+    }
+    _sg_dispatch_indirect(buf, offset);
+}
+
 SOKOL_API_IMPL void sg_end_pass(void) {
     SOKOL_ASSERT(_sg.valid);
     SOKOL_ASSERT(_sg.cur_pass.in_pass);
@@ -0,0 +1,70 @@
+#pragma once
+// Compute helpers shared by the GL particle demos (requires sokol_gfx.h).
+//
+// dispatch_items() runs a 1D kernel over any item count, folding workgroups
+// above the GL 4.3 dispatch limit into y (shaders linearize the index with
+// gl_NumWorkGroups.x). make_compute_pipeline() builds a pipeline from GLSL
+// source with storage buffer slot n bound to binding n, and PCG_HASH_GLSL is
+// the counter-based random number snippet the seeding shaders share.
+
+#include <cstdint>
+#include <initializer_list>
+
+// max workgroups per dispatch dimension guaranteed by GL 4.3
+constexpr uint32_t MAX_DISPATCH_GROUPS = 65535;
+
+// counter-based hash (PCG output permutation), every (particle, stream) pair
+// gets its own independent random number without any sequential state.
+// Expects the seed uniform
+inline const char* PCG_HASH_GLSL = R"(
+uint pcg_hash(uint v) {
+  uint state = v * 747796405u + 2891336453u;
+  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+float rnd(uint idx, uint stream) {
+  uint h = pcg_hash(pcg_hash(idx + uint(seed) * 0x9E3779B9u) + stream);
+  return float(h >> 8) * (1.0 / 16777216.0);
+}
+)";
+
+// 1D dispatch over num_items threads in groups of group_size, large counts
+// are folded into the y dimension
+inline void dispatch_items(uint32_t num_items, uint32_t group_size = 64) {
+    const uint32_t num_groups = (num_items + group_size - 1) / group_size;
+    const uint32_t groups_y = (num_groups + MAX_DISPATCH_GROUPS - 1) / MAX_DISPATCH_GROUPS;
+    const uint32_t groups_x = (num_groups + groups_y - 1) / groups_y;
+    sg_dispatch((int)groups_x, (int)groups_y, 1);
+}
+
+// build a compute pipeline whose storage buffer slot n is bound to GLSL binding n
+// for every bit n set in sbuf_mask (read-only if also set in readonly_mask)
+inline sg_pipeline make_compute_pipeline(const char* label, const char* source, uint32_t ub_size,
+                                         std::initializer_list<sg_glsl_shader_uniform> uniforms,
+                                         uint32_t sbuf_mask, uint32_t readonly_mask = 0) {
+    sg_shader_desc _shader_desc{};
+    _shader_desc.compute_func.source = source;
+    if (ub_size > 0) {
+        _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _shader_desc.uniform_blocks[0].size = ub_size;
+        int i = 0;
+        for (const sg_glsl_shader_uniform& u : uniforms) {
+            _shader_desc.uniform_blocks[0].glsl_uniforms[i++] = u;
+        }
+    }
+    for (int i = 0; i < SG_MAX_STORAGEBUFFER_BINDSLOTS; i++) {
+        if (sbuf_mask & (1u << i)) {
+            _shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_COMPUTE;
+            _shader_desc.storage_buffers[i].readonly = (readonly_mask & (1u << i)) != 0;
+            _shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+        }
+    }
+    _shader_desc.label = label;
+
+    sg_pipeline_desc _pipeline_desc{};
+    _pipeline_desc.compute = true;
+    _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+    _pipeline_desc.label = label;
+    return sg_make_pipeline(&_pipeline_desc);
+}
@@ -0,0 +1,84 @@
+#pragma once
+// Extra GL entry points and constants used directly by the demos (timer
+// queries, fences, buffer mapping, ...). Must be included *before* sokol_gfx.h so that the embedded
+// win32 GL loader picks up SG_GL_FUNCS_EXT, on other platforms the system GL
+// headers already provide the prototypes.
+//
+// NOTE: the win32 loader looks up every entry point listed here and asserts
+// in debug builds if one is missing. Functions newer than GL 4.3 (currently
+// glBufferStorage, GL 4.4 / ARB_buffer_storage) are exported by all current
+// drivers, callers still check the version or extension before using them.
+
+#define SG_GL_FUNCS_EXT \
+    _SG_XMACRO(glGenQueries,                      void, (GLsizei n, GLuint* ids)) \
+    _SG_XMACRO(glDeleteQueries,                   void, (GLsizei n, const GLuint* ids)) \
+    _SG_XMACRO(glQueryCounter,                    void, (GLuint id, GLenum target)) \
+    _SG_XMACRO(glGetQueryObjectiv,                void, (GLuint id, GLenum pname, GLint* params)) \
+    _SG_XMACRO(glGetQueryObjectui64v,             void, (GLuint id, GLenum pname, GLuint64* params)) \
+    _SG_XMACRO(glGetBufferSubData,                void, (GLenum target, GLintptr offset, GLsizeiptr size, void* data)) \
+    _SG_XMACRO(glCopyBufferSubData,               void, (GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)) \
+    _SG_XMACRO(glMapBufferRange,                  void*, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)) \
+    _SG_XMACRO(glUnmapBuffer,                     GLboolean, (GLenum target)) \
+    _SG_XMACRO(glFenceSync,                       GLsync, (GLenum condition, GLbitfield flags)) \
+    _SG_XMACRO(glClientWaitSync,                  GLenum, (GLsync sync, GLbitfield flags, GLuint64 timeout)) \
+    _SG_XMACRO(glDeleteSync,                      void, (GLsync sync)) \
+    _SG_XMACRO(glBufferStorage,                   void, (GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)) \
+    _SG_XMACRO(glGetTexImage,                     void, (GLenum target, GLint level, GLenum format, GLenum type, void* pixels))
+
+// the win32 loader doesn't declare the sync object type, identical to glext.h
+typedef struct __GLsync* GLsync;
+
+#ifndef GL_COPY_READ_BUFFER
+#define GL_COPY_READ_BUFFER 0x8F36
+#endif
+#ifndef GL_COPY_WRITE_BUFFER
+#define GL_COPY_WRITE_BUFFER 0x8F37
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+#ifndef GL_TIMEOUT_IGNORED
+#define GL_TIMEOUT_IGNORED 0xFFFFFFFFFFFFFFFFull
+#endif
+#ifndef GL_MAX_COMPUTE_IMAGE_UNIFORMS
+#define GL_MAX_COMPUTE_IMAGE_UNIFORMS 0x91BD
+#endif
+#ifndef GL_PACK_ALIGNMENT
+#define GL_PACK_ALIGNMENT 0x0D05
+#endif
+#ifndef GL_TEXTURE_UPDATE_BARRIER_BIT
+#define GL_TEXTURE_UPDATE_BARRIER_BIT 0x00000100
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+// GPU timer based on GL timestamp queries (requires gl_ext.h before sokol_gfx.h).
+//
+// A frame is split into spans by calling gpu_timer_stamp() after each stage
+// (outside of sokol passes), the span ending at a stamp carries its name.
+// Results are read back GPU_TIMER_LATENCY frames later so that querying never
+// stalls the pipeline, and are averaged until gpu_timer_report() is called.
+
+#include <cstdio>
+#include <cstring>
+
+constexpr int GPU_TIMER_MAX_STAMPS = 16;
+constexpr int GPU_TIMER_LATENCY = 4;
+
+struct gpu_timer_t {
+    GLuint queries[GPU_TIMER_LATENCY][GPU_TIMER_MAX_STAMPS];
+    const char* names[GPU_TIMER_LATENCY][GPU_TIMER_MAX_STAMPS];
+    int num_stamps[GPU_TIMER_LATENCY];
+    uint64_t frame_index;
+
+    // averaged results of resolved frames
+    const char* span_names[GPU_TIMER_MAX_STAMPS];
+    double span_ms[GPU_TIMER_MAX_STAMPS];
+    int num_spans;
+    int num_samples;
+};
+
+inline void gpu_timer_init(gpu_timer_t* t) {
+    *t = {};
+    for (int i = 0; i < GPU_TIMER_LATENCY; i++) {
+        glGenQueries(GPU_TIMER_MAX_STAMPS, t->queries[i]);
+    }
+}
+
+inline void gpu_timer_shutdown(gpu_timer_t* t) {
+    for (int i = 0; i < GPU_TIMER_LATENCY; i++) {
+        glDeleteQueries(GPU_TIMER_MAX_STAMPS, t->queries[i]);
+    }
+}
+
+inline void gpu_timer_reset(gpu_timer_t* t) {
+    t->num_spans = 0;
+    t->num_samples = 0;
+}
+
+inline void gpu_timer_resolve(gpu_timer_t* t, int slot) {
+    const int num_stamps = t->num_stamps[slot];
+    if (num_stamps < 2) {
+        return;
+    }
+    GLint available = 0;
+    glGetQueryObjectiv(t->queries[slot][num_stamps - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        // GPU is more than GPU_TIMER_LATENCY frames behind, drop the sample
+        return;
+    }
+    // a different stage sequence than before restarts the average
+    bool same_spans = (t->num_spans == num_stamps - 1);
+    for (int i = 1; same_spans && (i < num_stamps); i++) {
+        same_spans = (0 == strcmp(t->span_names[i - 1], t->names[slot][i]));
+    }
+    if (!same_spans) {
+        gpu_timer_reset(t);
+        t->num_spans = num_stamps - 1;
+        for (int i = 1; i < num_stamps; i++) {
+            t->span_names[i - 1] = t->names[slot][i];
+            t->span_ms[i - 1] = 0.0;
+        }
+    }
+    GLuint64 prev = 0;
+    glGetQueryObjectui64v(t->queries[slot][0], GL_QUERY_RESULT, &prev);
+    for (int i = 1; i < num_stamps; i++) {
+        GLuint64 cur = 0;
+        glGetQueryObjectui64v(t->queries[slot][i], GL_QUERY_RESULT, &cur);
+        t->span_ms[i - 1] += (double)(cur - prev) * 1.0e-6;
+        prev = cur;
+    }
+    t->num_samples++;
+}
+
+inline void gpu_timer_stamp(gpu_timer_t* t, const char* name) {
+    const int slot = (int)(t->frame_index % GPU_TIMER_LATENCY);
+    const int i = t->num_stamps[slot];
+    if (i >= GPU_TIMER_MAX_STAMPS) {
+        return;
+    }
+    glQueryCounter(t->queries[slot][i], GL_TIMESTAMP);
+    t->names[slot][i] = name;
+    t->num_stamps[slot] = i + 1;
+}
+
+// call once per frame before the first stage
+inline void gpu_timer_begin_frame(gpu_timer_t* t) {
+    t->frame_index++;
+    const int slot = (int)(t->frame_index % GPU_TIMER_LATENCY);
+    gpu_timer_resolve(t, slot);
+    t->num_stamps[slot] = 0;
+    gpu_timer_stamp(t, "begin");
+}
+
+// average duration of a named span in milliseconds (0 if unknown)
+inline double gpu_timer_ms(const gpu_timer_t* t, const char* name) {
+    for (int i = 0; i < t->num_spans; i++) {
+        if ((0 == strcmp(t->span_names[i], name)) && (t->num_samples > 0)) {
+            return t->span_ms[i] / t->num_samples;
+        }
+    }
+    return 0.0;
+}
+
+inline double gpu_timer_total_ms(const gpu_timer_t* t) {
+    if (t->num_samples == 0) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (int i = 0; i < t->num_spans; i++) {
+        total += t->span_ms[i];
+    }
+    return total / t->num_samples;
+}
+
+// print averaged span durations on one line and restart averaging
+inline void gpu_timer_report(gpu_timer_t* t, const char* label) {
+    if (t->num_samples == 0) {
+        return;
+    }
+    printf("%s:", label);
+    for (int i = 0; i < t->num_spans; i++) {
+        printf(" %s %.3fms", t->span_names[i], t->span_ms[i] / t->num_samples);
+    }
+    printf(" | total %.3fms (%d frames)\n", gpu_timer_total_ms(t), t->num_samples);
+    fflush(stdout);
+    gpu_timer_reset(t);
+}
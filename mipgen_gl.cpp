@@ -0,0 +1,287 @@
+#define SOKOL_IMPL
+#define SOKOL_NO_ENTRY
+#define SOKOL_GLCORE
+#include "gl_ext.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_log.h"
+
+#include "HandmadeMath.h"
+
+#include "gpu_timer_gl.h"
+#include "mipgen_gl.h"
+#include "noise_lib_gl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+constexpr uint32_t SCREEN_WIDTH = 400;
+constexpr uint32_t SCREEN_HEIGHT = 300;
+
+constexpr int MIPGEN_WARMUP_FRAMES = 10;
+constexpr int MIPGEN_MEASURE_FRAMES = 100;
+
+struct image_size_t {
+    int width;
+    int height;
+};
+
+// GLmipgen is a micro-benchmark of mipgen_gl.h: for every image size it fills
+// the base level with fBm noise once, then times the full mip chain built by
+// the single pass downsampler against one dispatch per level, and checks every
+// level of both against a 2x2 box filter of the level above it
+struct {
+    struct {
+        std::vector<image_size_t> sizes;
+        sg_pixel_format format;
+        bool validate;
+    } config;
+    size_t size_index;
+    int frame;
+    sg_image img;
+    sg_attachments atts;
+    noise_lib_t noise;
+    mipgen_t mipgen;
+    sg_pass_action pass_action;
+    gpu_timer_t timer;
+} state;
+
+void create_image(image_size_t size) {
+    state.frame = 0;
+
+    sg_image_desc _sg_image_desc{};
+    _sg_image_desc.usage.storage_attachment = true;
+    _sg_image_desc.width = size.width;
+    _sg_image_desc.height = size.height;
+    _sg_image_desc.num_mipmaps = mipgen_num_mipmaps(size.width, size.height);
+    _sg_image_desc.pixel_format = state.config.format;
+    _sg_image_desc.label = "mipgen-image";
+    state.img = sg_make_image(&_sg_image_desc);
+
+    sg_attachments_desc _sg_attachments_desc{};
+    _sg_attachments_desc.storages[0].image = state.img;
+    _sg_attachments_desc.label = "mipgen-attachments";
+    state.atts = sg_make_attachments(&_sg_attachments_desc);
+
+    // the base level never changes, only the chain below it is rebuilt
+    const noise_desc_t desc = { NOISE_PERLIN, NOISE_FRACTAL_FBM, 6 };
+    const noise_params_t params = { 0.0f, 8.0f, 2.0f, 0.5f, HMM_V2((float)size.width, (float)size.height), HMM_V2(0.0f, 0.0f), HMM_V2(0.0f, 0.0f) };
+    noise_lib_pipeline(&state.noise, desc);
+    sg_pass _noise_pass = { .compute=true, .attachments=state.atts, .label="noise-pass" };
+    sg_begin_pass(&_noise_pass);
+    noise_lib_dispatch(&state.noise, desc, params);
+    sg_end_pass();
+}
+
+void destroy_image() {
+    sg_destroy_attachments(state.atts);
+    sg_destroy_image(state.img);
+}
+
+int num_channels() {
+    return state.config.format == SG_PIXELFORMAT_R32F ? 1 : 4;
+}
+
+// all levels of the image as floats
+std::vector<std::vector<float>> read_levels() {
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    const sg_gl_image_info info = sg_gl_query_image_info(state.img);
+    const int num_mips = sg_query_image_num_mipmaps(state.img);
+    std::vector<std::vector<float>> levels(num_mips);
+    glBindTexture(GL_TEXTURE_2D, info.tex[info.active_slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (int level = 0; level < num_mips; level++) {
+        const int w = std::max(sg_query_image_width(state.img) >> level, 1);
+        const int h = std::max(sg_query_image_height(state.img) >> level, 1);
+        levels[level].resize((size_t)w * h * num_channels());
+        glGetTexImage(GL_TEXTURE_2D, level, num_channels() == 1 ? GL_RED : GL_RGBA, GL_FLOAT, levels[level].data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    // sokol-gfx caches the texture bindings
+    sg_reset_state_cache();
+    return levels;
+}
+
+// every level must be the box filter of the stored level above it, up to the
+// rounding of the pixel format
+bool validate() {
+    const std::vector<std::vector<float>> levels = read_levels();
+    const float tolerance = state.config.format == SG_PIXELFORMAT_RGBA8 ? 1.5f / 255.0f : 2.0e-3f;
+    const int channels = num_channels();
+    for (size_t level = 1; level < levels.size(); level++) {
+        const int src_w = std::max(sg_query_image_width(state.img) >> (level - 1), 1);
+        const int src_h = std::max(sg_query_image_height(state.img) >> (level - 1), 1);
+        const int w = std::max(src_w >> 1, 1);
+        const int h = std::max(src_h >> 1, 1);
+        const std::vector<float>& src = levels[level - 1];
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                const int x0 = std::min(2 * x, src_w - 1);
+                const int x1 = std::min(2 * x + 1, src_w - 1);
+                const int y0 = std::min(2 * y, src_h - 1);
+                const int y1 = std::min(2 * y + 1, src_h - 1);
+                for (int c = 0; c < channels; c++) {
+                    const float expected = 0.25f * (src[(y0 * src_w + x0) * channels + c] + src[(y0 * src_w + x1) * channels + c] +
+                                                    src[(y1 * src_w + x0) * channels + c] + src[(y1 * src_w + x1) * channels + c]);
+                    if (fabsf(levels[level][(y * w + x) * channels + c] - expected) > tolerance * std::max(1.0f, fabsf(expected))) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void init() {
+    sg_desc _sg_desc{};
+    _sg_desc.environment = sglue_environment();
+    _sg_desc.logger.func = slog_func;
+    sg_setup(&_sg_desc);
+
+    state.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.0f, 0.0f, 0.0f, 1.0f} };
+
+    noise_lib_init(&state.noise, state.config.format);
+    mipgen_init(&state.mipgen);
+    printf("mipgen: up to %d levels per dispatch\n", state.mipgen.levels_per_pass);
+    gpu_timer_init(&state.timer);
+    create_image(state.config.sizes[0]);
+}
+
+void frame() {
+    gpu_timer_begin_frame(&state.timer);
+    mipgen_generate(&state.mipgen, state.img);
+    gpu_timer_stamp(&state.timer, "spd");
+    mipgen_generate_naive(&state.mipgen, state.img);
+    gpu_timer_stamp(&state.timer, "naive");
+
+    sg_pass _pass = { .action=state.pass_action, .swapchain=sglue_swapchain() };
+    sg_begin_pass(&_pass);
+    sg_end_pass();
+    sg_commit();
+
+    state.frame++;
+    if (state.frame == MIPGEN_WARMUP_FRAMES) {
+        gpu_timer_reset(&state.timer);
+    }
+    if ((state.frame < MIPGEN_WARMUP_FRAMES) || (state.timer.num_samples < MIPGEN_MEASURE_FRAMES)) {
+        return;
+    }
+
+    const image_size_t size = state.config.sizes[state.size_index];
+    const double spd_ms = gpu_timer_ms(&state.timer, "spd");
+    const double naive_ms = gpu_timer_ms(&state.timer, "naive");
+    const double mpix = (double)size.width * size.height / 1.0e6;
+    printf("%5dx%-5d %2d levels: spd %.3fms %8.1f Mpix/s | naive %.3fms %8.1f Mpix/s | %.2fx",
+        size.width,
+        size.height,
+        sg_query_image_num_mipmaps(state.img),
+        spd_ms,
+        mpix / (spd_ms * 1.0e-3),
+        naive_ms,
+        mpix / (naive_ms * 1.0e-3),
+        naive_ms / spd_ms);
+    if (state.config.validate) {
+        // the naive chain is the current contents
+        const bool naive_ok = validate();
+        mipgen_generate(&state.mipgen, state.img);
+        const bool spd_ok = validate();
+        printf(" | spd %s, naive %s", spd_ok ? "ok" : "MISMATCH", naive_ok ? "ok" : "MISMATCH");
+    }
+    printf("\n");
+    fflush(stdout);
+
+    destroy_image();
+    state.size_index++;
+    if (state.size_index >= state.config.sizes.size()) {
+        sapp_request_quit();
+        return;
+    }
+    create_image(state.config.sizes[state.size_index]);
+    gpu_timer_reset(&state.timer);
+}
+
+void cleanup() {
+    if (state.size_index < state.config.sizes.size()) {
+        destroy_image();
+    }
+    mipgen_shutdown(&state.mipgen);
+    noise_lib_shutdown(&state.noise);
+    gpu_timer_shutdown(&state.timer);
+    sg_shutdown();
+}
+
+// parse an image size, "N" for a square or "WxH"
+image_size_t parse_size(const char* str) {
+    char* end = nullptr;
+    const long width = strtol(str, &end, 10);
+    const long height = ((*end == 'x') || (*end == 'X')) ? strtol(end + 1, nullptr, 10) : width;
+    return { (int)std::clamp(width, 1l, 16384l), (int)std::clamp(height, 1l, 16384l) };
+}
+
+// options can be given on the command line or through environment variables:
+//   --size=S,S,...     MIPGEN_SIZE         image sizes to benchmark, N or WxH (default: 256,1000x600,1920x1080,4096,8192x512)
+//   --format=F         MIPGEN_FORMAT       rgba8, rgba16f or r32f (default: rgba8)
+//   --no-validate      MIPGEN_NO_VALIDATE  skip the readback and CPU check
+void parse_args(int argc, char* argv[]) {
+    const char* sizes = getenv("MIPGEN_SIZE");
+    const char* format = getenv("MIPGEN_FORMAT");
+    state.config.validate = getenv("MIPGEN_NO_VALIDATE") == nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--size=", 7)) {
+            sizes = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--format=", 9)) {
+            format = argv[i] + 9;
+        } else if (0 == strcmp(argv[i], "--no-validate")) {
+            state.config.validate = false;
+        }
+    }
+    state.config.format = SG_PIXELFORMAT_RGBA8;
+    if (format) {
+        if (0 == strcmp(format, "rgba16f")) {
+            state.config.format = SG_PIXELFORMAT_RGBA16F;
+        } else if (0 == strcmp(format, "r32f")) {
+            state.config.format = SG_PIXELFORMAT_R32F;
+        } else if (0 != strcmp(format, "rgba8")) {
+            printf("unknown format '%s'\n", format);
+        }
+    }
+    std::string list = sizes ? sizes : "256,1000x600,1920x1080,4096,8192x512";
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            state.config.sizes.push_back(parse_size(list.substr(start, end - start).c_str()));
+        }
+        start = end + 1;
+    }
+    if (state.config.sizes.empty()) {
+        state.config.sizes.push_back({ 1024, 1024 });
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    sapp_desc desc = {0};
+    desc.init_cb = init;
+    desc.frame_cb = frame;
+    desc.cleanup_cb = cleanup,
+    desc.width  = SCREEN_WIDTH,
+    desc.height = SCREEN_HEIGHT,
+    desc.window_title = "sokol cs mip chain (GL4.3)",
+    desc.icon.sokol_default = true,
+    desc.logger.func = slog_func;
+    sapp_run(&desc);
+
+    return 0;
+}
@@ -0,0 +1,378 @@
+#pragma once
+// Single-pass mip chain generation for storage images (requires gl_ext.h
+// before sokol_gfx.h).
+//
+// Modelled on AMD's single pass downsampler: each workgroup of 256 threads
+// takes a 64x64 block of the source level and reduces it with 2x2 box filters
+// down to a single texel, writing every level on the way. The first level
+// is computed from texel fetches, the following five from shared memory.
+// The workgroups then count themselves off on an atomic counter, and the last
+// one to finish reduces the 1/64 level (at most 64x64 texels) to the
+// remaining levels, so a whole chain of up to 12 levels is one dispatch.
+// The levels are bound as an image array on raw GL image units, since
+// sokol-gfx binds at most SG_MAX_STORAGE_ATTACHMENTS. When the driver has
+// fewer image units than levels, or the source is 8192 or larger, the chain
+// is split into several dispatches.
+//
+// mipgen_generate_naive() does the same with one dispatch per level, for
+// comparison. Both must be called outside of sokol passes, after the base
+// level was written, and leave the image ready for sampling.
+
+#include <cstdint>
+#include <string>
+
+// levels one dispatch can write when the driver has enough image units
+constexpr int MIPGEN_MAX_LEVELS = 12;
+
+enum mipgen_format_t {
+    MIPGEN_FORMAT_RGBA8,
+    MIPGEN_FORMAT_RGBA16F,
+    MIPGEN_FORMAT_R32F,
+    MIPGEN_FORMAT_RGBA32F,
+    NUM_MIPGEN_FORMATS,
+};
+
+struct mipgen_params_t {
+    int32_t src_size[2];
+    int32_t src_level;
+    int32_t num_levels;         // written by this dispatch
+    int32_t num_groups;
+};
+
+// the naive shader only reads the source level
+struct mipgen_naive_params_t {
+    int32_t src_size[2];
+    int32_t src_level;
+};
+
+struct mipgen_t {
+    // created on first use of a format
+    sg_pipeline spd_pips[NUM_MIPGEN_FORMATS];
+    sg_pipeline naive_pips[NUM_MIPGEN_FORMATS];
+    sg_buffer counter;
+    sg_sampler smp;
+    int levels_per_pass;
+};
+
+// full chain down to 1x1, for sg_image_desc.num_mipmaps
+inline int mipgen_num_mipmaps(int width, int height) {
+    int num_mips = 1;
+    while ((width > 1) || (height > 1)) {
+        width >>= 1;
+        height >>= 1;
+        num_mips++;
+    }
+    return num_mips;
+}
+
+inline int mipgen_format_index(sg_pixel_format format) {
+    switch (format) {
+        case SG_PIXELFORMAT_RGBA8: return MIPGEN_FORMAT_RGBA8;
+        case SG_PIXELFORMAT_RGBA16F: return MIPGEN_FORMAT_RGBA16F;
+        case SG_PIXELFORMAT_R32F: return MIPGEN_FORMAT_R32F;
+        case SG_PIXELFORMAT_RGBA32F: return MIPGEN_FORMAT_RGBA32F;
+        default: return -1;
+    }
+}
+
+inline const char* mipgen_glsl_format(int format) {
+    static const char* names[NUM_MIPGEN_FORMATS] = { "rgba8", "rgba16f", "r32f", "rgba32f" };
+    return names[format];
+}
+
+inline GLenum mipgen_gl_format(int format) {
+    static const GLenum formats[NUM_MIPGEN_FORMATS] = { GL_RGBA8, GL_RGBA16F, GL_R32F, GL_RGBA32F };
+    return formats[format];
+}
+
+inline void mipgen_init(mipgen_t* m) {
+    *m = {};
+    GLint max_units = 0;
+    glGetIntegerv(GL_MAX_COMPUTE_IMAGE_UNIFORMS, &max_units);
+    m->levels_per_pass = max_units < 1 ? 1 : (max_units > MIPGEN_MAX_LEVELS ? MIPGEN_MAX_LEVELS : max_units);
+
+    const uint32_t zero = 0;
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.data = SG_RANGE(zero);
+    _sg_buffer_desc.label = "mipgen-counter";
+    m->counter = sg_make_buffer(&_sg_buffer_desc);
+
+    sg_sampler_desc _sg_sampler_desc{};
+    _sg_sampler_desc.min_filter = SG_FILTER_NEAREST;
+    _sg_sampler_desc.mag_filter = SG_FILTER_NEAREST;
+    _sg_sampler_desc.label = "mipgen-sampler";
+    m->smp = sg_make_sampler(&_sg_sampler_desc);
+}
+
+inline void mipgen_shutdown(mipgen_t* m) {
+    for (int i = 0; i < NUM_MIPGEN_FORMATS; i++) {
+        if (m->spd_pips[i].id != SG_INVALID_ID) {
+            sg_destroy_pipeline(m->spd_pips[i]);
+        }
+        if (m->naive_pips[i].id != SG_INVALID_ID) {
+            sg_destroy_pipeline(m->naive_pips[i]);
+        }
+    }
+    sg_destroy_buffer(m->counter);
+    sg_destroy_sampler(m->smp);
+}
+
+// counter: the single pass shader, with the workgroup counter and the full
+// mipgen_params_t, otherwise the naive one with mipgen_naive_params_t
+inline sg_pipeline mipgen_make_pipeline(const char* label, const std::string& source, bool counter) {
+    sg_shader_desc _shader_desc{};
+    _shader_desc.compute_func.source = source.c_str();
+    _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.uniform_blocks[0].size = counter ? sizeof(mipgen_params_t) : sizeof(mipgen_naive_params_t);
+    _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_INT2, .glsl_name = "src_size" };
+    _shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "src_level" };
+    if (counter) {
+        _shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_levels" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[3] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_groups" };
+    }
+    _shader_desc.images[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.images[0].image_type = SG_IMAGETYPE_2D;
+    _shader_desc.images[0].sample_type = SG_IMAGESAMPLETYPE_UNFILTERABLE_FLOAT;
+    _shader_desc.samplers[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.samplers[0].sampler_type = SG_SAMPLERTYPE_NONFILTERING;
+    _shader_desc.image_sampler_pairs[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.image_sampler_pairs[0].image_slot = 0;
+    _shader_desc.image_sampler_pairs[0].sampler_slot = 0;
+    _shader_desc.image_sampler_pairs[0].glsl_name = "src_tex";
+    if (counter) {
+        _shader_desc.storage_buffers[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _shader_desc.storage_buffers[0].readonly = false;
+        _shader_desc.storage_buffers[0].glsl_binding_n = 0;
+    }
+    _shader_desc.label = label;
+
+    sg_pipeline_desc _pipeline_desc{};
+    _pipeline_desc.compute = true;
+    _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+    _pipeline_desc.label = label;
+    return sg_make_pipeline(&_pipeline_desc);
+}
+
+inline sg_pipeline mipgen_spd_pipeline(mipgen_t* m, int format) {
+    if (m->spd_pips[format].id != SG_INVALID_ID) {
+        return m->spd_pips[format];
+    }
+    const std::string source = std::string(R"(
+#version 430
+uniform ivec2 src_size;
+uniform int src_level;
+uniform int num_levels;
+uniform int num_groups;
+
+uniform sampler2D src_tex;
+// dst_mips[i] is level src_level + 1 + i
+layout(binding=0, )") + mipgen_glsl_format(format) + R"() coherent uniform image2D dst_mips[)" + std::to_string(m->levels_per_pass) + R"(];
+layout(std430, binding=0) coherent buffer counter_ssbo {
+  uint counter;
+};
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+shared vec4 s_tile[32 * 32];
+shared bool s_last;
+
+// size of a level, relative to src_level
+ivec2 level_size(int level) {
+  return max(src_size >> level, ivec2(1));
+}
+
+vec4 load(ivec2 p, bool from_src) {
+  if (from_src) {
+    return texelFetch(src_tex, min(p, src_size - 1), src_level);
+  }
+  return imageLoad(dst_mips[5], min(p, level_size(6) - 1));
+}
+
+void store(int level, ivec2 p, vec4 v) {
+  if (all(lessThan(p, level_size(level)))) {
+    imageStore(dst_mips[level - 1], p, v);
+  }
+}
+
+// reduce a 64x64 block of level first_level - 1 by up to six levels
+void downsample_block(ivec2 block, int first_level, bool from_src) {
+  int t = int(gl_LocalInvocationIndex);
+  ivec2 l = ivec2(t % 16, t / 16);
+  // first level, 32x32 texels, a 2x2 quad per thread
+  for (int j = 0; j < 2; j++) {
+    for (int i = 0; i < 2; i++) {
+      ivec2 q = l * 2 + ivec2(i, j);
+      ivec2 p = block * 32 + q;
+      ivec2 s = p * 2;
+      vec4 v = 0.25 * (load(s, from_src) + load(s + ivec2(1, 0), from_src) + load(s + ivec2(0, 1), from_src) + load(s + ivec2(1, 1), from_src));
+      store(first_level, p, v);
+      s_tile[q.y * 32 + q.x] = v;
+    }
+  }
+  // the next levels from shared memory, compacted into its top left corner
+  int size = 16;
+  int last_level = min(first_level + 5, num_levels);
+  for (int level = first_level + 1; level <= last_level; level++) {
+    barrier();
+    ivec2 q = ivec2(t % size, t / size);
+    bool in_range = t < size * size;
+    vec4 v = vec4(0.0);
+    if (in_range) {
+      // clamp to the edge of the level above, like the fetches from the source
+      ivec2 last = max(level_size(level - 1) - block * (2 * size) - 1, ivec2(0));
+      ivec2 a = min(2 * q, last);
+      ivec2 b = min(2 * q + 1, last);
+      v = 0.25 * (s_tile[a.y * 32 + a.x] + s_tile[a.y * 32 + b.x] + s_tile[b.y * 32 + a.x] + s_tile[b.y * 32 + b.x]);
+    }
+    barrier();
+    if (in_range) {
+      s_tile[q.y * 32 + q.x] = v;
+      store(level, block * size + q, v);
+    }
+    size >>= 1;
+  }
+}
+
+void main() {
+  downsample_block(ivec2(gl_WorkGroupID.xy), 1, true);
+  if (num_levels <= 6) {
+    return;
+  }
+
+  // the last workgroup to get here finishes the tail from level 6
+  memoryBarrierImage();
+  barrier();
+  if (gl_LocalInvocationIndex == 0u) {
+    s_last = atomicAdd(counter, 1u) == uint(num_groups) - 1u;
+  }
+  barrier();
+  if (!s_last) {
+    return;
+  }
+  if (gl_LocalInvocationIndex == 0u) {
+    counter = 0u;
+  }
+  downsample_block(ivec2(0), 7, false);
+}
+)";
+    m->spd_pips[format] = mipgen_make_pipeline("mipgen-spd", source, true);
+    return m->spd_pips[format];
+}
+
+inline sg_pipeline mipgen_naive_pipeline(mipgen_t* m, int format) {
+    if (m->naive_pips[format].id != SG_INVALID_ID) {
+        return m->naive_pips[format];
+    }
+    const std::string source = std::string(R"(
+#version 430
+uniform ivec2 src_size;
+uniform int src_level;
+
+uniform sampler2D src_tex;
+layout(binding=0, )") + mipgen_glsl_format(format) + R"() writeonly uniform image2D dst_mip;
+
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
+
+vec4 load(ivec2 p) {
+  return texelFetch(src_tex, min(p, src_size - 1), src_level);
+}
+
+void main() {
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, max(src_size >> 1, ivec2(1))))) {
+    return;
+  }
+  ivec2 s = p * 2;
+  imageStore(dst_mip, p, 0.25 * (load(s) + load(s + ivec2(1, 0)) + load(s + ivec2(0, 1)) + load(s + ivec2(1, 1))));
+}
+)";
+    m->naive_pips[format] = mipgen_make_pipeline("mipgen-naive", source, false);
+    return m->naive_pips[format];
+}
+
+inline bool mipgen_check_image(sg_image img, int* format) {
+    *format = mipgen_format_index(sg_query_image_pixelformat(img));
+    if (*format < 0) {
+        printf("mipgen: unsupported pixel format\n");
+        return false;
+    }
+    return sg_query_image_num_mipmaps(img) > 1;
+}
+
+inline void mipgen_generate(mipgen_t* m, sg_image img) {
+    int format = 0;
+    if (!mipgen_check_image(img, &format)) {
+        return;
+    }
+    const sg_pipeline pip = mipgen_spd_pipeline(m, format);
+    const sg_gl_image_info info = sg_gl_query_image_info(img);
+    const int width = sg_query_image_width(img);
+    const int height = sg_query_image_height(img);
+    const int num_mips = sg_query_image_num_mipmaps(img);
+
+    int level = 0;
+    while (level + 1 < num_mips) {
+        const int src_w = width >> level > 1 ? width >> level : 1;
+        const int src_h = height >> level > 1 ? height >> level : 1;
+        int num_levels = num_mips - 1 - level < m->levels_per_pass ? num_mips - 1 - level : m->levels_per_pass;
+        // the tail workgroup handles a single 64x64 block of level 6
+        if (((src_w >> 6) > 64) || ((src_h >> 6) > 64)) {
+            num_levels = num_levels < 6 ? num_levels : 6;
+        }
+        const int groups_x = (src_w + 63) / 64;
+        const int groups_y = (src_h + 63) / 64;
+        const mipgen_params_t params = { { src_w, src_h }, level, num_levels, groups_x * groups_y };
+
+        sg_bindings _bindings{};
+        _bindings.images[0] = img;
+        _bindings.samplers[0] = m->smp;
+        _bindings.storage_buffers[0] = m->counter;
+        sg_pass _mipgen_pass = { .compute=true, .label="mipgen-pass" };
+        sg_begin_pass(&_mipgen_pass);
+        sg_apply_pipeline(pip);
+        sg_apply_bindings(&_bindings);
+        sg_apply_uniforms(0, SG_RANGE(params));
+        for (int i = 0; i < num_levels; i++) {
+            glBindImageTexture((GLuint)i, info.tex[info.active_slot], level + 1 + i, GL_FALSE, 0, GL_READ_WRITE, mipgen_gl_format(format));
+        }
+        sg_dispatch(groups_x, groups_y, 1);
+        sg_end_pass();
+        // sokol-gfx doesn't know about the image writes, and the tail
+        // workgroup resets the counter for the next dispatch
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        level += num_levels;
+    }
+}
+
+inline void mipgen_generate_naive(mipgen_t* m, sg_image img) {
+    int format = 0;
+    if (!mipgen_check_image(img, &format)) {
+        return;
+    }
+    const sg_pipeline pip = mipgen_naive_pipeline(m, format);
+    const sg_gl_image_info info = sg_gl_query_image_info(img);
+    const int width = sg_query_image_width(img);
+    const int height = sg_query_image_height(img);
+    const int num_mips = sg_query_image_num_mipmaps(img);
+
+    sg_bindings _bindings{};
+    _bindings.images[0] = img;
+    _bindings.samplers[0] = m->smp;
+    sg_pass _mipgen_pass = { .compute=true, .label="mipgen-naive-pass" };
+    sg_begin_pass(&_mipgen_pass);
+    sg_apply_pipeline(pip);
+    sg_apply_bindings(&_bindings);
+    for (int level = 0; level + 1 < num_mips; level++) {
+        const int src_w = width >> level > 1 ? width >> level : 1;
+        const int src_h = height >> level > 1 ? height >> level : 1;
+        const int dst_w = src_w >> 1 > 1 ? src_w >> 1 : 1;
+        const int dst_h = src_h >> 1 > 1 ? src_h >> 1 : 1;
+        const mipgen_naive_params_t params = { { src_w, src_h }, level };
+        sg_apply_uniforms(0, SG_RANGE(params));
+        glBindImageTexture(0, info.tex[info.active_slot], level + 1, GL_FALSE, 0, GL_WRITE_ONLY, mipgen_gl_format(format));
+        sg_dispatch((dst_w + 7) / 8, (dst_h + 7) / 8, 1);
+        // the next level reads this one
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    sg_end_pass();
+}
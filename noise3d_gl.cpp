@@ -0,0 +1,579 @@
+#define SOKOL_IMPL
+#define SOKOL_NO_ENTRY
+#define SOKOL_GLCORE
+#include "gl_ext.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_log.h"
+
+#include "HandmadeMath.h"
+
+#include "gpu_timer_gl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+constexpr uint32_t SCREEN_WIDTH = 800;
+constexpr uint32_t SCREEN_HEIGHT = 600;
+
+constexpr int DEFAULT_VOLUME_SIZE = 128;
+constexpr int MIN_VOLUME_SIZE = 16;
+constexpr int MAX_VOLUME_SIZE = 256;
+constexpr int MAX_OCTAVES = 8;
+constexpr uint32_t NOISE3D_GROUP_SIZE = 8;
+
+// print the update timings every this many frames
+constexpr uint64_t NOISE3D_REPORT_FRAMES = 300;
+
+constexpr int BENCH_WARMUP_FRAMES = 10;
+constexpr int BENCH_MEASURE_FRAMES = 100;
+
+struct cs_params_t{
+    float frequency;
+    int32_t octaves;
+    int32_t volume_size;
+    int32_t slice_first;
+};
+
+// the camera basis and the view of the volume, see the fragment shader
+struct render_params_t{
+    HMM_Vec4 cam_pos;
+    HMM_Vec4 cam_right;
+    HMM_Vec4 cam_up;
+    HMM_Vec4 cam_forward;
+};
+
+enum update_mode_t {
+    UPDATE_FULL,        // the whole volume every time the clouds move by a slice
+    UPDATE_SLICES,      // only the slices that moved into view
+    NUM_UPDATE_MODES,
+};
+
+const char* update_mode_names[NUM_UPDATE_MODES] = { "full", "slices" };
+
+// GLnoise3d writes fBm of 3D gradient noise into a 3D storage image and
+// ray-marches it as clouds drifting along z. The volume is a ring buffer over
+// the noise domain: domain slice d lives in slice d % size, so when the clouds
+// move by a slice only that slice has to be generated, the rest of the
+// volume stays valid. The full mode generates everything at the same moments
+// for comparison, both give the same image
+struct {
+    struct {
+        int size;
+        int octaves;
+        float frequency;        // noise cells across the volume
+        float speed;            // slices per second
+        update_mode_t mode;
+        bool bench;
+    } config;
+    bool animate;
+    double scroll;              // domain slice at the near end of the volume
+    int64_t first_slice;        // domain slice in the volume with the lowest index
+    bool valid;
+    uint64_t frame_count;
+    struct {
+        uint64_t updates;
+        uint64_t slices;
+    } stats;
+    struct {
+        int mode;
+        int frame;
+    } bench;
+    struct {
+        sg_image img;
+        sg_attachments atts;
+        sg_pipeline pip;
+    } compute;
+    struct {
+        sg_pipeline pip;
+        sg_pass_action pass_action;
+        sg_sampler smp;
+    } graphics;
+    struct {
+        float yaw;
+        float pitch;
+        float distance;
+        bool dragging;
+    } camera;
+    gpu_timer_t timer;
+} state;
+
+void init() {
+    sg_desc _sg_desc{};
+    _sg_desc.environment = sglue_environment();
+    _sg_desc.logger.func = slog_func;
+    sg_setup(&_sg_desc);
+
+    // compute
+    {
+        // one float of density per voxel, 64 MB at 256^3
+        sg_image_desc _sg_image_desc{};
+        _sg_image_desc.type = SG_IMAGETYPE_3D;
+        _sg_image_desc.usage.storage_attachment = true;
+        _sg_image_desc.width = state.config.size;
+        _sg_image_desc.height = state.config.size;
+        _sg_image_desc.num_slices = state.config.size;
+        _sg_image_desc.pixel_format = SG_PIXELFORMAT_R32F;
+        _sg_image_desc.label = "noise3d-volume";
+        state.compute.img = sg_make_image(&_sg_image_desc);
+
+        sg_attachments_desc _sg_attachments_desc{};
+        _sg_attachments_desc.storages[0].image = state.compute.img;
+        _sg_attachments_desc.label = "noise3d-attachments";
+        state.compute.atts = sg_make_attachments(&_sg_attachments_desc);
+
+        sg_shader_desc _shader_desc{};
+        _shader_desc.compute_func.source = R"(
+#version 430
+uniform float frequency;
+uniform int octaves;
+uniform int volume_size;
+uniform int slice_first;    // domain slice of gl_GlobalInvocationID.z == 0
+
+layout(binding=0, r32f) uniform writeonly image3D cs_out_vol;
+
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
+
+uvec3 pcg3d(uvec3 v) {
+  v = v * 1664525u + 1013904223u;
+  v.x += v.y * v.z; v.y += v.z * v.x; v.z += v.x * v.y;
+  v ^= v >> 16u;
+  v.x += v.y * v.z; v.y += v.z * v.x; v.z += v.x * v.y;
+  return v;
+}
+
+vec3 gradient(ivec3 c) {
+  vec3 g = vec3(pcg3d(uvec3(c)) & 0xFFFFu) * (2.0 / 65535.0) - 1.0;
+  return normalize(g + 1e-4);
+}
+
+// gradient noise in about [-1, 1]
+float perlin(vec3 p) {
+  ivec3 i = ivec3(floor(p));
+  vec3 f = fract(p);
+  vec3 u = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+  float n000 = dot(gradient(i + ivec3(0, 0, 0)), f - vec3(0, 0, 0));
+  float n100 = dot(gradient(i + ivec3(1, 0, 0)), f - vec3(1, 0, 0));
+  float n010 = dot(gradient(i + ivec3(0, 1, 0)), f - vec3(0, 1, 0));
+  float n110 = dot(gradient(i + ivec3(1, 1, 0)), f - vec3(1, 1, 0));
+  float n001 = dot(gradient(i + ivec3(0, 0, 1)), f - vec3(0, 0, 1));
+  float n101 = dot(gradient(i + ivec3(1, 0, 1)), f - vec3(1, 0, 1));
+  float n011 = dot(gradient(i + ivec3(0, 1, 1)), f - vec3(0, 1, 1));
+  float n111 = dot(gradient(i + ivec3(1, 1, 1)), f - vec3(1, 1, 1));
+  return mix(mix(mix(n000, n100, u.x), mix(n010, n110, u.x), u.y),
+             mix(mix(n001, n101, u.x), mix(n011, n111, u.x), u.y), u.z);
+}
+
+void main() {
+  ivec3 gid = ivec3(gl_GlobalInvocationID);
+  if (any(greaterThanEqual(gid.xy, ivec2(volume_size)))) {
+    return;
+  }
+  int slice = slice_first + gid.z;
+  vec3 p = vec3(gid.xy, slice) * (frequency / float(volume_size));
+  float sum = 0.0;
+  float amplitude = 0.5;
+  for (int o = 0; o < octaves; o++) {
+    sum += amplitude * perlin(p);
+    p *= 2.0;
+    amplitude *= 0.5;
+  }
+  imageStore(cs_out_vol, ivec3(gid.xy, slice % volume_size), vec4(0.5 + sum));
+}
+)";
+        _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _shader_desc.uniform_blocks[0].size = sizeof(cs_params_t);
+        _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "frequency" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "octaves" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "volume_size" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[3] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "slice_first" };
+        _shader_desc.storage_images[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _shader_desc.storage_images[0].image_type = SG_IMAGETYPE_3D;
+        _shader_desc.storage_images[0].access_format = SG_PIXELFORMAT_R32F;
+        _shader_desc.storage_images[0].writeonly = true;
+        _shader_desc.storage_images[0].glsl_binding_n = 0;
+        _shader_desc.label = "noise3d-shader";
+
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.compute = true;
+        _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+        _pipeline_desc.label = "noise3d-pipeline";
+        state.compute.pip = sg_make_pipeline(&_pipeline_desc);
+    }
+
+    // graphics
+    {
+        sg_shader_desc _shader_desc{};
+        _shader_desc.vertex_func.source = R"(
+#version 430 core
+layout(location=0) out vec2 vUV;
+
+const vec4 vertices[4] = {
+  // pos         uv
+  {-1.0f, -1.0f, 0.0f, 1.0f},
+  { 1.0f, -1.0f, 1.0f, 1.0f},
+  {-1.0f,  1.0f, 0.0f, 0.0f},
+  { 1.0f,  1.0f, 1.0f, 0.0f},
+};
+const int indices[6] = { 0, 1, 2, 1, 3, 2 };
+
+void main() {
+  vec2 position = vertices[indices[gl_VertexID]].xy;
+  vec2 texcoord0 = vertices[indices[gl_VertexID]].zw;
+  gl_Position = vec4(position, 0.0f, 1.0f);
+  vUV = texcoord0;
+}
+)";
+        _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(binding=0) uniform sampler3D vol_tex;
+uniform vec4 cam_pos;       // w: tan of half the vertical field of view
+uniform vec4 cam_right;     // w: aspect ratio
+uniform vec4 cam_up;        // w: texture z of the near end of the volume
+uniform vec4 cam_forward;   // w: texture z extent of the volume
+layout(location=0) in vec2 vUV;
+out vec4 frag_color;
+
+const int NUM_STEPS = 128;
+const int NUM_LIGHT_STEPS = 6;
+const vec3 SUN_DIR = normalize(vec3(0.5, 0.8, 0.3));
+const float COVERAGE = 0.5;
+const float EXTINCTION = 40.0;
+
+// the volume fills the [-1, 1]^3 box, its z axis scrolls through the
+// ring buffer
+float density(vec3 p) {
+  vec3 uvw = p * 0.5 + 0.5;
+  uvw.z = cam_up.w + uvw.z * cam_forward.w;
+  return max(texture(vol_tex, uvw).r - COVERAGE, 0.0) * EXTINCTION;
+}
+
+bool intersect_box(vec3 ro, vec3 rd, out float t0, out float t1) {
+  vec3 inv = 1.0 / rd;
+  vec3 a = (-1.0 - ro) * inv;
+  vec3 b = (1.0 - ro) * inv;
+  vec3 near = min(a, b);
+  vec3 far = max(a, b);
+  t0 = max(max(near.x, near.y), max(near.z, 0.0));
+  t1 = min(min(far.x, far.y), far.z);
+  return t0 < t1;
+}
+
+void main() {
+  vec2 ndc = vec2(vUV.x * 2.0 - 1.0, 1.0 - vUV.y * 2.0);
+  vec3 rd = normalize(cam_forward.xyz + (ndc.x * cam_right.w * cam_pos.w) * cam_right.xyz + (ndc.y * cam_pos.w) * cam_up.xyz);
+  vec3 sky = mix(vec3(0.55, 0.65, 0.8), vec3(0.2, 0.35, 0.65), clamp(rd.y * 0.5 + 0.5, 0.0, 1.0));
+
+  float t0, t1;
+  if (!intersect_box(cam_pos.xyz, rd, t0, t1)) {
+    frag_color = vec4(sky, 1.0);
+    return;
+  }
+  float dt = (t1 - t0) / float(NUM_STEPS);
+  float light_dt = 1.0 / float(NUM_LIGHT_STEPS);
+  float transmittance = 1.0;
+  vec3 color = vec3(0.0);
+  for (int i = 0; i < NUM_STEPS; i++) {
+    vec3 p = cam_pos.xyz + rd * (t0 + (float(i) + 0.5) * dt);
+    float d = density(p);
+    if (d <= 0.0) {
+      continue;
+    }
+    // optical depth towards the sun
+    float tau = 0.0;
+    for (int j = 1; j <= NUM_LIGHT_STEPS; j++) {
+      tau += density(p + SUN_DIR * (float(j) * light_dt));
+    }
+    vec3 lit = mix(vec3(0.35, 0.4, 0.5), vec3(1.0, 0.97, 0.92), exp(-tau * light_dt));
+    float alpha = 1.0 - exp(-d * dt);
+    color += transmittance * alpha * lit;
+    transmittance *= 1.0 - alpha;
+    if (transmittance < 0.01) {
+      break;
+    }
+  }
+  frag_color = vec4(color + transmittance * sky, 1.0);
+}
+)";
+        _shader_desc.label = "raymarch-shader";
+        _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.uniform_blocks[0].size = sizeof(render_params_t);
+        _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT4, .glsl_name = "cam_pos" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_FLOAT4, .glsl_name = "cam_right" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_FLOAT4, .glsl_name = "cam_up" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[3] = { .type = SG_UNIFORMTYPE_FLOAT4, .glsl_name = "cam_forward" };
+        _shader_desc.images[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.images[0].image_type = SG_IMAGETYPE_3D;
+        _shader_desc.images[0].sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+        _shader_desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+        _shader_desc.image_sampler_pairs[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.image_sampler_pairs[0].image_slot = 0;
+        _shader_desc.image_sampler_pairs[0].sampler_slot = 0;
+        _shader_desc.image_sampler_pairs[0].glsl_name = "vol_tex";
+
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
+        _pipeline_desc.label = "raymarch-pipeline";
+        state.graphics.pip = sg_make_pipeline(&_pipeline_desc);
+
+        state.graphics.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.2f, 0.3f, 0.3f, 1.0f } };
+
+        // z wraps around the ring buffer
+        sg_sampler_desc _sg_sampler_desc{};
+        _sg_sampler_desc.min_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.mag_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+        _sg_sampler_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+        _sg_sampler_desc.wrap_w = SG_WRAP_REPEAT;
+        _sg_sampler_desc.label = "volume-sampler";
+        state.graphics.smp = sg_make_sampler(&_sg_sampler_desc);
+    }
+
+    state.camera = { 0.6f, 0.3f, 3.5f, false };
+    gpu_timer_init(&state.timer);
+    printf("noise3d: %d^3 volume, %s updates\n", state.config.size, update_mode_names[state.config.mode]);
+    fflush(stdout);
+}
+
+// generate num_slices domain slices starting at slice_first
+void generate_slices(int64_t slice_first, int num_slices) {
+    const cs_params_t params = { state.config.frequency, state.config.octaves, state.config.size, (int32_t)slice_first };
+    const uint32_t groups = ((uint32_t)state.config.size + NOISE3D_GROUP_SIZE - 1) / NOISE3D_GROUP_SIZE;
+    sg_pass _compute_pass = { .compute=true, .attachments=state.compute.atts, .label="noise3d-pass" };
+    sg_begin_pass(&_compute_pass);
+    sg_apply_pipeline(state.compute.pip);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    sg_dispatch((int)groups, (int)groups, num_slices);
+    sg_end_pass();
+    state.stats.updates++;
+    state.stats.slices += (uint64_t)num_slices;
+}
+
+// bring the volume to the domain slices [first, first + size)
+void update_volume(int64_t first) {
+    const int size = state.config.size;
+    if (state.valid && (first == state.first_slice)) {
+        return;
+    }
+    if (!state.valid || (state.config.mode == UPDATE_FULL) || (first - state.first_slice >= size)) {
+        generate_slices(first, size);
+    } else {
+        // the slices that moved in overwrite the ones that moved out
+        generate_slices(state.first_slice + size, (int)(first - state.first_slice));
+    }
+    state.first_slice = first;
+    state.valid = true;
+}
+
+void print_stats(double ms) {
+    const double voxels_per_slice = (double)state.config.size * state.config.size;
+    const double frames = state.timer.num_samples > 0 ? (double)state.timer.num_samples : 1.0;
+    printf("noise3d %-6s: %.3fms/frame | %llu updates, %.1f slices each | %.3fms/update | %.1f Mvoxel/s\n",
+        update_mode_names[state.config.mode],
+        ms,
+        (unsigned long long)state.stats.updates,
+        state.stats.updates > 0 ? (double)state.stats.slices / state.stats.updates : 0.0,
+        state.stats.updates > 0 ? ms * frames / state.stats.updates : 0.0,
+        ms > 0.0 ? state.stats.slices * voxels_per_slice / (ms * frames * 1.0e3) : 0.0);
+    fflush(stdout);
+}
+
+void reset_stats() {
+    gpu_timer_reset(&state.timer);
+    state.stats = {};
+}
+
+// the clouds move by one slice every frame, so that every frame is an
+// update, measured once with each mode, then quit
+void bench_frame() {
+    state.bench.frame++;
+    if (state.bench.frame == BENCH_WARMUP_FRAMES) {
+        reset_stats();
+    }
+    if ((state.bench.frame < BENCH_WARMUP_FRAMES) || (state.timer.num_samples < BENCH_MEASURE_FRAMES)) {
+        return;
+    }
+    print_stats(gpu_timer_ms(&state.timer, "noise"));
+    state.bench.mode++;
+    state.bench.frame = 0;
+    if (state.bench.mode >= NUM_UPDATE_MODES) {
+        sapp_request_quit();
+        return;
+    }
+    state.config.mode = (update_mode_t)state.bench.mode;
+}
+
+void frame() {
+    const double dt = sapp_frame_duration();
+
+    if (state.config.bench) {
+        state.scroll += 1.0;
+    } else if (state.animate) {
+        state.scroll += state.config.speed * dt;
+    }
+    const int64_t first = (int64_t)floor(state.scroll);
+
+    // always stamped, frames without an update measure close to zero so that
+    // the average is the cost per frame
+    gpu_timer_begin_frame(&state.timer);
+    update_volume(first);
+    gpu_timer_stamp(&state.timer, "noise");
+
+    // orbit camera, slowly turning on its own
+    if (!state.camera.dragging) {
+        state.camera.yaw += 0.05f * (float)dt;
+    }
+    const float cos_pitch = cosf(state.camera.pitch);
+    const HMM_Vec3 eye = HMM_V3(state.camera.distance * cos_pitch * sinf(state.camera.yaw),
+                                state.camera.distance * sinf(state.camera.pitch),
+                                state.camera.distance * cos_pitch * cosf(state.camera.yaw));
+    const HMM_Mat4 view = HMM_LookAt_RH(eye, HMM_V3(0.0f, 0.0f, 0.0f), HMM_V3(0.0f, 1.0f, 0.0f));
+
+    // the box shows the domain [scroll, scroll + size - 2], which stays
+    // inside the generated slices [first, first + size) for linear filtering
+    const float size = (float)state.config.size;
+    const float near_z = ((float)fmod(state.scroll, (double)size) + 0.5f) / size;
+    const render_params_t render_params = {
+        HMM_V4(eye.X, eye.Y, eye.Z, tanf(HMM_AngleDeg(30.0f))),
+        HMM_V4(view.Columns[0].X, view.Columns[1].X, view.Columns[2].X, sapp_widthf() / sapp_heightf()),
+        HMM_V4(view.Columns[0].Y, view.Columns[1].Y, view.Columns[2].Y, near_z),
+        HMM_V4(-view.Columns[0].Z, -view.Columns[1].Z, -view.Columns[2].Z, (size - 2.0f) / size),
+    };
+    sg_bindings _graphics_bindings{};
+    _graphics_bindings.images[0] = state.compute.img;
+    _graphics_bindings.samplers[0] = state.graphics.smp;
+    sg_pass _graphics_pass = { .action=state.graphics.pass_action, .swapchain=sglue_swapchain(), .label="render-pass" };
+    sg_begin_pass(&_graphics_pass);
+    sg_apply_pipeline(state.graphics.pip);
+    sg_apply_bindings(_graphics_bindings);
+    sg_apply_uniforms(0, SG_RANGE(render_params));
+    sg_draw(0, 6, 1);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "render");
+    sg_commit();
+
+    if (state.config.bench) {
+        bench_frame();
+        return;
+    }
+    state.frame_count++;
+    if ((state.frame_count % NOISE3D_REPORT_FRAMES == 0) && (state.timer.num_samples > 0)) {
+        print_stats(gpu_timer_ms(&state.timer, "noise"));
+        printf("noise3d: raymarch %.3fms/frame\n", gpu_timer_ms(&state.timer, "render"));
+        reset_stats();
+    }
+}
+
+void cleanup() {
+    sg_destroy_attachments(state.compute.atts);
+    sg_destroy_image(state.compute.img);
+    gpu_timer_shutdown(&state.timer);
+    sg_shutdown();
+}
+
+void input(const sapp_event* event) {
+    switch (event->type) {
+        case SAPP_EVENTTYPE_MOUSE_DOWN: {
+            if (event->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.camera.dragging = true;
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_UP: {
+            if (event->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.camera.dragging = false;
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_MOVE: {
+            if (state.camera.dragging) {
+                state.camera.yaw -= event->mouse_dx * 0.01f;
+                state.camera.pitch = std::clamp(state.camera.pitch + event->mouse_dy * 0.01f, -1.5f, 1.5f);
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_SCROLL: {
+            state.camera.distance = std::clamp(state.camera.distance - event->scroll_y * 0.2f, 2.0f, 8.0f);
+            break;
+        }
+        case SAPP_EVENTTYPE_KEY_DOWN: {
+            if (state.config.bench) {
+                break;
+            }
+            // space stops the clouds, U switches the update mode
+            if (event->key_code == SAPP_KEYCODE_SPACE) {
+                state.animate = !state.animate;
+            } else if (event->key_code == SAPP_KEYCODE_U) {
+                state.config.mode = (update_mode_t)((state.config.mode + 1) % NUM_UPDATE_MODES);
+                printf("noise3d: %s updates\n", update_mode_names[state.config.mode]);
+                reset_stats();
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+// options can be given on the command line or through environment variables:
+//   --size=N           NOISE3D_SIZE       edge length of the volume, 16 to 256 (default: 128)
+//   --update=M         NOISE3D_UPDATE     full or slices (default: slices)
+//   --speed=S          NOISE3D_SPEED      cloud movement in slices per second (default: 8)
+//   --octaves=N        NOISE3D_OCTAVES    fBm octaves, 1 to 8 (default: 5)
+//   --frequency=F      NOISE3D_FREQUENCY  noise cells across the volume (default: 4)
+//   --bench            NOISE3D_BENCH      time one update per frame with both modes, then quit
+void parse_args(int argc, char* argv[]) {
+    const char* size = getenv("NOISE3D_SIZE");
+    const char* update = getenv("NOISE3D_UPDATE");
+    const char* speed = getenv("NOISE3D_SPEED");
+    const char* octaves = getenv("NOISE3D_OCTAVES");
+    const char* frequency = getenv("NOISE3D_FREQUENCY");
+    state.config.bench = getenv("NOISE3D_BENCH") != nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--size=", 7)) {
+            size = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--update=", 9)) {
+            update = argv[i] + 9;
+        } else if (0 == strncmp(argv[i], "--speed=", 8)) {
+            speed = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--octaves=", 10)) {
+            octaves = argv[i] + 10;
+        } else if (0 == strncmp(argv[i], "--frequency=", 12)) {
+            frequency = argv[i] + 12;
+        } else if (0 == strcmp(argv[i], "--bench")) {
+            state.config.bench = true;
+        }
+    }
+    state.config.size = size ? std::clamp(atoi(size), MIN_VOLUME_SIZE, MAX_VOLUME_SIZE) : DEFAULT_VOLUME_SIZE;
+    state.config.mode = (update && (0 == strcmp(update, "full"))) ? UPDATE_FULL : UPDATE_SLICES;
+    state.config.speed = speed ? std::max((float)atof(speed), 0.0f) : 8.0f;
+    state.config.octaves = octaves ? std::clamp(atoi(octaves), 1, MAX_OCTAVES) : 5;
+    state.config.frequency = frequency ? std::max((float)atof(frequency), 0.0f) : 4.0f;
+    state.animate = true;
+    if (state.config.bench) {
+        state.config.mode = UPDATE_FULL;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    sapp_desc desc = {0};
+    desc.init_cb = init;
+    desc.frame_cb = frame;
+    desc.cleanup_cb = cleanup,
+    desc.event_cb = input,
+    desc.width  = SCREEN_WIDTH,
+    desc.height = SCREEN_HEIGHT,
+    desc.window_title = "sokol cs noise 3d (GL4.3)",
+    desc.icon.sokol_default = true,
+    desc.logger.func = slog_func;
+    sapp_run(&desc);
+
+    return 0;
+}
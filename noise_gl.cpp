@@ -1,6 +1,7 @@
 #define SOKOL_IMPL
 #define SOKOL_NO_ENTRY
 #define SOKOL_GLCORE
+#include "gl_ext.h"
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_glue.h"
@@ -8,14 +9,37 @@
 
 #include "HandmadeMath.h"
 
+#include "gpu_timer_gl.h"
+#include "mipgen_gl.h"
+#include "noise_lib_gl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 
 constexpr uint32_t SCREEN_WIDTH = 800;
 constexpr uint32_t SCREEN_HEIGHT = 600;
 
-struct cs_params_t{
-    float time;
-    HMM_Vec2 img_size;
+// print the cache counters every this many frames
+constexpr uint64_t NOISE_REPORT_FRAMES = 300;
+// noise cells across the image height of the coherent noises, white noise
+// uses one cell per pixel
+constexpr float NOISE_DEFAULT_FREQUENCY = 8.0f;
+
+// range of the display zoom, above 1 the image is minified and repeats
+constexpr float NOISE_MIN_ZOOM = 0.25f;
+constexpr float NOISE_MAX_ZOOM = 16.0f;
+
+constexpr int BENCH_WARMUP_FRAMES = 10;
+constexpr int BENCH_MEASURE_FRAMES = 60;
+
+// everything the image contents depend on
+struct noise_key_t {
+    noise_desc_t desc;
+    noise_params_t params;
 };
 
 struct particle_t{
@@ -24,20 +48,64 @@ struct particle_t{
     HMM_Vec4 color;
 };
 
+// the noise image is a pure function of its parameters, it is only generated
+// again when they differ from the ones of the current image contents
+struct noise_cache_t {
+    noise_key_t key;
+    bool valid;
+    uint64_t num_generated;
+    uint64_t num_reused;
+};
+
+// returns true when the image has to be generated for params
+bool noise_cache_update(noise_cache_t* c, const noise_key_t& key) {
+    if (c->valid && (0 == memcmp(&c->key, &key, sizeof(noise_key_t)))) {
+        c->num_reused++;
+        return false;
+    }
+    c->key = key;
+    c->valid = true;
+    c->num_generated++;
+    return true;
+}
+
 struct {
+    struct {
+        bool animate;
+        float rate_hz;
+        float frequency;        // 0: default of the noise type
+        bool mips;
+        float zoom;
+        bool bench;
+    } config;
+    float time;
+    uint64_t frame_count;
+    noise_cache_t cache;
+    struct {
+        int index;              // type * NUM_NOISE_FRACTALS + fractal
+        int frame;
+    } bench;
     struct {
         sg_image img;
         sg_attachments atts;
-        sg_pipeline pip;
-        cs_params_t params;
+        noise_lib_t lib;
+        noise_desc_t desc;
+        mipgen_t mipgen;
     } compute;
     struct {
         sg_pipeline pip;
         sg_pass_action pass_action;
         sg_sampler smp;
     } graphics;
+    gpu_timer_t timer;
 } state;
 
+void print_selection() {
+    const noise_desc_t desc = noise_desc_normalize(state.compute.desc);
+    printf("noise: %s, fractal %s, %d octaves\n", noise_type_name(desc.type), noise_fractal_name(desc.fractal), desc.octaves);
+    fflush(stdout);
+}
+
 void init() {
     sg_desc _sg_desc{};
     _sg_desc.environment = sglue_environment();
@@ -51,6 +119,7 @@ void init() {
         _sg_image_desc.width = SCREEN_WIDTH;
         _sg_image_desc.height = SCREEN_HEIGHT;
         _sg_image_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        _sg_image_desc.num_mipmaps = state.config.mips ? mipgen_num_mipmaps(SCREEN_WIDTH, SCREEN_HEIGHT) : 1;
         _sg_image_desc.label = "noise-image";
         state.compute.img = sg_make_image(&_sg_image_desc);
 
@@ -59,56 +128,8 @@ void init() {
         _sg_attachments_desc.label = "noise-attachments";
         state.compute.atts = sg_make_attachments(&_sg_attachments_desc);
 
-        sg_shader_desc _sg_compute_shader_desc{};
-        _sg_compute_shader_desc.compute_func.source = R"(
-#version 430
-uniform float time;
-uniform vec2 img_size;
-
-layout(binding=0, rgba8) uniform writeonly image2D cs_out_tex;
-layout(local_size_x=8, local_size_y=8, local_size_y=1) in;
-
-float hash12(vec2 p)
-{
-  vec3 p3 = fract(vec3(p.xyx) * .1031);
-  p3 += dot(p3, p3.yzx + 33.33);
-  return fract((p3.x + p3.y) * p3.z);
-}
-
-void main() {
-  uvec2 gid = gl_GlobalInvocationID.xy;
-  if (gid.x >= img_size.x || gid.y > img_size.y) {
-    return;
-  }
-
-  vec2 p = vec2(gl_GlobalInvocationID.xy + time);
-  imageStore(cs_out_tex, ivec2(gl_GlobalInvocationID.xy), vec4(hash12(p), hash12(p + (0.1f).xx), hash12(p + (0.2f).xx), 1.0f));
-}
-)";
-
-        _sg_compute_shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
-        _sg_compute_shader_desc.uniform_blocks[0].size = sizeof(cs_params_t);
-        _sg_compute_shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "time",  };
-        _sg_compute_shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_FLOAT2, .glsl_name = "img_size",  };
-
-        _sg_compute_shader_desc.storage_images[0].stage = SG_SHADERSTAGE_COMPUTE;
-        _sg_compute_shader_desc.storage_images[0].image_type = SG_IMAGETYPE_2D;
-        _sg_compute_shader_desc.storage_images[0].access_format = SG_PIXELFORMAT_RGBA8;
-        _sg_compute_shader_desc.storage_images[0].writeonly = true;
-        _sg_compute_shader_desc.storage_images[0].glsl_binding_n = 0;
-
-        _sg_compute_shader_desc.label = "compute-shader";
-
-        sg_shader compute_shd = sg_make_shader(&_sg_compute_shader_desc);
-
-        sg_pipeline_desc _compute_pipeline_desc{};
-        _compute_pipeline_desc.compute = true;
-        _compute_pipeline_desc.shader = compute_shd;
-        _compute_pipeline_desc.label = "compute-pipeline";
-
-        state.compute.pip = sg_make_pipeline(&_compute_pipeline_desc);
-
-        state.compute.params = { 0.0f, {SCREEN_WIDTH, SCREEN_HEIGHT}};
+        noise_lib_init(&state.compute.lib, SG_PIXELFORMAT_RGBA8);
+        mipgen_init(&state.compute.mipgen);
     }
 
     // graphics
@@ -137,15 +158,19 @@ void main() {
         _shader_desc.fragment_func.source = R"(
 #version 430 core
 layout(binding=0) uniform sampler2D disp_tex;
+uniform float zoom;
 layout(location=0) in vec2 vUV;
 out vec4 frag_color;
 
 void main() {
-  frag_color = vec4(texture(disp_tex, vUV).xyz, 1.0f);
+  frag_color = vec4(texture(disp_tex, (vUV - 0.5f) * zoom + 0.5f).xyz, 1.0f);
 }
 )";
 
         _shader_desc.label = "fragment-shader";
+        _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.uniform_blocks[0].size = sizeof(float);
+        _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "zoom" };
         _shader_desc.images[0].stage = SG_SHADERSTAGE_FRAGMENT;
         _shader_desc.images[0].image_type = SG_IMAGETYPE_2D;
         _shader_desc.images[0].sample_type = SG_IMAGESAMPLETYPE_FLOAT;
@@ -168,23 +193,98 @@ void main() {
         sg_sampler_desc _sg_sampler_desc{};
         _sg_sampler_desc.min_filter = SG_FILTER_LINEAR;
         _sg_sampler_desc.mag_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.mipmap_filter = SG_FILTER_LINEAR;
         _sg_sampler_desc.label = "Linear sampler";
         state.graphics.smp = sg_make_sampler(&_sg_sampler_desc);
     }
+
+    gpu_timer_init(&state.timer);
+    if (state.config.bench) {
+        state.compute.desc.type = NOISE_WHITE;
+        state.compute.desc.fractal = NOISE_FRACTAL_NONE;
+    } else {
+        print_selection();
+    }
  }
 
+void print_cache_stats() {
+    const uint64_t total = state.cache.num_generated + state.cache.num_reused;
+    printf("noise: %llu generated, %llu reused (%.1f%% of frames skipped the dispatch)\n",
+        (unsigned long long)state.cache.num_generated,
+        (unsigned long long)state.cache.num_reused,
+        total > 0 ? 100.0 * state.cache.num_reused / total : 0.0);
+    fflush(stdout);
+}
+
+// throughput of one image generation taking ms
+double noise_mpix_per_sec(double ms) {
+    return ms > 0.0 ? (double)SCREEN_WIDTH * SCREEN_HEIGHT / (ms * 1.0e3) : 0.0;
+}
+
+noise_key_t current_key() {
+    noise_key_t key{};
+    key.desc = noise_desc_normalize(state.compute.desc);
+    const float frequency = state.config.frequency > 0.0f ? state.config.frequency :
+        (key.desc.type == NOISE_WHITE ? (float)SCREEN_HEIGHT : NOISE_DEFAULT_FREQUENCY);
+    // with a rate the time only moves in steps, the frames in between reuse the image
+    const float time = state.config.rate_hz > 0.0f ? floorf(state.time * state.config.rate_hz) / state.config.rate_hz : state.time;
+    key.params = { time, frequency, 2.0f, 0.5f, HMM_V2((float)SCREEN_WIDTH, (float)SCREEN_HEIGHT), HMM_V2(0.0f, 0.0f), HMM_V2(0.0f, 0.0f) };
+    return key;
+}
+
+// time every type and fractal for BENCH_MEASURE_FRAMES frames each, then quit
+void bench_frame() {
+    state.bench.frame++;
+    if (state.bench.frame == BENCH_WARMUP_FRAMES) {
+        gpu_timer_reset(&state.timer);
+    }
+    if ((state.bench.frame < BENCH_WARMUP_FRAMES) || (state.timer.num_samples < BENCH_MEASURE_FRAMES)) {
+        return;
+    }
+    const noise_desc_t desc = noise_desc_normalize(state.compute.desc);
+    const double ms = gpu_timer_ms(&state.timer, "noise");
+    printf("noise %-8s %-11s %d octaves: gpu %.3fms | %8.1f Mpix/s\n",
+        noise_type_name(desc.type),
+        noise_fractal_name(desc.fractal),
+        desc.octaves,
+        ms,
+        noise_mpix_per_sec(ms));
+    fflush(stdout);
+
+    state.bench.index++;
+    state.bench.frame = 0;
+    if (state.bench.index >= (int)NUM_NOISE_TYPES * (int)NUM_NOISE_FRACTALS) {
+        sapp_request_quit();
+        return;
+    }
+    state.compute.desc.type = (noise_type_t)(state.bench.index / NUM_NOISE_FRACTALS);
+    state.compute.desc.fractal = (noise_fractal_t)(state.bench.index % NUM_NOISE_FRACTALS);
+}
+
 void frame() {
     const double dt = sapp_frame_duration();
 
-    state.compute.params.time += (float)dt;
-
-    // compute pass
-    sg_pass _compute_pass = { .compute=true, .attachments = state.compute.atts, .label="compute_pass" };
-    sg_begin_pass(&_compute_pass);
-    sg_apply_pipeline(state.compute.pip);
-    sg_apply_uniforms(0, SG_RANGE(state.compute.params));
-    sg_dispatch((SCREEN_WIDTH + 7)/8, (SCREEN_HEIGHT + 7)/8, 1);
-    sg_end_pass();
+    if (state.config.animate) {
+        state.time += (float)dt;
+    }
+    const noise_key_t key = current_key();
+
+    // compute pass, the benchmark measures every frame, otherwise a frame
+    // with the same key as the image contents skips it
+    gpu_timer_begin_frame(&state.timer);
+    if (noise_cache_update(&state.cache, key) || state.config.bench) {
+        noise_lib_pipeline(&state.compute.lib, key.desc);
+        sg_pass _compute_pass = { .compute=true, .attachments = state.compute.atts, .label="compute_pass" };
+        sg_begin_pass(&_compute_pass);
+        noise_lib_dispatch(&state.compute.lib, key.desc, key.params);
+        sg_end_pass();
+        gpu_timer_stamp(&state.timer, "noise");
+        // the zoomed out display samples the smaller levels
+        if (state.config.mips) {
+            mipgen_generate(&state.compute.mipgen, state.compute.img);
+            gpu_timer_stamp(&state.timer, "mips");
+        }
+    }
 
     // graphics pass
     sg_bindings _graphics_bindings{};
@@ -194,18 +294,138 @@ void frame() {
     sg_begin_pass(&_graphics_pass);
     sg_apply_pipeline(state.graphics.pip);
     sg_apply_bindings(_graphics_bindings);
+    sg_apply_uniforms(0, SG_RANGE(state.config.zoom));
     sg_draw(0, 6, 1);
     sg_end_pass();
     sg_commit();
+
+    if (state.config.bench) {
+        bench_frame();
+        return;
+    }
+    state.frame_count++;
+    if (state.frame_count % NOISE_REPORT_FRAMES == 0) {
+        print_cache_stats();
+        if (state.timer.num_samples > 0) {
+            const double ms = gpu_timer_ms(&state.timer, "noise");
+            printf("noise: gpu %.3fms | %.1f Mpix/s per generated frame\n", ms, noise_mpix_per_sec(ms));
+            if (state.config.mips) {
+                printf("noise: mip chain gpu %.3fms\n", gpu_timer_ms(&state.timer, "mips"));
+            }
+            gpu_timer_reset(&state.timer);
+        }
+    }
 }
 
 void cleanup() {
+    if (!state.config.bench) {
+        print_cache_stats();
+    }
+    mipgen_shutdown(&state.compute.mipgen);
+    noise_lib_shutdown(&state.compute.lib);
+    gpu_timer_shutdown(&state.timer);
     sg_shutdown();
 }
 
-void input(const sapp_event* event) {}
+void input(const sapp_event* event) {
+    if (state.config.bench) {
+        return;
+    }
+    // the mouse wheel zooms the display
+    if (event->type == SAPP_EVENTTYPE_MOUSE_SCROLL) {
+        state.config.zoom = std::clamp(state.config.zoom * powf(1.1f, -event->scroll_y), NOISE_MIN_ZOOM, NOISE_MAX_ZOOM);
+        return;
+    }
+    if (event->type != SAPP_EVENTTYPE_KEY_DOWN) {
+        return;
+    }
+    switch (event->key_code) {
+        // space pauses and resumes the animation
+        case SAPP_KEYCODE_SPACE: {
+            state.config.animate = !state.config.animate;
+            return;
+        }
+        // N and M cycle noise type and fractal, up and down change the octave count
+        case SAPP_KEYCODE_N: {
+            state.compute.desc.type = (noise_type_t)((state.compute.desc.type + 1) % NUM_NOISE_TYPES);
+            break;
+        }
+        case SAPP_KEYCODE_M: {
+            state.compute.desc.fractal = (noise_fractal_t)((state.compute.desc.fractal + 1) % NUM_NOISE_FRACTALS);
+            break;
+        }
+        case SAPP_KEYCODE_UP: {
+            state.compute.desc.octaves = std::min(state.compute.desc.octaves + 1, NOISE_MAX_OCTAVES);
+            break;
+        }
+        case SAPP_KEYCODE_DOWN: {
+            state.compute.desc.octaves = std::max(state.compute.desc.octaves - 1, 1);
+            break;
+        }
+        default: return;
+    }
+    print_selection();
+}
+
+// options can be given on the command line or through environment variables:
+//   --static           NOISE_STATIC     start with the animation paused, the image is generated once
+//   --rate=HZ          NOISE_RATE       advance the noise time HZ times per second instead of every frame
+//   --noise=TYPE       NOISE_TYPE       white, value, perlin, simplex or worley (default: white)
+//   --fractal=F        NOISE_FRACTAL    none, fbm, ridged or turbulence (default: none)
+//   --octaves=N        NOISE_OCTAVES    octaves of the fractal, 1 to 8 (default: 4)
+//   --frequency=F      NOISE_FREQUENCY  noise cells across the image height (default: 8, one per pixel for white)
+//   --zoom=Z           NOISE_ZOOM       display zoom, above 1 the image repeats minified (default: 1, mouse wheel)
+//   --no-mips          NOISE_NO_MIPS    don't generate the mip chain, minified sampling aliases
+//   --bench            NOISE_BENCH      print the GPU time and Mpix/s of every noise type and fractal, then quit
+void parse_args(int argc, char* argv[]) {
+    const char* rate = getenv("NOISE_RATE");
+    const char* type = getenv("NOISE_TYPE");
+    const char* fractal = getenv("NOISE_FRACTAL");
+    const char* octaves = getenv("NOISE_OCTAVES");
+    const char* frequency = getenv("NOISE_FREQUENCY");
+    const char* zoom = getenv("NOISE_ZOOM");
+    state.config.mips = getenv("NOISE_NO_MIPS") == nullptr;
+    state.config.animate = getenv("NOISE_STATIC") == nullptr;
+    state.config.bench = getenv("NOISE_BENCH") != nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--static")) {
+            state.config.animate = false;
+        } else if (0 == strncmp(argv[i], "--rate=", 7)) {
+            rate = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--noise=", 8)) {
+            type = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--fractal=", 10)) {
+            fractal = argv[i] + 10;
+        } else if (0 == strncmp(argv[i], "--octaves=", 10)) {
+            octaves = argv[i] + 10;
+        } else if (0 == strncmp(argv[i], "--frequency=", 12)) {
+            frequency = argv[i] + 12;
+        } else if (0 == strncmp(argv[i], "--zoom=", 7)) {
+            zoom = argv[i] + 7;
+        } else if (0 == strcmp(argv[i], "--no-mips")) {
+            state.config.mips = false;
+        } else if (0 == strcmp(argv[i], "--bench")) {
+            state.config.bench = true;
+        }
+    }
+    state.config.rate_hz = rate ? std::max((float)atof(rate), 0.0f) : 0.0f;
+    state.config.frequency = frequency ? std::max((float)atof(frequency), 0.0f) : 0.0f;
+    state.config.zoom = zoom ? std::clamp((float)atof(zoom), NOISE_MIN_ZOOM, NOISE_MAX_ZOOM) : 1.0f;
+    state.compute.desc = { NOISE_WHITE, NOISE_FRACTAL_NONE, 4 };
+    if (type && !noise_type_parse(type, &state.compute.desc.type)) {
+        printf("unknown noise type '%s'\n", type);
+    }
+    if (fractal && !noise_fractal_parse(fractal, &state.compute.desc.fractal)) {
+        printf("unknown fractal '%s'\n", fractal);
+    }
+    if (octaves) {
+        state.compute.desc.octaves = std::clamp(atoi(octaves), 1, NOISE_MAX_OCTAVES);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
 
-int main() {
     sapp_desc desc = {0};
     desc.init_cb = init;
     desc.frame_cb = frame;
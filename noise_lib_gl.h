@@ -0,0 +1,351 @@
+#pragma once
+// 2D noise generators as compute pipelines (requires HandmadeMath.h).
+//
+// Every combination of base noise (white, value, Perlin, simplex, Worley),
+// fractal (none, fBm, ridged, turbulence) and octave count gets its own
+// pipeline, built on first use from source in which the noise function is
+// chosen and the octave count is a constant, so the kernels contain no
+// runtime branches on either and the octave loop can be unrolled. The
+// kernel writes grayscale into the storage attachment at binding 0, in
+// [0, 1]. noise_lib_dispatch() only records the dispatch and must be called
+// inside a compute pass with that attachment, call noise_lib_pipeline() before
+// the pass to build a pipeline that wasn't used yet outside of it.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+enum noise_type_t {
+    NOISE_WHITE,
+    NOISE_VALUE,
+    NOISE_PERLIN,
+    NOISE_SIMPLEX,
+    NOISE_WORLEY,
+    NUM_NOISE_TYPES,
+};
+
+enum noise_fractal_t {
+    NOISE_FRACTAL_NONE,         // one octave of the base noise
+    NOISE_FRACTAL_FBM,          // sum of octaves
+    NOISE_FRACTAL_RIDGED,       // sum of (1 - |noise|)^2, sharp crests
+    NOISE_FRACTAL_TURBULENCE,   // sum of |noise|, creases
+    NUM_NOISE_FRACTALS,
+};
+
+constexpr int NOISE_MAX_OCTAVES = 8;
+constexpr uint32_t NOISE_GROUP_SIZE = 8;
+
+struct noise_desc_t {
+    noise_type_t type;
+    noise_fractal_t fractal;
+    int32_t octaves;            // ignored for NOISE_FRACTAL_NONE
+};
+
+// the noise is evaluated at (pixel + origin) * frequency / img_size.y + time
+// and written to pixel + dst_offset, so tiles of a larger domain can be
+// generated into an atlas
+struct noise_params_t {
+    float time;
+    float frequency;            // noise cells across the image height
+    float lacunarity;           // frequency factor between octaves
+    float gain;                 // amplitude factor between octaves
+    HMM_Vec2 img_size;          // size of the generated region
+    HMM_Vec2 origin;            // domain position of its first pixel
+    HMM_Vec2 dst_offset;        // where it goes in the storage image
+};
+
+// uniforms of the single octave kernels, which don't declare lacunarity and
+// gain, filled in from noise_params_t by noise_lib_dispatch()
+struct noise_octave_params_t {
+    float time;
+    float frequency;
+    HMM_Vec2 img_size;
+    HMM_Vec2 origin;
+    HMM_Vec2 dst_offset;
+};
+
+struct noise_lib_t {
+    // created on first use
+    sg_pipeline pips[NUM_NOISE_TYPES][NUM_NOISE_FRACTALS][NOISE_MAX_OCTAVES];
+    sg_pixel_format format;
+};
+
+inline const char* noise_type_name(noise_type_t type) {
+    static const char* names[NUM_NOISE_TYPES] = { "white", "value", "perlin", "simplex", "worley" };
+    return names[type];
+}
+
+inline const char* noise_fractal_name(noise_fractal_t fractal) {
+    static const char* names[NUM_NOISE_FRACTALS] = { "none", "fbm", "ridged", "turbulence" };
+    return names[fractal];
+}
+
+inline bool noise_type_parse(const char* str, noise_type_t* type) {
+    for (int i = 0; i < NUM_NOISE_TYPES; i++) {
+        if (0 == strcmp(str, noise_type_name((noise_type_t)i))) {
+            *type = (noise_type_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool noise_fractal_parse(const char* str, noise_fractal_t* fractal) {
+    for (int i = 0; i < NUM_NOISE_FRACTALS; i++) {
+        if (0 == strcmp(str, noise_fractal_name((noise_fractal_t)i))) {
+            *fractal = (noise_fractal_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// GLSL image format qualifier of a storage attachment, null if the format
+// can't be written by the noise kernels
+inline const char* noise_glsl_format(sg_pixel_format format) {
+    switch (format) {
+        case SG_PIXELFORMAT_R16F: return "r16f";
+        case SG_PIXELFORMAT_R32F: return "r32f";
+        case SG_PIXELFORMAT_RG16F: return "rg16f";
+        case SG_PIXELFORMAT_RG32F: return "rg32f";
+        case SG_PIXELFORMAT_RGBA8: return "rgba8";
+        case SG_PIXELFORMAT_RGBA8SN: return "rgba8_snorm";
+        case SG_PIXELFORMAT_RGBA16F: return "rgba16f";
+        case SG_PIXELFORMAT_RGBA32F: return "rgba32f";
+        default: return nullptr;
+    }
+}
+
+// clamps the octave count, a single octave for NOISE_FRACTAL_NONE
+inline noise_desc_t noise_desc_normalize(noise_desc_t desc) {
+    desc.octaves = desc.fractal == NOISE_FRACTAL_NONE ? 1 : (desc.octaves < 1 ? 1 : (desc.octaves > NOISE_MAX_OCTAVES ? NOISE_MAX_OCTAVES : desc.octaves));
+    return desc;
+}
+
+// format must be one noise_glsl_format() knows
+inline std::string noise_lib_source(const noise_desc_t& desc, sg_pixel_format format) {
+    const char* format_name = noise_glsl_format(format);
+
+    // base noise, in [-1, 1]
+    static const char* base_noise[NUM_NOISE_TYPES] = {
+        // white: a fresh hash at every point
+        "float base_noise(vec2 p) { return hash12(p) * 2.0 - 1.0; }\n",
+        // value: smooth interpolation of random lattice values
+        R"(
+float base_noise(vec2 p) {
+  vec2 i = floor(p);
+  vec2 f = fract(p);
+  vec2 u = f * f * (3.0 - 2.0 * f);
+  float a = hash12(i);
+  float b = hash12(i + vec2(1.0, 0.0));
+  float c = hash12(i + vec2(0.0, 1.0));
+  float d = hash12(i + vec2(1.0, 1.0));
+  return mix(mix(a, b, u.x), mix(c, d, u.x), u.y) * 2.0 - 1.0;
+}
+)",
+        // Perlin: random lattice gradients, quintic fade
+        R"(
+float base_noise(vec2 p) {
+  vec2 i = floor(p);
+  vec2 f = fract(p);
+  vec2 u = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+  float a = dot(grad(i), f);
+  float b = dot(grad(i + vec2(1.0, 0.0)), f - vec2(1.0, 0.0));
+  float c = dot(grad(i + vec2(0.0, 1.0)), f - vec2(0.0, 1.0));
+  float d = dot(grad(i + vec2(1.0, 1.0)), f - vec2(1.0, 1.0));
+  return 1.41421356 * mix(mix(a, b, u.x), mix(c, d, u.x), u.y);
+}
+)",
+        // simplex: gradients on a skewed triangle grid, three corners per point
+        R"(
+float base_noise(vec2 p) {
+  const float K1 = 0.366025404;   // (sqrt(3) - 1) / 2
+  const float K2 = 0.211324865;   // (3 - sqrt(3)) / 6
+  vec2 i = floor(p + (p.x + p.y) * K1);
+  vec2 a = p - i + (i.x + i.y) * K2;
+  vec2 o = (a.x > a.y) ? vec2(1.0, 0.0) : vec2(0.0, 1.0);
+  vec2 b = a - o + K2;
+  vec2 c = a - 1.0 + 2.0 * K2;
+  vec3 h = max(0.5 - vec3(dot(a, a), dot(b, b), dot(c, c)), 0.0);
+  vec3 n = h * h * h * h * vec3(dot(a, grad(i)), dot(b, grad(i + o)), dot(c, grad(i + 1.0)));
+  return dot(n, vec3(70.0));
+}
+)",
+        // Worley: distance to the closest random feature point of the 3x3 cells
+        // around, F1 is at most the cell diagonal
+        R"(
+float base_noise(vec2 p) {
+  vec2 i = floor(p);
+  vec2 f = fract(p);
+  float d = 8.0;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      vec2 o = vec2(float(x), float(y));
+      vec2 r = o + hash22(i + o) - f;
+      d = min(d, dot(r, r));
+    }
+  }
+  return min(sqrt(d) * 0.70710678, 1.0) * 2.0 - 1.0;
+}
+)",
+    };
+
+    // one octave on the base noise clamped to [-1, 1] (the gradient noises
+    // overshoot slightly), so every octave of fBm is in [-1, 1] and of ridged
+    // and turbulence in [0, 1]. The sum is divided by the sum of the octave
+    // amplitudes, which keeps it in the same range, and fBm is mapped to [0, 1]
+    static const char* octave[NUM_NOISE_FRACTALS] = {
+        "float octave(vec2 p) { return clamp(base_noise(p), -1.0, 1.0); }\n",
+        "float octave(vec2 p) { return clamp(base_noise(p), -1.0, 1.0); }\n",
+        "float octave(vec2 p) { float r = 1.0 - abs(clamp(base_noise(p), -1.0, 1.0)); return r * r; }\n",
+        "float octave(vec2 p) { return abs(clamp(base_noise(p), -1.0, 1.0)); }\n",
+    };
+    const bool signed_sum = (desc.fractal == NOISE_FRACTAL_NONE) || (desc.fractal == NOISE_FRACTAL_FBM);
+
+    // a single octave has no use for lacunarity and gain, GL would drop them
+    const char* fractal_sum = desc.octaves == 1 ? R"(
+float fractal(vec2 p) {
+  return octave(p);
+}
+)" : R"(
+uniform float lacunarity;
+uniform float gain;
+
+float fractal(vec2 p) {
+  float sum = 0.0;
+  float amp = 1.0;
+  float norm = 0.0;
+  for (int i = 0; i < OCTAVES; i++) {
+    sum += amp * octave(p);
+    norm += amp;
+    amp *= gain;
+    p *= lacunarity;
+  }
+  return sum / norm;
+}
+)";
+
+    return std::string(R"(
+#version 430
+uniform float time;
+uniform float frequency;
+uniform vec2 img_size;
+uniform vec2 origin;
+uniform vec2 dst_offset;
+
+layout(binding=0, )") + format_name + R"() uniform writeonly image2D cs_out_tex;
+layout(local_size_x=8, local_size_y=8, local_size_z=1) in;
+
+const int OCTAVES = )" + std::to_string(desc.octaves) + R"(;
+
+float hash12(vec2 p)
+{
+  vec3 p3 = fract(vec3(p.xyx) * .1031);
+  p3 += dot(p3, p3.yzx + 33.33);
+  return fract((p3.x + p3.y) * p3.z);
+}
+
+vec2 hash22(vec2 p)
+{
+  vec3 p3 = fract(vec3(p.xyx) * vec3(.1031, .1030, .0973));
+  p3 += dot(p3, p3.yzx + 33.33);
+  return fract((p3.xx + p3.yz) * p3.zy);
+}
+
+// unit gradient of a lattice point
+vec2 grad(vec2 i) {
+  float a = 6.28318530718 * hash12(i);
+  return vec2(cos(a), sin(a));
+}
+)" + base_noise[desc.type] + octave[desc.fractal] + fractal_sum + R"(
+void main() {
+  uvec2 gid = gl_GlobalInvocationID.xy;
+  if (gid.x >= uint(img_size.x) || gid.y >= uint(img_size.y)) {
+    return;
+  }
+  vec2 p = (vec2(gid) + origin) * (frequency / img_size.y) + time;
+  float v = )" + (signed_sum ? "0.5 + 0.5 * fractal(p)" : "fractal(p)") + R"(;
+  imageStore(cs_out_tex, ivec2(gid) + ivec2(dst_offset), vec4(v, v, v, 1.0));
+}
+)";
+}
+
+inline void noise_lib_init(noise_lib_t* lib, sg_pixel_format format = SG_PIXELFORMAT_RGBA8) {
+    *lib = {};
+    lib->format = format;
+    if (!noise_glsl_format(format)) {
+        printf("noise: unsupported pixel format %d\n", (int)format);
+    }
+}
+
+inline void noise_lib_shutdown(noise_lib_t* lib) {
+    for (int t = 0; t < NUM_NOISE_TYPES; t++) {
+        for (int f = 0; f < NUM_NOISE_FRACTALS; f++) {
+            for (int o = 0; o < NOISE_MAX_OCTAVES; o++) {
+                if (lib->pips[t][f][o].id != SG_INVALID_ID) {
+                    sg_destroy_pipeline(lib->pips[t][f][o]);
+                }
+            }
+        }
+    }
+}
+
+// an invalid pipeline if the format of the library is unsupported
+inline sg_pipeline noise_lib_pipeline(noise_lib_t* lib, noise_desc_t desc) {
+    desc = noise_desc_normalize(desc);
+    sg_pipeline& pip = lib->pips[desc.type][desc.fractal][desc.octaves - 1];
+    if ((pip.id != SG_INVALID_ID) || !noise_glsl_format(lib->format)) {
+        return pip;
+    }
+    const std::string source = noise_lib_source(desc, lib->format);
+    const std::string label = std::string("noise-") + noise_type_name(desc.type) + "-" + noise_fractal_name(desc.fractal) + "-" + std::to_string(desc.octaves);
+
+    sg_shader_desc _shader_desc{};
+    _shader_desc.compute_func.source = source.c_str();
+    _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+    sg_glsl_shader_uniform* uniforms = _shader_desc.uniform_blocks[0].glsl_uniforms;
+    int n = 0;
+    uniforms[n++] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "time" };
+    uniforms[n++] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "frequency" };
+    if (desc.octaves > 1) {
+        uniforms[n++] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "lacunarity" };
+        uniforms[n++] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "gain" };
+        _shader_desc.uniform_blocks[0].size = sizeof(noise_params_t);
+    } else {
+        _shader_desc.uniform_blocks[0].size = sizeof(noise_octave_params_t);
+    }
+    uniforms[n++] = { .type = SG_UNIFORMTYPE_FLOAT2, .glsl_name = "img_size" };
+    uniforms[n++] = { .type = SG_UNIFORMTYPE_FLOAT2, .glsl_name = "origin" };
+    uniforms[n++] = { .type = SG_UNIFORMTYPE_FLOAT2, .glsl_name = "dst_offset" };
+    _shader_desc.storage_images[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.storage_images[0].image_type = SG_IMAGETYPE_2D;
+    _shader_desc.storage_images[0].access_format = lib->format;
+    _shader_desc.storage_images[0].writeonly = true;
+    _shader_desc.storage_images[0].glsl_binding_n = 0;
+    _shader_desc.label = label.c_str();
+
+    sg_pipeline_desc _pipeline_desc{};
+    _pipeline_desc.compute = true;
+    _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+    _pipeline_desc.label = label.c_str();
+    pip = sg_make_pipeline(&_pipeline_desc);
+    return pip;
+}
+
+inline void noise_lib_dispatch(noise_lib_t* lib, const noise_desc_t& desc, const noise_params_t& params) {
+    const sg_pipeline pip = noise_lib_pipeline(lib, desc);
+    if (pip.id == SG_INVALID_ID) {
+        return;
+    }
+    sg_apply_pipeline(pip);
+    if (noise_desc_normalize(desc).octaves > 1) {
+        sg_apply_uniforms(0, SG_RANGE(params));
+    } else {
+        const noise_octave_params_t octave_params = { params.time, params.frequency, params.img_size, params.origin, params.dst_offset };
+        sg_apply_uniforms(0, SG_RANGE(octave_params));
+    }
+    const uint32_t width = (uint32_t)params.img_size.X;
+    const uint32_t height = (uint32_t)params.img_size.Y;
+    sg_dispatch((int)((width + NOISE_GROUP_SIZE - 1) / NOISE_GROUP_SIZE), (int)((height + NOISE_GROUP_SIZE - 1) / NOISE_GROUP_SIZE), 1);
+}
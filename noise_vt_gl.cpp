@@ -0,0 +1,474 @@
+#define SOKOL_IMPL
+#define SOKOL_NO_ENTRY
+#define SOKOL_GLCORE
+#include "gl_ext.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_log.h"
+
+#include "HandmadeMath.h"
+
+#include "gpu_timer_gl.h"
+#include "noise_lib_gl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+constexpr uint32_t SCREEN_WIDTH = 800;
+constexpr uint32_t SCREEN_HEIGHT = 600;
+
+// a tile is TILE_SIZE texels in the atlas, the outer texel on every side
+// repeats the neighbouring tile's domain so that filtering is seamless
+constexpr int TILE_SIZE = 128;
+constexpr int TILE_BORDER = 1;
+constexpr int TILE_CONTENT = TILE_SIZE - 2 * TILE_BORDER;
+constexpr int ATLAS_TILES = 16;
+constexpr int ATLAS_SIZE = TILE_SIZE * ATLAS_TILES;
+constexpr int ATLAS_SLOTS = ATLAS_TILES * ATLAS_TILES;
+
+constexpr uint32_t DEFAULT_TILE_BUDGET = 8;
+// the view never needs more tiles than the atlas holds
+constexpr float MIN_ZOOM = 0.5f;
+constexpr float MAX_ZOOM = 4.0f;
+constexpr float PAN_SPEED = 60.0f;          // domain pixels per second
+// print the cache counters every this many frames
+constexpr uint64_t REPORT_FRAMES = 300;
+
+// one quad per visible tile
+struct tile_instance_t {
+    HMM_Vec4 rect;      // clip space min xy, max xy
+    HMM_Vec4 uv;        // atlas uv min xy, max xy, x < 0 if not resident
+};
+
+struct atlas_slot_t {
+    int64_t key;        // tile of the slot, -1 if empty
+    uint64_t last_used; // frame index
+};
+
+// GLnoisevt: a virtual noise texture over an unbounded domain. The domain is
+// split into TILE_CONTENT sized tiles, resident tiles live in slots of a
+// fixed atlas image and the page table maps tile coordinates to slots. Every
+// frame the visible tiles are looked up, the missing ones nearest to the view
+// center are generated into the least recently used slots, at most
+// config.budget per frame, the rest show a placeholder until a later frame.
+struct {
+    struct {
+        noise_desc_t desc;
+        float frequency;
+        uint32_t budget;
+    } config;
+    uint64_t frame_index;
+    struct {
+        HMM_Vec2 center;        // domain pixels
+        float zoom;             // screen pixels per domain pixel
+        bool dragging;
+        bool paused;
+    } view;
+    struct {
+        sg_image img;
+        sg_attachments atts;
+        atlas_slot_t slots[ATLAS_SLOTS];
+        std::unordered_map<int64_t, int> page_table;
+    } atlas;
+    struct {
+        noise_lib_t lib;
+    } compute;
+    struct {
+        sg_buffer instances;
+        sg_pipeline pip;
+        sg_sampler smp;
+        sg_pass_action pass_action;
+    } graphics;
+    struct {
+        uint64_t lookups;
+        uint64_t hits;
+        uint64_t generated;
+        uint64_t evicted;
+        uint64_t deferred;      // missing tiles left for a later frame
+        uint64_t timed_frames;
+        uint64_t timed_tiles;
+    } stats;
+    gpu_timer_t timer;
+} state;
+
+// tile coordinates packed into one key, 32 bits each
+int64_t tile_key(int32_t x, int32_t y) {
+    return (int64_t)(((uint64_t)(uint32_t)x << 32) | (uint32_t)y);
+}
+
+// atlas uv range of the tile content in a slot, without the border
+HMM_Vec4 slot_uv(int slot) {
+    const float u = (float)(slot % ATLAS_TILES * TILE_SIZE + TILE_BORDER) / ATLAS_SIZE;
+    const float v = (float)(slot / ATLAS_TILES * TILE_SIZE + TILE_BORDER) / ATLAS_SIZE;
+    return HMM_V4(u, v, u + (float)TILE_CONTENT / ATLAS_SIZE, v + (float)TILE_CONTENT / ATLAS_SIZE);
+}
+
+// the least recently used slot not needed this frame, -1 if all are
+int find_lru_slot() {
+    int best = -1;
+    for (int i = 0; i < ATLAS_SLOTS; i++) {
+        const atlas_slot_t& slot = state.atlas.slots[i];
+        if (slot.key == -1) {
+            return i;
+        }
+        if ((slot.last_used != state.frame_index) && ((best < 0) || (slot.last_used < state.atlas.slots[best].last_used))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void init() {
+    sg_desc _sg_desc{};
+    _sg_desc.environment = sglue_environment();
+    _sg_desc.logger.func = slog_func;
+    sg_setup(&_sg_desc);
+
+    // atlas
+    {
+        sg_image_desc _sg_image_desc{};
+        _sg_image_desc.usage.storage_attachment = true;
+        _sg_image_desc.width = ATLAS_SIZE;
+        _sg_image_desc.height = ATLAS_SIZE;
+        _sg_image_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        _sg_image_desc.label = "tile-atlas";
+        state.atlas.img = sg_make_image(&_sg_image_desc);
+
+        sg_attachments_desc _sg_attachments_desc{};
+        _sg_attachments_desc.storages[0].image = state.atlas.img;
+        _sg_attachments_desc.label = "tile-atlas-attachments";
+        state.atlas.atts = sg_make_attachments(&_sg_attachments_desc);
+
+        for (atlas_slot_t& slot : state.atlas.slots) {
+            slot = { -1, 0 };
+        }
+        noise_lib_init(&state.compute.lib, SG_PIXELFORMAT_RGBA8);
+    }
+
+    // graphics
+    {
+        sg_buffer_desc _sg_buffer_desc{};
+        _sg_buffer_desc.usage.storage_buffer = true;
+        _sg_buffer_desc.usage.stream_update = true;
+        _sg_buffer_desc.size = sizeof(tile_instance_t) * ATLAS_SLOTS;
+        _sg_buffer_desc.label = "tile-instances";
+        state.graphics.instances = sg_make_buffer(&_sg_buffer_desc);
+
+        sg_shader_desc _shader_desc{};
+        _shader_desc.vertex_func.source = R"(
+#version 430 core
+struct tile_t {
+  vec4 rect;
+  vec4 uv;
+};
+layout(std430, binding=0) readonly buffer tiles_ssbo {
+  tile_t tiles[];
+};
+layout(location=0) out vec2 vUV;
+layout(location=1) flat out float vResident;
+
+const vec2 corners[6] = { {0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}, {1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0} };
+
+void main() {
+  tile_t tile = tiles[gl_InstanceID];
+  vec2 corner = corners[gl_VertexID];
+  gl_Position = vec4(mix(tile.rect.xy, tile.rect.zw, corner), 0.0, 1.0);
+  vUV = mix(tile.uv.xy, tile.uv.zw, corner);
+  vResident = tile.uv.x < 0.0 ? 0.0 : 1.0;
+}
+)";
+        _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(binding=0) uniform sampler2D atlas_tex;
+layout(location=0) in vec2 vUV;
+layout(location=1) flat in float vResident;
+out vec4 frag_color;
+
+void main() {
+  // tiles that aren't generated yet show as a flat placeholder
+  frag_color = vResident > 0.0 ? vec4(texture(atlas_tex, vUV).xyz, 1.0) : vec4(0.15, 0.15, 0.18, 1.0);
+}
+)";
+        _shader_desc.storage_buffers[0].stage = SG_SHADERSTAGE_VERTEX;
+        _shader_desc.storage_buffers[0].readonly = true;
+        _shader_desc.storage_buffers[0].glsl_binding_n = 0;
+        _shader_desc.images[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.images[0].image_type = SG_IMAGETYPE_2D;
+        _shader_desc.images[0].sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+        _shader_desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+        _shader_desc.image_sampler_pairs[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.image_sampler_pairs[0].image_slot = 0;
+        _shader_desc.image_sampler_pairs[0].sampler_slot = 0;
+        _shader_desc.image_sampler_pairs[0].glsl_name = "atlas_tex";
+        _shader_desc.label = "tile-shader";
+
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
+        _pipeline_desc.label = "tile-pipeline";
+        state.graphics.pip = sg_make_pipeline(&_pipeline_desc);
+
+        sg_sampler_desc _sg_sampler_desc{};
+        _sg_sampler_desc.min_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.mag_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+        _sg_sampler_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+        _sg_sampler_desc.label = "Linear sampler";
+        state.graphics.smp = sg_make_sampler(&_sg_sampler_desc);
+
+        state.graphics.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.0f, 0.0f, 0.0f, 1.0f} };
+    }
+
+    state.view.zoom = 1.0f;
+    gpu_timer_init(&state.timer);
+}
+
+void print_stats() {
+    const double hit_rate = state.stats.lookups > 0 ? 100.0 * state.stats.hits / state.stats.lookups : 0.0;
+    printf("tiles: %zu resident | hit rate %.1f%% | %llu generated, %llu evicted, %llu deferred",
+        state.atlas.page_table.size(),
+        hit_rate,
+        (unsigned long long)state.stats.generated,
+        (unsigned long long)state.stats.evicted,
+        (unsigned long long)state.stats.deferred);
+    if ((state.timer.num_samples > 0) && (state.stats.timed_tiles > 0)) {
+        // the timer averages over the frames that generated tiles
+        const double frame_ms = gpu_timer_ms(&state.timer, "tiles");
+        const double tiles_per_frame = (double)state.stats.timed_tiles / state.stats.timed_frames;
+        const double tile_ms = frame_ms / tiles_per_frame;
+        printf(" | gpu %.3fms per frame, %.3fms per tile, %.1f Mpix/s",
+            frame_ms,
+            tile_ms,
+            (double)TILE_SIZE * TILE_SIZE / (tile_ms * 1.0e3));
+    }
+    printf("\n");
+    fflush(stdout);
+    state.stats = {};
+    gpu_timer_reset(&state.timer);
+}
+
+void frame() {
+    const double dt = sapp_frame_duration();
+    state.frame_index++;
+    if (!state.view.dragging && !state.view.paused) {
+        state.view.center.X += PAN_SPEED * (float)dt;
+    }
+
+    // visible tile range
+    const float half_w = 0.5f * sapp_widthf() / state.view.zoom;
+    const float half_h = 0.5f * sapp_heightf() / state.view.zoom;
+    const int32_t x0 = (int32_t)floorf((state.view.center.X - half_w) / TILE_CONTENT);
+    const int32_t x1 = (int32_t)floorf((state.view.center.X + half_w) / TILE_CONTENT);
+    const int32_t y0 = (int32_t)floorf((state.view.center.Y - half_h) / TILE_CONTENT);
+    const int32_t y1 = (int32_t)floorf((state.view.center.Y + half_h) / TILE_CONTENT);
+
+    // look up every visible tile, collect the missing ones
+    struct missing_t { int32_t x, y; float dist; int instance; };
+    std::vector<missing_t> missing;
+    std::vector<tile_instance_t> instances;
+    for (int32_t y = y0; y <= y1; y++) {
+        for (int32_t x = x0; x <= x1; x++) {
+            if (instances.size() >= (size_t)ATLAS_SLOTS) {
+                break;
+            }
+            const float tx = (float)x * TILE_CONTENT;
+            const float ty = (float)y * TILE_CONTENT;
+            tile_instance_t inst;
+            inst.rect = HMM_V4((tx - state.view.center.X) / half_w,
+                               -(ty - state.view.center.Y) / half_h,
+                               (tx + TILE_CONTENT - state.view.center.X) / half_w,
+                               -(ty + TILE_CONTENT - state.view.center.Y) / half_h);
+            inst.uv = HMM_V4(-1.0f, -1.0f, -1.0f, -1.0f);
+            state.stats.lookups++;
+            const auto it = state.atlas.page_table.find(tile_key(x, y));
+            if (it != state.atlas.page_table.end()) {
+                state.stats.hits++;
+                state.atlas.slots[it->second].last_used = state.frame_index;
+                inst.uv = slot_uv(it->second);
+            } else {
+                const float dx = tx + 0.5f * TILE_CONTENT - state.view.center.X;
+                const float dy = ty + 0.5f * TILE_CONTENT - state.view.center.Y;
+                missing.push_back({ x, y, dx * dx + dy * dy, (int)instances.size() });
+            }
+            instances.push_back(inst);
+        }
+    }
+    std::sort(missing.begin(), missing.end(), [](const missing_t& a, const missing_t& b) { return a.dist < b.dist; });
+
+    // generate the nearest missing tiles within the budget
+    gpu_timer_begin_frame(&state.timer);
+    const noise_desc_t desc = noise_desc_normalize(state.config.desc);
+    noise_lib_pipeline(&state.compute.lib, desc);
+    uint32_t num_generated = 0;
+    for (const missing_t& m : missing) {
+        if (num_generated >= state.config.budget) {
+            state.stats.deferred++;
+            continue;
+        }
+        const int slot = find_lru_slot();
+        if (slot < 0) {
+            state.stats.deferred++;
+            continue;
+        }
+        if (state.atlas.slots[slot].key != -1) {
+            state.atlas.page_table.erase(state.atlas.slots[slot].key);
+            state.stats.evicted++;
+        }
+        if (num_generated == 0) {
+            sg_pass _compute_pass = { .compute=true, .attachments = state.atlas.atts, .label="tile-pass" };
+            sg_begin_pass(&_compute_pass);
+        }
+        // the tile is static, time stays 0 so that it never goes stale
+        const noise_params_t params = {
+            0.0f,
+            state.config.frequency,
+            2.0f,
+            0.5f,
+            HMM_V2((float)TILE_SIZE, (float)TILE_SIZE),
+            HMM_V2((float)m.x * TILE_CONTENT - TILE_BORDER, (float)m.y * TILE_CONTENT - TILE_BORDER),
+            HMM_V2((float)(slot % ATLAS_TILES * TILE_SIZE), (float)(slot / ATLAS_TILES * TILE_SIZE)),
+        };
+        noise_lib_dispatch(&state.compute.lib, desc, params);
+
+        state.atlas.slots[slot] = { tile_key(m.x, m.y), state.frame_index };
+        state.atlas.page_table[tile_key(m.x, m.y)] = slot;
+        state.stats.generated++;
+        num_generated++;
+        // the atlas pass finishes before the graphics pass, the tile can be drawn this frame
+        instances[m.instance].uv = slot_uv(slot);
+    }
+    if (num_generated > 0) {
+        sg_end_pass();
+        gpu_timer_stamp(&state.timer, "tiles");
+        state.stats.timed_frames++;
+        state.stats.timed_tiles += num_generated;
+    }
+
+    // graphics pass
+    if (!instances.empty()) {
+        sg_update_buffer(state.graphics.instances, { instances.data(), sizeof(tile_instance_t) * instances.size() });
+    }
+    sg_bindings _graphics_bindings{};
+    _graphics_bindings.storage_buffers[0] = state.graphics.instances;
+    _graphics_bindings.images[0] = state.atlas.img;
+    _graphics_bindings.samplers[0] = state.graphics.smp;
+    sg_pass _graphics_pass = { .action=state.graphics.pass_action, .swapchain=sglue_swapchain(), .label="render-pass" };
+    sg_begin_pass(&_graphics_pass);
+    if (!instances.empty()) {
+        sg_apply_pipeline(state.graphics.pip);
+        sg_apply_bindings(_graphics_bindings);
+        sg_draw(0, 6, (int)instances.size());
+    }
+    sg_end_pass();
+    sg_commit();
+
+    if (state.frame_index % REPORT_FRAMES == 0) {
+        print_stats();
+    }
+}
+
+void cleanup() {
+    noise_lib_shutdown(&state.compute.lib);
+    gpu_timer_shutdown(&state.timer);
+    sg_shutdown();
+}
+
+void input(const sapp_event* event) {
+    switch (event->type) {
+        case SAPP_EVENTTYPE_MOUSE_DOWN: {
+            if (event->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.view.dragging = true;
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_UP: {
+            if (event->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.view.dragging = false;
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_MOVE: {
+            if (state.view.dragging) {
+                state.view.center.X -= event->mouse_dx / state.view.zoom;
+                state.view.center.Y -= event->mouse_dy / state.view.zoom;
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_SCROLL: {
+            state.view.zoom = std::clamp(state.view.zoom * powf(1.1f, event->scroll_y), MIN_ZOOM, MAX_ZOOM);
+            break;
+        }
+        case SAPP_EVENTTYPE_KEY_DOWN: {
+            // space stops and resumes the automatic panning
+            if (event->key_code == SAPP_KEYCODE_SPACE) {
+                state.view.paused = !state.view.paused;
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+// options can be given on the command line or through environment variables:
+//   --budget=N         NOISE_VT_BUDGET     tiles generated per frame at most (default: 8)
+//   --noise=TYPE       NOISE_VT_TYPE       white, value, perlin, simplex or worley (default: perlin)
+//   --fractal=F        NOISE_VT_FRACTAL    none, fbm, ridged or turbulence (default: fbm)
+//   --octaves=N        NOISE_VT_OCTAVES    octaves of the fractal, 1 to 8 (default: 6)
+//   --frequency=F      NOISE_VT_FREQUENCY  noise cells per tile (default: 2)
+void parse_args(int argc, char* argv[]) {
+    const char* budget = getenv("NOISE_VT_BUDGET");
+    const char* type = getenv("NOISE_VT_TYPE");
+    const char* fractal = getenv("NOISE_VT_FRACTAL");
+    const char* octaves = getenv("NOISE_VT_OCTAVES");
+    const char* frequency = getenv("NOISE_VT_FREQUENCY");
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--budget=", 9)) {
+            budget = argv[i] + 9;
+        } else if (0 == strncmp(argv[i], "--noise=", 8)) {
+            type = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--fractal=", 10)) {
+            fractal = argv[i] + 10;
+        } else if (0 == strncmp(argv[i], "--octaves=", 10)) {
+            octaves = argv[i] + 10;
+        } else if (0 == strncmp(argv[i], "--frequency=", 12)) {
+            frequency = argv[i] + 12;
+        }
+    }
+    state.config.budget = budget ? (uint32_t)std::max(atoi(budget), 1) : DEFAULT_TILE_BUDGET;
+    state.config.frequency = frequency ? std::max((float)atof(frequency), 0.001f) : 2.0f;
+    state.config.desc = { NOISE_PERLIN, NOISE_FRACTAL_FBM, 6 };
+    if (type && !noise_type_parse(type, &state.config.desc.type)) {
+        printf("unknown noise type '%s'\n", type);
+    }
+    if (fractal && !noise_fractal_parse(fractal, &state.config.desc.fractal)) {
+        printf("unknown fractal '%s'\n", fractal);
+    }
+    if (octaves) {
+        state.config.desc.octaves = std::clamp(atoi(octaves), 1, NOISE_MAX_OCTAVES);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    sapp_desc desc = {0};
+    desc.init_cb = init;
+    desc.frame_cb = frame;
+    desc.cleanup_cb = cleanup,
+    desc.event_cb = input,
+    desc.width  = SCREEN_WIDTH,
+    desc.height = SCREEN_HEIGHT,
+    desc.window_title = "sokol cs virtual noise texture (GL4.3)",
+    desc.icon.sokol_default = true,
+    desc.logger.func = slog_func;
+    sapp_run(&desc);
+
+    return 0;
+}
@@ -0,0 +1,606 @@
+#define SOKOL_IMPL
+#define SOKOL_NO_ENTRY
+#define SOKOL_GLCORE
+#include "gl_ext.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_log.h"
+#include "sokol_time.h"
+
+#include "HandmadeMath.h"
+
+#include "compute_gl.h"
+#include "gpu_timer_gl.h"
+#include "scan_gl.h"
+#include "radix_sort_gl.h"
+#include "particle_args.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+constexpr uint32_t SCREEN_WIDTH = 800;
+constexpr uint32_t SCREEN_HEIGHT = 600;
+
+constexpr uint32_t DEFAULT_PARTICLE_COUNT = 64 * 1024;
+// a long frame is simulated as this much time at most
+constexpr float MAX_STEP_DT = 1.0f / 30.0f;
+// world space edge length of a particle quad
+constexpr float PARTICLE_SIZE = 0.02f;
+// view depth is quantized to this many bits for the back-to-front sort,
+// 16 bits are 4 radix passes instead of 8 and plenty for blending order
+constexpr uint32_t DEPTH_KEY_BITS = 16;
+constexpr float CAMERA_NEAR = 0.1f;
+constexpr float CAMERA_FAR = 10.0f;
+
+constexpr int SWEEP_WARMUP_FRAMES = 30;
+constexpr int SWEEP_MEASURE_FRAMES = 240;
+
+// xyz used, w pads every member to 16 bytes for std430
+struct particle3d_t{
+    HMM_Vec4 pos;
+    HMM_Vec4 vel;
+    HMM_Vec4 color;
+};
+
+struct cs_params_t{
+    float dt;
+    int32_t num_particles;
+};
+
+struct init_params_t{
+    int32_t seed;
+    int32_t num_particles;
+};
+
+// the uniform blocks are tightly packed, so these structs must not have
+// any trailing padding behind the 16 byte aligned HMM types
+struct depth_params_t{
+    HMM_Mat4 view;
+    float near_plane;
+    float far_plane;
+    int32_t num_particles;
+    int32_t key_bits;
+};
+
+struct draw_params_t{
+    HMM_Mat4 view_proj;
+    HMM_Vec4 cam_right;         // w: quad edge length
+    HMM_Vec4 cam_up;
+};
+static_assert(sizeof(depth_params_t) == sizeof(HMM_Mat4) + 4 * sizeof(float), "depth_params_t is padded");
+static_assert(sizeof(draw_params_t) == sizeof(HMM_Mat4) + 2 * sizeof(HMM_Vec4), "draw_params_t is padded");
+
+enum blend_mode_t {
+    BLEND_ADDITIVE,
+    BLEND_SORTED,       // alpha blending back to front, sorted on the GPU each frame
+};
+
+// GLparticle3d: particles bounce inside the [-1, 1]^3 box and are drawn as
+// camera-facing instanced quads under an orbit camera (left drag rotates,
+// wheel zooms). With additive blending the draw order doesn't matter, with
+// sorted blending the view depth of every particle is turned into a key and
+// the particle indices are radix sorted on the GPU, the vertex shader then
+// fetches particles through the sorted index list. Nothing per particle ever
+// touches the CPU, so the CPU frame time stays flat as the count grows.
+struct {
+    struct {
+        uint32_t particle_count;
+        blend_mode_t blend;
+        std::vector<uint32_t> sweep_counts;
+    } config;
+    struct {
+        size_t index;
+        int frame;
+        double frame_ms;
+        double cpu_ms;
+    } sweep;
+    uint32_t num_particles;
+    struct {
+        sg_buffer buf;
+        sg_pipeline pip;
+        sg_pipeline init_pip;
+    } compute;
+    struct {
+        sg_buffer keys;
+        sg_buffer order;
+        sg_pipeline depth_pip;
+        radix_sort_t sorter;
+    } sort;
+    struct {
+        sg_pipeline additive_pip;
+        sg_pipeline sorted_pip;
+        sg_pass_action pass_action;
+    } graphics;
+    struct {
+        float yaw;
+        float pitch;
+        float distance;
+        bool dragging;
+    } camera;
+    gpu_timer_t timer;
+} state;
+
+// particle quad pipeline, with sorted the vertex shader reads the particle
+// index from the sorted order buffer at binding 1
+sg_pipeline make_draw_pipeline(bool sorted) {
+    std::string vs_source = R"(
+#version 430 core
+uniform mat4 view_proj;
+uniform vec4 cam_right;     // w: quad edge length
+uniform vec4 cam_up;
+
+struct particle_t {
+  vec4 pos;
+  vec4 vel;
+  vec4 color;
+};
+
+layout(std430, binding=0) readonly buffer ssbo {
+  particle_t prt[];
+};
+)";
+    if (sorted) {
+        vs_source += R"(
+layout(std430, binding=1) readonly buffer order_ssbo {
+  uint order[];
+};
+uint particle_index() { return order[gl_InstanceID]; }
+)";
+    } else {
+        vs_source += R"(
+uint particle_index() { return uint(gl_InstanceID); }
+)";
+    }
+    vs_source += R"(
+layout(location=0) out vec4 vColor;
+layout(location=1) out vec2 vCorner;
+
+const vec2 corners[6] = { {-1.0, -1.0}, {1.0, -1.0}, {-1.0, 1.0}, {1.0, -1.0}, {1.0, 1.0}, {-1.0, 1.0} };
+
+void main() {
+  particle_t p = prt[particle_index()];
+  vec2 corner = corners[gl_VertexID];
+  vec3 world = p.pos.xyz + (corner.x * cam_right.xyz + corner.y * cam_up.xyz) * (0.5 * cam_right.w);
+  gl_Position = view_proj * vec4(world, 1.0);
+  vColor = p.color;
+  vCorner = corner;
+}
+)";
+
+    sg_shader_desc _shader_desc{};
+    _shader_desc.vertex_func.source = vs_source.c_str();
+    _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(location=0) in vec4 vColor;
+layout(location=1) in vec2 vCorner;
+out vec4 frag_color;
+
+void main() {
+  // round soft sprite
+  float r = length(vCorner);
+  if (r > 1.0) {
+    discard;
+  }
+  frag_color = vec4(vColor.rgb, vColor.a * (1.0 - smoothstep(0.5, 1.0, r)));
+}
+)";
+    _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_VERTEX;
+    _shader_desc.uniform_blocks[0].size = sizeof(draw_params_t);
+    _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_MAT4, .glsl_name = "view_proj" };
+    _shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_FLOAT4, .glsl_name = "cam_right" };
+    _shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_FLOAT4, .glsl_name = "cam_up" };
+    for (int i = 0; i < (sorted ? 2 : 1); i++) {
+        _shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_VERTEX;
+        _shader_desc.storage_buffers[i].readonly = true;
+        _shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+    }
+    _shader_desc.label = sorted ? "sorted-draw-shader" : "additive-draw-shader";
+
+    sg_pipeline_desc _pipeline_desc{};
+    _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+    _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
+    _pipeline_desc.colors[0].blend.enabled = true;
+    _pipeline_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
+    _pipeline_desc.colors[0].blend.dst_factor_rgb = sorted ? SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA : SG_BLENDFACTOR_ONE;
+    _pipeline_desc.colors[0].blend.src_factor_alpha = SG_BLENDFACTOR_ONE;
+    _pipeline_desc.colors[0].blend.dst_factor_alpha = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+    _pipeline_desc.label = sorted ? "sorted-draw-pipeline" : "additive-draw-pipeline";
+    return sg_make_pipeline(&_pipeline_desc);
+}
+
+void create_particle_buffers(uint32_t count) {
+    state.num_particles = count;
+
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.size = sizeof(particle3d_t) * count;
+    _sg_buffer_desc.label = "particle3d-buffer";
+    state.compute.buf = sg_make_buffer(&_sg_buffer_desc);
+
+    if (state.config.blend == BLEND_SORTED) {
+        _sg_buffer_desc.size = sizeof(uint32_t) * count;
+        _sg_buffer_desc.label = "depth-keys";
+        state.sort.keys = sg_make_buffer(&_sg_buffer_desc);
+        _sg_buffer_desc.label = "depth-order";
+        state.sort.order = sg_make_buffer(&_sg_buffer_desc);
+    }
+
+    // seed the particles in place on the GPU
+    const init_params_t init_params = { (int32_t)time(nullptr), (int32_t)count };
+    sg_bindings _init_bindings{};
+    _init_bindings.storage_buffers[0] = state.compute.buf;
+    sg_pass _init_pass = { .compute=true, .label="init-pass" };
+    sg_begin_pass(&_init_pass);
+    sg_apply_pipeline(state.compute.init_pip);
+    sg_apply_bindings(_init_bindings);
+    sg_apply_uniforms(0, SG_RANGE(init_params));
+    dispatch_items(count);
+    sg_end_pass();
+}
+
+void destroy_particle_buffers() {
+    sg_destroy_buffer(state.compute.buf);
+    if (state.config.blend == BLEND_SORTED) {
+        sg_destroy_buffer(state.sort.keys);
+        sg_destroy_buffer(state.sort.order);
+    }
+}
+
+void init() {
+    sg_desc _sg_desc{};
+    _sg_desc.environment = sglue_environment();
+    _sg_desc.logger.func = slog_func;
+    sg_setup(&_sg_desc);
+    stm_setup();
+
+    const std::string particle_decl = R"(
+struct particle_t {
+  vec4 pos;
+  vec4 vel;
+  vec4 color;
+};
+
+layout(std430, binding=0) buffer ssbo {
+  particle_t prt[];
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+uint item_index() {
+  return gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+}
+)";
+
+    // init: a ball of radius 0.5 moving outwards
+    {
+        const std::string source = R"(
+#version 430
+uniform int seed;
+uniform int num_particles;
+)" + particle_decl + R"(
+)" + PCG_HASH_GLSL + R"(
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+  float z = 2.0 * rnd(idx, 0u) - 1.0;
+  float phi = 6.28318530718 * rnd(idx, 1u);
+  vec3 dir = vec3(sqrt(1.0 - z * z) * vec2(cos(phi), sin(phi)), z);
+  float r = 0.5 * pow(rnd(idx, 2u), 1.0 / 3.0);
+  prt[idx].pos = vec4(dir * r, 1.0);
+  prt[idx].vel = vec4(dir * 0.25, 0.0);
+  prt[idx].color = vec4(rnd(idx, 3u), rnd(idx, 4u), rnd(idx, 5u), 0.6);
+}
+)";
+        state.compute.init_pip = make_compute_pipeline("init", source.c_str(), sizeof(init_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "seed" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, 0x1);
+    }
+
+    // compute
+    {
+        const std::string source = R"(
+#version 430
+uniform float dt;
+uniform int num_particles;
+)" + particle_decl + R"(
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+
+  vec3 pos = prt[idx].pos.xyz;
+  vec3 vel = prt[idx].vel.xyz;
+  pos = pos + vel * dt;
+
+  // Flip movement at the box walls
+  if ( (pos.x <= -1.0) || (pos.x >= 1.0) ) {
+      vel.x *= -1.0;
+  }
+  if ( (pos.y <= -1.0) || (pos.y >= 1.0) ) {
+      vel.y *= -1.0;
+  }
+  if ( (pos.z <= -1.0) || (pos.z >= 1.0) ) {
+      vel.z *= -1.0;
+  }
+
+  prt[idx].pos.xyz = pos;
+  prt[idx].vel.xyz = vel;
+}
+)";
+        state.compute.pip = make_compute_pipeline("compute", source.c_str(), sizeof(cs_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, 0x1);
+    }
+
+    // depth keys: larger view depth gives a smaller key, so that the
+    // ascending sort puts the farthest particle first
+    if (state.config.blend == BLEND_SORTED) {
+        const std::string source = R"(
+#version 430
+uniform mat4 view;
+uniform float near_plane;
+uniform float far_plane;
+uniform int num_particles;
+uniform int key_bits;
+)" + particle_decl + R"(
+layout(std430, binding=1) writeonly buffer keys_ssbo {
+  uint keys[];
+};
+layout(std430, binding=2) writeonly buffer order_ssbo {
+  uint order[];
+};
+
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+  float depth = -(view * vec4(prt[idx].pos.xyz, 1.0)).z;
+  float t = clamp((depth - near_plane) / (far_plane - near_plane), 0.0, 1.0);
+  float max_key = float((1u << uint(key_bits)) - 1u);
+  keys[idx] = uint(max_key) - uint(t * max_key);
+  order[idx] = idx;
+}
+)";
+        state.sort.depth_pip = make_compute_pipeline("depth-keys", source.c_str(), sizeof(depth_params_t), {
+            { .type = SG_UNIFORMTYPE_MAT4, .glsl_name = "view" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "near_plane" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "far_plane" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "key_bits" },
+        }, 0x7);
+
+        const uint32_t max_count = state.config.sweep_counts.empty() ? state.config.particle_count :
+            *std::max_element(state.config.sweep_counts.begin(), state.config.sweep_counts.end());
+        radix_sort_init(&state.sort.sorter, max_count);
+    }
+
+    // graphics
+    state.graphics.additive_pip = make_draw_pipeline(false);
+    if (state.config.blend == BLEND_SORTED) {
+        state.graphics.sorted_pip = make_draw_pipeline(true);
+    }
+    state.graphics.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.05f, 0.05f, 0.08f, 1.0f} };
+
+    state.camera = { 0.6f, 0.4f, 3.5f, false };
+    gpu_timer_init(&state.timer);
+    create_particle_buffers(state.config.sweep_counts.empty() ? state.config.particle_count : state.config.sweep_counts[0]);
+}
+
+const char* blend_mode_name(blend_mode_t mode) {
+    return mode == BLEND_SORTED ? "sorted" : "additive";
+}
+
+// warm up, then average frame time, CPU time and GPU time per pass for
+// SWEEP_MEASURE_FRAMES frames and continue with the next count
+void sweep_frame(double dt, double cpu_ms) {
+    state.sweep.frame++;
+    if (state.sweep.frame == SWEEP_WARMUP_FRAMES) {
+        gpu_timer_reset(&state.timer);
+        state.sweep.frame_ms = 0.0;
+        state.sweep.cpu_ms = 0.0;
+    }
+    if (state.sweep.frame <= SWEEP_WARMUP_FRAMES) {
+        return;
+    }
+    state.sweep.frame_ms += dt * 1000.0;
+    state.sweep.cpu_ms += cpu_ms;
+    if (state.sweep.frame < SWEEP_WARMUP_FRAMES + SWEEP_MEASURE_FRAMES) {
+        return;
+    }
+    printf("3d %-8s %10u particles: frame %.3fms | cpu %.3fms | compute %.3fms | sort %.3fms | graphics %.3fms\n",
+        blend_mode_name(state.config.blend),
+        state.num_particles,
+        state.sweep.frame_ms / SWEEP_MEASURE_FRAMES,
+        state.sweep.cpu_ms / SWEEP_MEASURE_FRAMES,
+        gpu_timer_ms(&state.timer, "compute"),
+        state.config.blend == BLEND_SORTED ? gpu_timer_ms(&state.timer, "sort") : 0.0,
+        gpu_timer_ms(&state.timer, "graphics"));
+    fflush(stdout);
+
+    state.sweep.index++;
+    state.sweep.frame = 0;
+    if (state.sweep.index >= state.config.sweep_counts.size()) {
+        sapp_request_quit();
+        return;
+    }
+    destroy_particle_buffers();
+    create_particle_buffers(state.config.sweep_counts[state.sweep.index]);
+}
+
+void frame() {
+    const uint64_t cpu_start = stm_now();
+    const double dt = sapp_frame_duration();
+
+    // orbit camera, slowly turning on its own so that the sort order changes
+    if (!state.camera.dragging) {
+        state.camera.yaw += 0.1f * (float)dt;
+    }
+    const float cos_pitch = cosf(state.camera.pitch);
+    const HMM_Vec3 eye = HMM_V3(state.camera.distance * cos_pitch * sinf(state.camera.yaw),
+                                state.camera.distance * sinf(state.camera.pitch),
+                                state.camera.distance * cos_pitch * cosf(state.camera.yaw));
+    const HMM_Mat4 view = HMM_LookAt_RH(eye, HMM_V3(0.0f, 0.0f, 0.0f), HMM_V3(0.0f, 1.0f, 0.0f));
+    const HMM_Mat4 proj = HMM_Perspective_RH_NO(HMM_AngleDeg(60.0f), sapp_widthf() / sapp_heightf(), CAMERA_NEAR, CAMERA_FAR);
+
+    gpu_timer_begin_frame(&state.timer);
+
+    // compute pass
+    const cs_params_t cs_params = { std::min((float)dt, MAX_STEP_DT), (int32_t)state.num_particles };
+    sg_bindings _compute_bindings{};
+    _compute_bindings.storage_buffers[0] = state.compute.buf;
+    sg_pass _compute_pass = { .compute=true, .label="compute-pass" };
+    sg_begin_pass(&_compute_pass);
+    sg_apply_pipeline(state.compute.pip);
+    sg_apply_bindings(_compute_bindings);
+    sg_apply_uniforms(0, SG_RANGE(cs_params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "compute");
+
+    // back-to-front order of this frame's view
+    if (state.config.blend == BLEND_SORTED) {
+        const depth_params_t depth_params = { view, CAMERA_NEAR, CAMERA_FAR, (int32_t)state.num_particles, (int32_t)DEPTH_KEY_BITS };
+        sg_bindings _depth_bindings{};
+        _depth_bindings.storage_buffers[0] = state.compute.buf;
+        _depth_bindings.storage_buffers[1] = state.sort.keys;
+        _depth_bindings.storage_buffers[2] = state.sort.order;
+        sg_pass _sort_pass = { .compute=true, .label="sort-pass" };
+        sg_begin_pass(&_sort_pass);
+        sg_apply_pipeline(state.sort.depth_pip);
+        sg_apply_bindings(_depth_bindings);
+        sg_apply_uniforms(0, SG_RANGE(depth_params));
+        dispatch_items(state.num_particles);
+        radix_sort(&state.sort.sorter, state.sort.keys, state.sort.order, state.num_particles, DEPTH_KEY_BITS);
+        sg_end_pass();
+        gpu_timer_stamp(&state.timer, "sort");
+    }
+
+    // graphics pass, the camera basis is the first two rows of the view matrix
+    const draw_params_t draw_params = {
+        HMM_MulM4(proj, view),
+        HMM_V4(view.Columns[0].X, view.Columns[1].X, view.Columns[2].X, PARTICLE_SIZE),
+        HMM_V4(view.Columns[0].Y, view.Columns[1].Y, view.Columns[2].Y, 0.0f),
+    };
+    sg_bindings _graphics_bindings{};
+    _graphics_bindings.storage_buffers[0] = state.compute.buf;
+    if (state.config.blend == BLEND_SORTED) {
+        _graphics_bindings.storage_buffers[1] = state.sort.order;
+    }
+    sg_pass _graphics_pass = { .action=state.graphics.pass_action, .swapchain=sglue_swapchain(), .label="render-pass" };
+    sg_begin_pass(&_graphics_pass);
+    sg_apply_pipeline(state.config.blend == BLEND_SORTED ? state.graphics.sorted_pip : state.graphics.additive_pip);
+    sg_apply_bindings(_graphics_bindings);
+    sg_apply_uniforms(0, SG_RANGE(draw_params));
+    sg_draw(0, 6, (int)state.num_particles);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "graphics");
+    sg_commit();
+
+    if (!state.config.sweep_counts.empty()) {
+        sweep_frame(dt, stm_ms(stm_since(cpu_start)));
+    }
+}
+
+void cleanup() {
+    destroy_particle_buffers();
+    if (state.config.blend == BLEND_SORTED) {
+        radix_sort_shutdown(&state.sort.sorter);
+    }
+    gpu_timer_shutdown(&state.timer);
+    sg_shutdown();
+}
+
+void input(const sapp_event* event) {
+    switch (event->type) {
+        case SAPP_EVENTTYPE_MOUSE_DOWN: {
+            if (event->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.camera.dragging = true;
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_UP: {
+            if (event->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+                state.camera.dragging = false;
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_MOVE: {
+            if (state.camera.dragging) {
+                state.camera.yaw -= event->mouse_dx * 0.01f;
+                state.camera.pitch = std::clamp(state.camera.pitch + event->mouse_dy * 0.01f, -1.5f, 1.5f);
+            }
+            break;
+        }
+        case SAPP_EVENTTYPE_MOUSE_SCROLL: {
+            // stay outside the [-1, 1]^3 box (corners at sqrt(3)), so that every
+            // particle is in front of the near plane and gets a valid depth key
+            state.camera.distance = std::clamp(state.camera.distance - event->scroll_y * 0.2f, 2.0f, 8.0f);
+            break;
+        }
+        default: break;
+    }
+}
+
+// options can be given on the command line or through environment variables:
+//   --count=N          PARTICLE3D_COUNT  number of particles, k/m suffix allowed (default: 64k)
+//   --blend=add|sorted PARTICLE3D_BLEND  additive blending or back-to-front alpha blending sorted on the GPU (default: add)
+//   --sweep[=N,N,...]  PARTICLE3D_SWEEP  report frame, CPU and GPU pass times for each count, then quit
+void parse_args(int argc, char* argv[]) {
+    const char* count = getenv("PARTICLE3D_COUNT");
+    const char* blend = getenv("PARTICLE3D_BLEND");
+    const char* sweep = getenv("PARTICLE3D_SWEEP");
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--count=", 8)) {
+            count = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--blend=", 8)) {
+            blend = argv[i] + 8;
+        } else if (0 == strcmp(argv[i], "--sweep")) {
+            sweep = "";
+        } else if (0 == strncmp(argv[i], "--sweep=", 8)) {
+            sweep = argv[i] + 8;
+        }
+    }
+    state.config.particle_count = count ? parse_count(count) : DEFAULT_PARTICLE_COUNT;
+    state.config.blend = (blend && (0 == strcmp(blend, "sorted"))) ? BLEND_SORTED : BLEND_ADDITIVE;
+    if (sweep) {
+        if (*sweep == 0) {
+            sweep = "64k,256k,1m,4m";
+        }
+        for (const char* str = sweep; *str; ) {
+            state.config.sweep_counts.push_back(parse_count(str));
+            str = strchr(str, ',');
+            if (!str) {
+                break;
+            }
+            str++;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    sapp_desc desc = {0};
+    desc.init_cb = init;
+    desc.frame_cb = frame;
+    desc.cleanup_cb = cleanup,
+    desc.event_cb = input,
+    desc.width  = SCREEN_WIDTH,
+    desc.height = SCREEN_HEIGHT,
+    desc.window_title = "sokol cs particle 3d (GL4.3)",
+    desc.icon.sokol_default = true,
+    desc.logger.func = slog_func;
+    sapp_run(&desc);
+
+    return 0;
+}
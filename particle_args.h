@@ -0,0 +1,18 @@
+#pragma once
+// Command line helpers shared by the particle demos, GL and CPU alike.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+// parse a particle count with an optional k/m suffix (e.g. "16m")
+inline uint32_t parse_count(const char* str) {
+    char* end = nullptr;
+    unsigned long long count = strtoull(str, &end, 10);
+    if ((*end == 'k') || (*end == 'K')) {
+        count *= 1024;
+    } else if ((*end == 'm') || (*end == 'M')) {
+        count *= 1024 * 1024;
+    }
+    return (uint32_t)std::clamp(count, 1ull, 64ull * 1024 * 1024);
+}
@@ -0,0 +1,142 @@
+#include "particle_args.h"
+#include "particle_cpu.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+constexpr float CPU_PARTICLE_DT = 1.0f / 60.0f;
+
+// CPUparticle runs the GLparticle integrate pass on the CPU without any window
+// or GPU: for every count it times the scalar loop on one thread, the SIMD
+// loop on one thread and the SIMD loop on the worker pool, then checks that
+// the pooled SIMD result matches the scalar one
+struct {
+    struct {
+        std::vector<uint32_t> counts;
+        uint32_t num_threads;
+        int frames;
+        bool validate;
+    } config;
+    particle_cpu_pool_t pool;
+} state;
+
+// same disc distribution as GLparticle
+void init_particles(particle_cpu_state_t* s, uint32_t count) {
+    std::default_random_engine rndEngine(count);
+    std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+    particle_cpu_resize(s, count);
+    for (uint32_t i = 0; i < count; i++) {
+        float r = 0.25f * std::sqrt(rndDist(rndEngine));
+        float theta = rndDist(rndEngine) * 2.0f * 3.14159265358979323846f;
+        float x = r * std::cos(theta);
+        float y = r * std::sin(theta);
+        float len = std::sqrt(x * x + y * y);
+        s->pos_x[i] = x;
+        s->pos_y[i] = y;
+        s->vel_x[i] = len > 0.0f ? x / len * 0.25f : 0.0f;
+        s->vel_y[i] = len > 0.0f ? y / len * 0.25f : 0.0f;
+    }
+}
+
+// run config.frames steps and return the throughput in particles/sec
+template<typename STEP> double measure(particle_cpu_state_t* s, STEP step) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < state.config.frames; i++) {
+        step(s);
+    }
+    const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    return (double)s->num_particles * state.config.frames / secs.count();
+}
+
+void run(uint32_t count) {
+    particle_cpu_state_t initial;
+    init_particles(&initial, count);
+
+    particle_cpu_state_t scalar = initial;
+    const double scalar_rate = measure(&scalar, [](particle_cpu_state_t* s) {
+        particle_cpu_integrate_scalar(s, CPU_PARTICLE_DT, 0, s->num_particles);
+    });
+
+    particle_cpu_state_t simd = initial;
+    const double simd_rate = measure(&simd, [](particle_cpu_state_t* s) {
+        particle_cpu_integrate_range(s, CPU_PARTICLE_DT, 0, s->num_particles);
+    });
+
+    particle_cpu_state_t pooled = initial;
+    const double pooled_rate = measure(&pooled, [](particle_cpu_state_t* s) {
+        particle_cpu_step(s, &state.pool, CPU_PARTICLE_DT);
+    });
+
+    const uint32_t num_threads = particle_cpu_pool_size(&state.pool);
+    printf("cpu %-6s %10u particles: scalar 1T %8.1f Mp/s | simd 1T %8.1f Mp/s | simd %uT %8.1f Mp/s (%.1f Mp/s/core)",
+        particle_cpu_simd_name(),
+        count,
+        scalar_rate * 1.0e-6,
+        simd_rate * 1.0e-6,
+        num_threads,
+        pooled_rate * 1.0e-6,
+        pooled_rate * 1.0e-6 / num_threads);
+    if (state.config.validate) {
+        // every path does the same IEEE operations, the results must match exactly
+        const particle_cpu_compare_t cmp = particle_cpu_compare(scalar, pooled, 0.0f, 0.0f);
+        printf(" | %s", cmp.mismatches == 0 ? "ok" : "MISMATCH");
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// options can be given on the command line or through environment variables:
+//   --count=N,N,...    CPU_PARTICLE_COUNT    particle counts to benchmark, k/m suffix allowed (default: 64k,256k,1m,4m,16m)
+//   --threads=N        CPU_PARTICLE_THREADS  worker pool size including the main thread (default: all hardware threads)
+//   --frames=N         CPU_PARTICLE_FRAMES   integrate steps per measurement (default: 100)
+//   --no-validate      CPU_PARTICLE_NO_VALIDATE  skip comparing the SIMD result with the scalar one
+void parse_args(int argc, char* argv[]) {
+    const char* counts = getenv("CPU_PARTICLE_COUNT");
+    const char* threads = getenv("CPU_PARTICLE_THREADS");
+    const char* frames = getenv("CPU_PARTICLE_FRAMES");
+    state.config.validate = getenv("CPU_PARTICLE_NO_VALIDATE") == nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--count=", 8)) {
+            counts = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--threads=", 10)) {
+            threads = argv[i] + 10;
+        } else if (0 == strncmp(argv[i], "--frames=", 9)) {
+            frames = argv[i] + 9;
+        } else if (0 == strcmp(argv[i], "--no-validate")) {
+            state.config.validate = false;
+        }
+    }
+    state.config.num_threads = threads ? (uint32_t)std::max(atoi(threads), 0) : 0;
+    state.config.frames = frames ? std::max(atoi(frames), 1) : 100;
+    std::string list = counts ? counts : "64k,256k,1m,4m,16m";
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            state.config.counts.push_back(parse_count(list.substr(start, end - start).c_str()));
+        }
+        start = end + 1;
+    }
+    if (state.config.counts.empty()) {
+        state.config.counts.push_back(1024 * 1024);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    particle_cpu_pool_init(&state.pool, state.config.num_threads);
+    for (uint32_t count : state.config.counts) {
+        run(count);
+    }
+    particle_cpu_pool_shutdown(&state.pool);
+
+    return 0;
+}
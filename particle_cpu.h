@@ -0,0 +1,263 @@
+#pragma once
+// CPU implementation of the GLparticle integrate pass (move by vel * dt, then
+// flip the velocity at the [-1, 1] border), used to validate the GPU result and
+// as a headless throughput benchmark on machines without a GPU.
+//
+// The state is kept as SoA float lanes so that 8 (AVX) or 4 (SSE2) particles
+// are updated per instruction, the particle range is split evenly across a
+// persistent worker pool. Every path does the same IEEE mul + add, so the SIMD
+// and scalar results are bit identical.
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PARTICLE_CPU_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PARTICLE_CPU_SSE2
+#endif
+
+#if defined(PARTICLE_CPU_AVX)
+constexpr uint32_t PARTICLE_CPU_LANES = 8;
+#elif defined(PARTICLE_CPU_SSE2)
+constexpr uint32_t PARTICLE_CPU_LANES = 4;
+#else
+constexpr uint32_t PARTICLE_CPU_LANES = 1;
+#endif
+
+// don't wake workers for less than this many particles each
+constexpr uint32_t PARTICLE_CPU_MIN_RANGE = 16 * 1024;
+
+struct particle_cpu_state_t {
+    std::vector<float> pos_x;
+    std::vector<float> pos_y;
+    std::vector<float> vel_x;
+    std::vector<float> vel_y;
+    uint32_t num_particles;
+};
+
+// persistent workers, particle_cpu_pool_run() hands job i to worker i and runs
+// job 0 on the calling thread
+struct particle_cpu_pool_t {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    std::function<void(uint32_t)> job;
+    uint64_t generation = 0;
+    uint32_t num_running = 0;
+    bool quit = false;
+};
+
+struct particle_cpu_compare_t {
+    uint32_t mismatches;
+    float max_pos_error;
+    float max_vel_error;
+};
+
+inline const char* particle_cpu_simd_name() {
+#if defined(PARTICLE_CPU_AVX)
+    return "avx";
+#elif defined(PARTICLE_CPU_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+inline void particle_cpu_resize(particle_cpu_state_t* s, uint32_t num_particles) {
+    s->pos_x.resize(num_particles);
+    s->pos_y.resize(num_particles);
+    s->vel_x.resize(num_particles);
+    s->vel_y.resize(num_particles);
+    s->num_particles = num_particles;
+}
+
+// plain loop over [begin, end), also handles the tail of the SIMD path
+inline void particle_cpu_integrate_scalar(particle_cpu_state_t* s, float dt, uint32_t begin, uint32_t end) {
+    float* pos_x = s->pos_x.data();
+    float* pos_y = s->pos_y.data();
+    float* vel_x = s->vel_x.data();
+    float* vel_y = s->vel_y.data();
+    for (uint32_t i = begin; i < end; i++) {
+        const float px = pos_x[i] + vel_x[i] * dt;
+        const float py = pos_y[i] + vel_y[i] * dt;
+        // Flip movement at window border
+        if ((px <= -1.0f) || (px >= 1.0f)) {
+            vel_x[i] = -vel_x[i];
+        }
+        if ((py <= -1.0f) || (py >= 1.0f)) {
+            vel_y[i] = -vel_y[i];
+        }
+        pos_x[i] = px;
+        pos_y[i] = py;
+    }
+}
+
+inline void particle_cpu_integrate_range(particle_cpu_state_t* s, float dt, uint32_t begin, uint32_t end) {
+    uint32_t i = begin;
+#if defined(PARTICLE_CPU_AVX) || defined(PARTICLE_CPU_SSE2)
+    float* pos_x = s->pos_x.data();
+    float* pos_y = s->pos_y.data();
+    float* vel_x = s->vel_x.data();
+    float* vel_y = s->vel_y.data();
+#endif
+#if defined(PARTICLE_CPU_AVX)
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    for (; i + 8 <= end; i += 8) {
+        __m256 vx = _mm256_loadu_ps(vel_x + i);
+        __m256 vy = _mm256_loadu_ps(vel_y + i);
+        const __m256 px = _mm256_add_ps(_mm256_loadu_ps(pos_x + i), _mm256_mul_ps(vx, vdt));
+        const __m256 py = _mm256_add_ps(_mm256_loadu_ps(pos_y + i), _mm256_mul_ps(vy, vdt));
+        // flip the sign bit of the lanes outside the border
+        const __m256 flip_x = _mm256_or_ps(_mm256_cmp_ps(px, lo, _CMP_LE_OQ), _mm256_cmp_ps(px, hi, _CMP_GE_OQ));
+        const __m256 flip_y = _mm256_or_ps(_mm256_cmp_ps(py, lo, _CMP_LE_OQ), _mm256_cmp_ps(py, hi, _CMP_GE_OQ));
+        vx = _mm256_xor_ps(vx, _mm256_and_ps(flip_x, sign));
+        vy = _mm256_xor_ps(vy, _mm256_and_ps(flip_y, sign));
+        _mm256_storeu_ps(pos_x + i, px);
+        _mm256_storeu_ps(pos_y + i, py);
+        _mm256_storeu_ps(vel_x + i, vx);
+        _mm256_storeu_ps(vel_y + i, vy);
+    }
+#elif defined(PARTICLE_CPU_SSE2)
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= end; i += 4) {
+        __m128 vx = _mm_loadu_ps(vel_x + i);
+        __m128 vy = _mm_loadu_ps(vel_y + i);
+        const __m128 px = _mm_add_ps(_mm_loadu_ps(pos_x + i), _mm_mul_ps(vx, vdt));
+        const __m128 py = _mm_add_ps(_mm_loadu_ps(pos_y + i), _mm_mul_ps(vy, vdt));
+        // flip the sign bit of the lanes outside the border
+        const __m128 flip_x = _mm_or_ps(_mm_cmple_ps(px, lo), _mm_cmpge_ps(px, hi));
+        const __m128 flip_y = _mm_or_ps(_mm_cmple_ps(py, lo), _mm_cmpge_ps(py, hi));
+        vx = _mm_xor_ps(vx, _mm_and_ps(flip_x, sign));
+        vy = _mm_xor_ps(vy, _mm_and_ps(flip_y, sign));
+        _mm_storeu_ps(pos_x + i, px);
+        _mm_storeu_ps(pos_y + i, py);
+        _mm_storeu_ps(vel_x + i, vx);
+        _mm_storeu_ps(vel_y + i, vy);
+    }
+#endif
+    particle_cpu_integrate_scalar(s, dt, i, end);
+}
+
+inline void particle_cpu_worker(particle_cpu_pool_t* p, uint32_t index) {
+    uint64_t generation = 0;
+    for (;;) {
+        std::function<void(uint32_t)> job;
+        {
+            std::unique_lock<std::mutex> lock(p->mutex);
+            p->start_cv.wait(lock, [&] { return p->quit || (p->generation != generation); });
+            if (p->quit) {
+                return;
+            }
+            generation = p->generation;
+            job = p->job;
+        }
+        job(index);
+        {
+            std::lock_guard<std::mutex> lock(p->mutex);
+            if (--p->num_running == 0) {
+                p->done_cv.notify_one();
+            }
+        }
+    }
+}
+
+// num_threads includes the calling thread, 0 uses all hardware threads
+inline void particle_cpu_pool_init(particle_cpu_pool_t* p, uint32_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (uint32_t i = 1; i < num_threads; i++) {
+        p->threads.emplace_back(particle_cpu_worker, p, i);
+    }
+}
+
+inline void particle_cpu_pool_shutdown(particle_cpu_pool_t* p) {
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->quit = true;
+    }
+    p->start_cv.notify_all();
+    for (std::thread& t : p->threads) {
+        t.join();
+    }
+    p->threads.clear();
+    p->quit = false;
+}
+
+inline uint32_t particle_cpu_pool_size(const particle_cpu_pool_t* p) {
+    return (uint32_t)p->threads.size() + 1;
+}
+
+// run job(0) .. job(pool size - 1) in parallel and wait for all of them
+inline void particle_cpu_pool_run(particle_cpu_pool_t* p, const std::function<void(uint32_t)>& job) {
+    if (p->threads.empty()) {
+        job(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->job = job;
+        p->num_running = (uint32_t)p->threads.size();
+        p->generation++;
+    }
+    p->start_cv.notify_all();
+    job(0);
+    std::unique_lock<std::mutex> lock(p->mutex);
+    p->done_cv.wait(lock, [&] { return p->num_running == 0; });
+}
+
+// one integrate step over all particles, ranges are cut at lane boundaries
+inline void particle_cpu_step(particle_cpu_state_t* s, particle_cpu_pool_t* p, float dt) {
+    const uint32_t n = s->num_particles;
+    if ((p == nullptr) || (n < 2 * PARTICLE_CPU_MIN_RANGE)) {
+        particle_cpu_integrate_range(s, dt, 0, n);
+        return;
+    }
+    const uint32_t num_jobs = particle_cpu_pool_size(p);
+    uint32_t range = (n + num_jobs - 1) / num_jobs;
+    range = (range + PARTICLE_CPU_LANES - 1) / PARTICLE_CPU_LANES * PARTICLE_CPU_LANES;
+    particle_cpu_pool_run(p, [s, dt, n, range](uint32_t job) {
+        const uint32_t begin = std::min(n, job * range);
+        const uint32_t end = std::min(n, begin + range);
+        particle_cpu_integrate_range(s, dt, begin, end);
+    });
+}
+
+// compare two states, a particle mismatches if pos or vel differ by more than
+// the tolerances, a velocity sign that only differs because the position
+// landed within pos_tol of the border (rounding picked the other side) is
+// accepted
+inline particle_cpu_compare_t particle_cpu_compare(const particle_cpu_state_t& a, const particle_cpu_state_t& b, float pos_tol, float vel_tol) {
+    particle_cpu_compare_t r = {};
+    const uint32_t n = std::min(a.num_particles, b.num_particles);
+    for (uint32_t i = 0; i < n; i++) {
+        const float pos_err = std::max(std::fabs(a.pos_x[i] - b.pos_x[i]), std::fabs(a.pos_y[i] - b.pos_y[i]));
+        const bool border_x = std::fabs(std::fabs(a.pos_x[i]) - 1.0f) <= pos_tol;
+        const bool border_y = std::fabs(std::fabs(a.pos_y[i]) - 1.0f) <= pos_tol;
+        const float vel_err_x = border_x ? std::fabs(std::fabs(a.vel_x[i]) - std::fabs(b.vel_x[i])) : std::fabs(a.vel_x[i] - b.vel_x[i]);
+        const float vel_err_y = border_y ? std::fabs(std::fabs(a.vel_y[i]) - std::fabs(b.vel_y[i])) : std::fabs(a.vel_y[i] - b.vel_y[i]);
+        const float vel_err = std::max(vel_err_x, vel_err_y);
+        r.max_pos_error = std::max(r.max_pos_error, pos_err);
+        r.max_vel_error = std::max(r.max_vel_error, vel_err);
+        if (!(pos_err <= pos_tol) || !(vel_err <= vel_tol)) {
+            r.mismatches++;
+        }
+    }
+    return r;
+}
@@ -1,24 +1,135 @@
 #define SOKOL_IMPL
 #define SOKOL_NO_ENTRY
 #define SOKOL_GLCORE
+#include "gl_ext.h"
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_glue.h"
 #include "sokol_log.h"
+#include "sokol_time.h"
 
 #include "HandmadeMath.h"
+#include "compute_gl.h"
+#include "gpu_timer_gl.h"
+#include "scan_gl.h"
+#include "readback_gl.h"
+#include "particle_args.h"
+#include "particle_cpu.h"
+#include "particle_snapshot.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
 #include <random>
+#include <string>
 #include <vector>
 
 constexpr uint32_t SCREEN_WIDTH = 800;
 constexpr uint32_t SCREEN_HEIGHT = 600;
 
-constexpr uint32_t PARTICLE_COUNT = 8192;
+constexpr uint32_t DEFAULT_PARTICLE_COUNT = 8192;
+// particles are generated and uploaded in chunks of this size, so that
+// million-scale buffers never need a full-size copy on the CPU heap
+constexpr uint32_t PARTICLE_UPLOAD_CHUNK = 64 * 1024;
+// --validate checks this frame after (re)creating the particle buffers
+constexpr int VALIDATE_FRAME = 10;
+// --lag N keeps N + 1 particle state buffers in rotation
+constexpr int MAX_PARTICLE_LAG = 2;
+// the simulation advances in fixed steps of 1 / step_hz seconds and all steps
+// of a frame run as a loop inside the integrate kernel. After a hitch at most
+// MAX_SUBSTEPS are taken, the remaining time is dropped instead of caught up
+constexpr int DEFAULT_STEP_HZ = 240;
+constexpr int MAX_SUBSTEPS = 16;
+
+// --raster: particles are binned into RASTER_TILE_SIZE^2 pixel tiles, one
+// workgroup splats a tile in shared memory. Points are smaller than a tile,
+// so a particle overlaps at most 2x2 tiles
+constexpr int RASTER_TILE_SIZE = 32;
+constexpr int RASTER_MAX_TILES_PER_PARTICLE = 4;
+constexpr float PARTICLE_POINT_SIZE = 20.0f;
+
+// --cull: off-screen particles are dropped and the screen is split into LOD
+// cells of DEFAULT_CULL_CELL_SIZE pixels, each cell is drawn as one impostor
+// point (its topmost particle) however many particles it holds
+constexpr int DEFAULT_CULL_CELL_SIZE = 4;
+constexpr int CULL_ARGS_SIZE = 16;      // uint count, instance_count, first, base_instance
+
+struct cull_params_t{
+    int32_t num_particles;
+    int32_t cells_x;
+    int32_t cells_y;
+    int32_t cell_size;
+    int32_t img_w;
+    int32_t img_h;
+    float point_size;
+};
+
+// the clear, flag, scatter and args shaders read subsets of cull_params_t
+struct cull_clear_params_t{
+    int32_t cells_x;
+    int32_t cells_y;
+};
+
+struct cull_flag_params_t{
+    int32_t num_particles;
+    int32_t cells_x;
+    int32_t cells_y;
+    int32_t cell_size;
+    int32_t img_w;
+    int32_t img_h;
+};
+
+struct cull_count_params_t{
+    int32_t num_particles;
+};
+
+// tiling of the raster image
+struct raster_params_t{
+    int32_t tiles_x;
+    int32_t tiles_y;
+    int32_t img_w;
+    int32_t img_h;
+    float point_size;
+};
+
+// uniforms of the clear, bin (count and scatter) and splat shaders
+struct raster_clear_params_t{
+    int32_t tiles_x;
+    int32_t tiles_y;
+};
+
+struct raster_bin_params_t{
+    int32_t num_particles;
+    int32_t tiles_x;
+    int32_t img_w;
+    int32_t img_h;
+    float point_size;
+};
+
+struct raster_splat_params_t{
+    int32_t tiles_x;
+    int32_t img_w;
+    int32_t img_h;
+    float point_size;
+};
 
 struct cs_params_t{
     float dt;
     int32_t num_particles;
+    int32_t substeps;
+};
+
+struct init_params_t{
+    int32_t seed;
+    int32_t num_particles;
+};
+
+// uniforms of the fused vertex shader
+struct fused_params_t{
+    float time;
+    int32_t seed;
 };
 
 struct particle_t{
@@ -27,196 +138,4099 @@ struct particle_t{
     HMM_Vec4 color;
 };
 
+struct emit_params_t{
+    float emitter_pos[2];
+    float lifetime;
+    int32_t seed;
+};
+
+struct prepare_params_t{
+    int32_t num_to_emit;
+};
+
+struct reset_params_t{
+    int32_t num_particles;
+};
+
+struct simulate_params_t{
+    float dt;
+    int32_t substeps;
+};
+
+constexpr float DEFAULT_PARTICLE_LIFETIME = 4.0f;
+
+// GPU written indirect arguments of the lifecycle passes (byte offsets into
+// the args buffer), see sg_dispatch_indirect() / sg_draw_indirect()
+constexpr int LIFECYCLE_SIMULATE_ARGS_OFFSET = 0;   // uint num_groups_x, y, z
+constexpr int LIFECYCLE_EMIT_ARGS_OFFSET = 12;      // uint num_groups_x, y, z
+constexpr int LIFECYCLE_DRAW_ARGS_OFFSET = 24;      // uint count, instance_count, first, base_instance
+constexpr int LIFECYCLE_ARGS_SIZE = 40;
+
+// GPU side list sizes, must match counters_ssbo of the lifecycle shaders
+struct lifecycle_counters_t{
+    uint32_t alive_in_count;
+    uint32_t alive_out_count;
+    uint32_t dead_count;
+    uint32_t emit_count;
+};
+
+// particle-particle collisions on a uniform grid over the [-1, 1] domain,
+// the grid is capped at MAX_COLLIDE_GRID_DIM^2 cells
+constexpr uint32_t MAX_COLLIDE_GRID_DIM = 2048;
+
+struct collide_params_t{
+    float radius;
+    float cell_size;
+    int32_t grid_dim;
+    int32_t num_particles;
+};
+
+// the passes before the collision itself only read a part of collide_params_t
+struct collide_clear_params_t{
+    int32_t grid_dim;
+};
+
+struct collide_keys_params_t{
+    float cell_size;
+    int32_t grid_dim;
+    int32_t num_particles;
+};
+
+struct collide_scatter_params_t{
+    int32_t num_particles;
+};
+
+// N-body gravity: shared-memory tiled all-pairs for small counts, Barnes-Hut
+// over a dense quadtree pyramid (leaf level chosen from the particle count)
+// for large ones, auto switches above GRAVITY_TILED_MAX_PARTICLES
+enum gravity_mode_t {
+    GRAVITY_OFF,
+    GRAVITY_TILED,
+    GRAVITY_BARNES_HUT,
+    GRAVITY_AUTO,
+};
+constexpr uint32_t GRAVITY_TILED_MAX_PARTICLES = 64 * 1024;
+constexpr uint32_t GRAVITY_TILE_SIZE = 256;
+constexpr int GRAVITY_MIN_LEAF_LEVEL = 4;
+constexpr int GRAVITY_MAX_LEAF_LEVEL = 10;
+constexpr float GRAVITY_TOTAL_MASS = 0.05f;     // G * M of all particles together
+constexpr float GRAVITY_SOFTENING = 0.01f;
+constexpr float GRAVITY_THETA = 0.5f;
+
+// uniforms of the Barnes-Hut traversal, the other gravity passes read
+// smaller subsets with their own structs
+struct gravity_params_t{
+    float dt;
+    float strength;
+    float softening2;
+    float theta2;
+    int32_t num_particles;
+    int32_t leaf_level;
+};
+
+struct gravity_tiled_params_t{
+    float dt;
+    float strength;
+    float softening2;
+    int32_t num_particles;
+};
+
+struct gravity_insert_params_t{
+    int32_t num_particles;
+    int32_t leaf_level;
+};
+
+// tree level a clear, leaf or reduce pass works on
+struct gravity_level_params_t{
+    int32_t level;
+};
+
+// --curl: particles are dragged along a divergence-free 2D flow, the curl of a
+// tileable noise potential psi(x, y, z). The field is generated into a
+// CURL_FIELD_SIZE^3 texture once and sampled trilinearly per particle, z
+// scrolls with the simulated time so the flow evolves without regenerating
+constexpr int CURL_FIELD_SIZE = 64;
+constexpr float DEFAULT_CURL_SPEED = 0.5f;
+constexpr float CURL_DRAG = 2.0f;               // 1/s, how fast particles take on the flow velocity
+constexpr float CURL_FIELD_PERIOD = 20.0f;      // seconds until z wraps around
+constexpr int CURL_MAX_FREQUENCY = 16;
+
+// everything the field texture depends on, a change triggers a regeneration
+struct curl_field_params_t{
+    int32_t frequency;      // noise cells per field period
+    int32_t octaves;
+    int32_t seed;
+    int32_t size;
+};
+
+struct curl_params_t{
+    float dt;
+    float speed;
+    float drag;
+    float z;
+    int32_t num_particles;
+};
+
+// --stats: a reduction pass sums live count, speed and bounding box per
+// workgroup, a single workgroup folds the partials into particle_stats_t,
+// which is read back GPU_READBACK_LATENCY frames later
+constexpr uint32_t STATS_GROUP_SIZE = 256;
+constexpr int STATS_REPORT_INTERVAL = 60;
+
+struct particle_stats_t{
+    uint32_t num_live;
+    float avg_speed;
+    float min_x;
+    float min_y;
+    float max_x;
+    float max_y;
+    uint32_t pad[2];
+};
+
+struct stats_reduce_params_t{
+    int32_t num_particles;
+};
+
+struct stats_final_params_t{
+    int32_t num_partials;
+};
+
+// AOS: one particle_t record per particle in a single storage buffer
+// SOA: separate position, velocity and color buffers, so that the compute
+//      pass only touches pos/vel and the vertex shader only pos/color
+// PACKED: one 12 byte packed_particle_t record per particle (vs. 32 bytes),
+//      trading precision for memory bandwidth
+enum particle_layout_t {
+    PARTICLE_LAYOUT_AOS,
+    PARTICLE_LAYOUT_SOA,
+    PARTICLE_LAYOUT_PACKED,
+};
+
+// packed particle state, must match PACKED_PARTICLE_GLSL:
+//   pos:   2x 16 bit unorm over [-PACKED_POS_RANGE, PACKED_POS_RANGE], ~4e-5 steps
+//   vel:   2x half float
+//   color: 4x 8 bit unorm
+struct packed_particle_t{
+    uint32_t pos;
+    uint32_t vel;
+    uint32_t color;
+};
+
+// particles may overshoot the [-1, 1] border by one step before they flip,
+// so the quantized position range leaves some headroom
+constexpr float PACKED_POS_RANGE = 1.25f;
+
+const char* PACKED_PARTICLE_GLSL = R"(
+struct packed_particle_t {
+  uint pos;
+  uint vel;
+  uint color;
+};
+
+const float PACKED_POS_RANGE = 1.25;
+
+vec2 unpack_pos(uint p) {
+  return (unpackUnorm2x16(p) * 2.0 - 1.0) * PACKED_POS_RANGE;
+}
+uint pack_pos(vec2 pos) {
+  return packUnorm2x16(clamp(pos / PACKED_POS_RANGE, -1.0, 1.0) * 0.5 + 0.5);
+}
+)";
+
+// IEEE half conversion matching GLSL packHalf2x16 (round to nearest even,
+// overflow to inf, denormals preserved)
+uint16_t float_to_half(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    const uint32_t abs = x & 0x7FFFFFFFu;
+    if (abs >= 0x7F800000u) {
+        // inf / nan
+        return (uint16_t)(sign | 0x7C00u | (abs > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (abs >= 0x477FF000u) {
+        // rounds to above the largest half
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    if (abs < 0x38800000u) {
+        // denormal half or zero
+        if (abs < 0x33000000u) {
+            return (uint16_t)sign;
+        }
+        const uint32_t e = abs >> 23;
+        const uint32_t m = (abs & 0x7FFFFFu) | 0x800000u;
+        const uint32_t shift = 126 - e;
+        uint32_t h = m >> shift;
+        const uint32_t rem = m & ((1u << shift) - 1);
+        const uint32_t half_point = 1u << (shift - 1);
+        if ((rem > half_point) || ((rem == half_point) && (h & 1u))) {
+            h++;
+        }
+        return (uint16_t)(sign | h);
+    }
+    uint32_t h = ((abs - 0x38000000u) >> 13);
+    const uint32_t rem = abs & 0x1FFFu;
+    if ((rem > 0x1000u) || ((rem == 0x1000u) && (h & 1u))) {
+        h++;
+    }
+    return (uint16_t)(sign | h);
+}
+
+float half_to_float(uint16_t h) {
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    const uint32_t e = (h >> 10) & 0x1Fu;
+    uint32_t m = h & 0x3FFu;
+    uint32_t x;
+    if (e == 0x1Fu) {
+        x = sign | 0x7F800000u | (m << 13);
+    } else if (e != 0) {
+        x = sign | ((e + 112) << 23) | (m << 13);
+    } else if (m == 0) {
+        x = sign;
+    } else {
+        // renormalize the denormal
+        uint32_t exp = 113;
+        while ((m & 0x400u) == 0) {
+            m <<= 1;
+            exp--;
+        }
+        x = sign | (exp << 23) | ((m & 0x3FFu) << 13);
+    }
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+uint32_t pack_unorm16(float v) {
+    return (uint32_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+uint32_t pack_unorm8(float v) {
+    return (uint32_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+}
+
+packed_particle_t pack_particle(const particle_t& p) {
+    packed_particle_t r;
+    const float px = std::clamp(p.pos.X / PACKED_POS_RANGE, -1.0f, 1.0f) * 0.5f + 0.5f;
+    const float py = std::clamp(p.pos.Y / PACKED_POS_RANGE, -1.0f, 1.0f) * 0.5f + 0.5f;
+    r.pos = pack_unorm16(px) | (pack_unorm16(py) << 16);
+    r.vel = (uint32_t)float_to_half(p.vel.X) | ((uint32_t)float_to_half(p.vel.Y) << 16);
+    r.color = pack_unorm8(p.color.X) | (pack_unorm8(p.color.Y) << 8) | (pack_unorm8(p.color.Z) << 16) | (pack_unorm8(p.color.W) << 24);
+    return r;
+}
+
+particle_t unpack_particle(const packed_particle_t& p) {
+    particle_t r;
+    r.pos.X = ((float)(p.pos & 0xFFFFu) / 65535.0f * 2.0f - 1.0f) * PACKED_POS_RANGE;
+    r.pos.Y = ((float)(p.pos >> 16) / 65535.0f * 2.0f - 1.0f) * PACKED_POS_RANGE;
+    r.vel.X = half_to_float((uint16_t)(p.vel & 0xFFFFu));
+    r.vel.Y = half_to_float((uint16_t)(p.vel >> 16));
+    r.color = HMM_V4((float)(p.color & 0xFFu) / 255.0f,
+                     (float)((p.color >> 8) & 0xFFu) / 255.0f,
+                     (float)((p.color >> 16) & 0xFFu) / 255.0f,
+                     (float)(p.color >> 24) / 255.0f);
+    return r;
+}
+
 struct {
+    struct {
+        particle_layout_t layout;
+        bool cpu_init;
+        uint32_t particle_count;
+        uint32_t emit_rate;         // particles per second, 0 disables the emit/kill lifecycle
+        float lifetime;
+        gravity_mode_t gravity;
+        bool collide;
+        float collide_radius;       // 0: derived from the particle count
+        std::vector<uint32_t> sweep_counts;
+        bool bench;
+        bool validate;
+        bool fused;                 // evaluate particles analytically in the vertex shader, no compute pass
+        int lag;                    // frames between simulating a state and drawing it, 0: in place
+        bool raster;                // tile-binned compute rasterizer instead of GL points
+        int cull_cell_size;         // pixels per LOD cell, 0 disables the cull/compaction pass
+        int step_hz;                // fixed simulation steps per second
+        const char* save_path;      // snapshot written on S and at exit
+        float curl_speed;           // flow speed of the curl-noise field, 0 disables it
+        bool stats;                 // live telemetry through the async readback ring
+    } config;
+    struct {
+        size_t index;
+        int frame;
+        double frame_ms;
+        uint64_t num_barriers;
+        uint64_t num_substeps;
+    } sweep;
+    // fixed timestep: frame time is accumulated and consumed in whole steps
+    struct {
+        double accum;
+        int substeps;               // steps taken this frame
+        uint64_t num_dropped;       // steps skipped by the MAX_SUBSTEPS clamp
+        uint64_t num_steps;         // steps simulated since the state was seeded
+        bool untimed;               // stages of the steps after the first aren't stamped
+    } step;
+    uint32_t num_particles;
     struct {
         sg_buffer buf;
+        struct {
+            sg_buffer pos;
+            sg_buffer vel;
+            sg_buffer color;
+        } soa;
         sg_pipeline pip;
+        sg_pipeline init_pip;
+        // state slots, buf / soa.pos / soa.vel alias slot[head] (the newest state),
+        // with --lag the compute pass reads slot[head] and writes the slot after
+        // it, which also is the state from lag frames ago that the draw reads
+        sg_buffer slots[MAX_PARTICLE_LAG + 1];
+        sg_buffer pos_slots[MAX_PARTICLE_LAG + 1];
+        sg_buffer vel_slots[MAX_PARTICLE_LAG + 1];
+        int head;
+        sg_pipeline pingpong_pip;
     } compute;
     struct {
         sg_pipeline pip;
         sg_pass_action pass_action;
     } graphics;
+    // stateless particles: position is a closed-form function of the seed and
+    // the time since the buffers were (re)created
+    struct {
+        sg_pipeline pip;
+        double time;
+        int32_t seed;
+    } fused;
+    // emit/kill lifecycle: particle slots circulate between a dead list and
+    // two ping-ponged alive lists, all counts stay on the GPU
+    struct {
+        sg_buffer life;
+        sg_buffer alive[2];
+        sg_buffer dead;
+        sg_buffer counters;
+        sg_buffer args;
+        sg_pipeline reset_pip;
+        sg_pipeline prepare_pip;
+        sg_pipeline emit_pip;
+        sg_pipeline simulate_pip;
+        sg_pipeline finalize_pip;
+        sg_pipeline draw_pip;
+        int cur;
+        float emit_accum;
+        int32_t frame_seed;
+        HMM_Vec2 emitter_pos;
+    } lifecycle;
+    // spatial hash: particles are counting-sorted by grid cell each frame,
+    // then every particle only tests the 3x3 cells around it
+    struct {
+        sg_buffer cell_start;       // per-cell counts, exclusive prefix sum after the scan stage
+        sg_buffer particle_cell;
+        sg_buffer particle_rank;    // slot of the particle within its cell
+        sg_buffer sorted_pos_vel;   // vec4(pos, vel) in cell order
+        sg_buffer sorted_index;
+        sg_pipeline clear_pip;
+        sg_pipeline keys_pip;
+        sg_pipeline scatter_pip;
+        sg_pipeline collide_pip;
+        gpu_scan_t scan;
+        collide_params_t params;
+        uint32_t num_cells;
+    } collide;
+    struct {
+        sg_buffer leaves;           // per leaf: count and fixed-point position sums
+        sg_buffer nodes;            // vec4(center of mass, mass, 0) of every level
+        sg_buffer stats;            // 64-bit Barnes-Hut interaction counter
+        sg_pipeline tiled_pip;
+        sg_pipeline clear_pip;
+        sg_pipeline insert_pip;
+        sg_pipeline leaf_pip;
+        sg_pipeline reduce_pip;
+        sg_pipeline traverse_pip;
+        gravity_mode_t mode;
+        int leaf_level;
+        uint32_t num_frames;        // traversals (one per step) accumulated in stats
+    } gravity;
+    // --raster: binning + shared memory splatting into a storage image, which
+    // is composited with a full-screen quad like in GLnoise
+    struct {
+        sg_buffer tile_offset;      // per-tile counts, exclusive prefix sum after the scan stage (num_tiles + 1)
+        sg_buffer tile_fill;        // per-tile scatter cursors
+        sg_buffer tile_list;        // particle indices grouped by tile
+        sg_image img;
+        sg_attachments atts;
+        sg_sampler smp;
+        sg_pipeline clear_pip;
+        sg_pipeline count_pip;
+        sg_pipeline scatter_pip;
+        sg_pipeline raster_pip;
+        sg_pipeline composite_pip;
+        gpu_scan_t scan;
+        raster_params_t params;
+    } raster;
+    // --cull: per cell the topmost visible particle survives, the survivors are
+    // compacted in particle order into a draw list consumed by an indirect draw
+    struct {
+        sg_buffer cell_winner;      // highest particle index + 1 per LOD cell
+        sg_buffer offsets;          // survivor flags, exclusive prefix sum after the scan stage (num_particles + 1)
+        sg_buffer draw_list;
+        sg_buffer args;
+        sg_pipeline clear_pip;
+        sg_pipeline mark_pip;
+        sg_pipeline flag_pip;
+        sg_pipeline scatter_pip;
+        sg_pipeline args_pip;
+        sg_pipeline draw_pip;
+        gpu_scan_t scan;
+        cull_params_t params;
+    } cull;
+    // CPU reference of one integrate step, see particle_cpu.h
+    struct {
+        particle_cpu_state_t expected;
+        particle_cpu_state_t result;
+        particle_cpu_pool_t pool;
+        int frame;
+        std::vector<uint32_t> alive;    // --emit: slots alive before the validated frame
+    } validate;
+    struct {
+        sg_image field;
+        sg_attachments atts;
+        sg_sampler smp;
+        sg_pipeline generate_pip;
+        sg_pipeline advect_pip;
+        curl_field_params_t params;         // wanted
+        curl_field_params_t generated;      // what the texture holds
+        bool valid;
+        uint32_t num_generated;
+    } curl;
+    struct {
+        sg_buffer partials;         // per workgroup: count, speed sum, bounds
+        sg_buffer result;           // particle_stats_t
+        sg_pipeline reduce_pip;
+        sg_pipeline final_pip;
+        gpu_readback_t readback;
+        particle_stats_t latest;
+        bool valid;
+    } stats;
+    struct {
+        particle_snapshot_writer_t writer;
+        particle_snapshot_t loaded;     // --load, mapped until exit
+        bool save_requested;
+    } snapshot;
+    gpu_timer_t timer;
 } state;
 
-void init() {
-    sg_desc _sg_desc{};
-    _sg_desc.environment = sglue_environment();
-    _sg_desc.logger.func = slog_func;
-    sg_setup(&_sg_desc);
+bool lifecycle_enabled() {
+    return state.config.emit_rate > 0;
+}
 
-    // compute
-    {
-        std::default_random_engine rndEngine((uint32_t)time(nullptr));
-        std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+// gravity, curl and collisions act between fixed steps, so they need one
+// integration dispatch per step instead of one looping dispatch per frame
+bool forces_enabled() {
+    return (state.gravity.mode != GRAVITY_OFF) || (state.config.curl_speed > 0.0f) || state.config.collide;
+}
+
+// stamp a force stage, only the first step of a frame is split into stages so
+// that the number of stamps doesn't depend on the number of steps
+void stage_stamp(const char* name) {
+    if (!state.step.untimed) {
+        gpu_timer_stamp(&state.timer, name);
+    }
+}
+
+// upload a sub-range of an immutable storage buffer directly through GL (sokol
+// only allows initial data for immutable buffers), GL_COPY_WRITE_BUFFER isn't
+// tracked by the sokol state cache
+void upload_buffer_range(sg_buffer buf, size_t offset, const void* data, size_t size) {
+    const sg_gl_buffer_info info = sg_gl_query_buffer_info(buf);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, info.buf[info.active_slot]);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLsizeiptr)size, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// blocking readback, only used for occasional reports
+void download_buffer_range(sg_buffer buf, size_t offset, void* data, size_t size) {
+    const sg_gl_buffer_info info = sg_gl_query_buffer_info(buf);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, info.buf[info.active_slot]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, (GLintptr)offset, (GLsizeiptr)size, data);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+// GPU side copy between two buffers, waits for earlier shader writes
+void copy_buffer(sg_buffer src, sg_buffer dst, size_t size) {
+    const sg_gl_buffer_info src_info = sg_gl_query_buffer_info(src);
+    const sg_gl_buffer_info dst_info = sg_gl_query_buffer_info(dst);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, src_info.buf[src_info.active_slot]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dst_info.buf[dst_info.active_slot]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// GLSL declarations of the particle position/velocity buffers for the
+// current layout (bindings 0 and 1), accessed through load_pos(i) / store_pos(i, v)
+// and load_vel(i) / store_vel(i, v) so that extra simulation stages are written
+// once for all layouts
+std::string particle_state_decls() {
+    if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+        return R"(
+struct particle_t {
+  vec2 pos;
+  vec2 vel;
+  vec4 color;
+};
+
+layout(std430, binding=0) buffer ssbo {
+  particle_t prt[];
+};
+vec2 load_pos(uint i) { return prt[i].pos; }
+vec2 load_vel(uint i) { return prt[i].vel; }
+void store_pos(uint i, vec2 v) { prt[i].pos = v; }
+void store_vel(uint i, vec2 v) { prt[i].vel = v; }
+)";
+    }
+    if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+        return std::string(PACKED_PARTICLE_GLSL) + R"(
+layout(std430, binding=0) buffer ssbo {
+  packed_particle_t prt[];
+};
+vec2 load_pos(uint i) { return unpack_pos(prt[i].pos); }
+vec2 load_vel(uint i) { return unpackHalf2x16(prt[i].vel); }
+void store_pos(uint i, vec2 v) { prt[i].pos = pack_pos(v); }
+void store_vel(uint i, vec2 v) { prt[i].vel = packHalf2x16(v); }
+)";
+    }
+    return R"(
+layout(std430, binding=0) buffer pos_ssbo {
+  vec2 prt_pos[];
+};
+layout(std430, binding=1) buffer vel_ssbo {
+  vec2 prt_vel[];
+};
+vec2 load_pos(uint i) { return prt_pos[i]; }
+vec2 load_vel(uint i) { return prt_vel[i]; }
+void store_pos(uint i, vec2 v) { prt_pos[i] = v; }
+void store_vel(uint i, vec2 v) { prt_vel[i] = v; }
+)";
+}
+
+// GLSL write access to the particle colors for passes that spawn particles,
+// store_color(i, c) next to particle_state_decls() (binding 2 for SOA)
+std::string particle_color_decls() {
+    if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+        return "void store_color(uint i, vec4 c) { prt[i].color = c; }\n";
+    }
+    if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+        return "void store_color(uint i, vec4 c) { prt[i].color = packUnorm4x8(c); }\n";
+    }
+    return R"(
+layout(std430, binding=2) buffer color_ssbo {
+  vec4 prt_color[];
+};
+void store_color(uint i, vec4 c) { prt_color[i] = c; }
+)";
+}
+
+uint32_t particle_color_sbufs() {
+    return state.config.layout == PARTICLE_LAYOUT_SOA ? 0x4 : 0x0;
+}
+
+// GLSL read-only access to the particle state that is drawn, draw_pos(i) and
+// draw_color(i) on binding 0 (and 2 for the SOA colors)
+std::string particle_draw_decls() {
+    if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+        return R"(
+struct particle_t {
+  vec2 pos;
+  vec2 vel;
+  vec4 color;
+};
+
+layout(std430, binding=0) readonly buffer ssbo {
+  particle_t prt[];
+};
+vec2 draw_pos(uint i) { return prt[i].pos; }
+vec4 draw_color(uint i) { return prt[i].color; }
+)";
+    }
+    if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+        return std::string(PACKED_PARTICLE_GLSL) + R"(
+layout(std430, binding=0) readonly buffer ssbo {
+  packed_particle_t prt[];
+};
+vec2 draw_pos(uint i) { return unpack_pos(prt[i].pos); }
+vec4 draw_color(uint i) { return unpackUnorm4x8(prt[i].color); }
+)";
+    }
+    return R"(
+layout(std430, binding=0) readonly buffer pos_ssbo {
+  vec2 prt_pos[];
+};
+layout(std430, binding=2) readonly buffer color_ssbo {
+  vec4 prt_color[];
+};
+vec2 draw_pos(uint i) { return prt_pos[i]; }
+vec4 draw_color(uint i) { return prt_color[i]; }
+)";
+}
+
+uint32_t particle_draw_sbufs() {
+    return state.config.layout == PARTICLE_LAYOUT_SOA ? 0x5 : 0x1;
+}
+
+// integrate and border bounce of one particle on top of load_pos/load_vel and
+// store_pos/store_vel, shared by every integrate kernel (in place, --lag and
+// the lifecycle simulate pass), expects the dt and substeps uniforms
+const char* INTEGRATE_GLSL = R"(
+void integrate_particle(uint idx) {
+  vec2 pos = load_pos(idx);
+  vec2 vel = load_vel(idx);
+  // all fixed steps of the frame, the state stays in registers in between
+  for (int i = 0; i < substeps; i++) {
+    pos = pos + vel * dt;
+
+    // Flip movement at window border
+    if ( (pos.x <= -1.0) || (pos.x >= 1.0) ) {
+        vel.x *= -1.0;
+    }
+    if ( (pos.y <= -1.0) || (pos.y >= 1.0) ) {
+        vel.y *= -1.0;
+    }
+  }
+
+  store_pos(idx, pos);
+  store_vel(idx, vel);
+}
+)";
+
+// integrate kernel over all particles on the state declared by decls
+std::string integrate_compute_source(const std::string& decls) {
+    return R"(
+#version 430
+uniform float dt;
+uniform int num_particles;
+uniform int substeps;
+)" + decls + INTEGRATE_GLSL + R"(
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+  uint idx = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+  if (idx >= num_particles) {
+    return;
+  }
+  integrate_particle(idx);
+}
+)";
+}
+
+// compute source of the --lag integrate pass: reads the state at bindings 0/1
+// and writes the next state slot at bindings 3/4, color is never written
+// since all slots start with the same colors
+std::string pingpong_compute_source() {
+    std::string source;
+    if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+        source += R"(
+layout(std430, binding=0) readonly buffer pos_in_ssbo {
+  vec2 pos_in[];
+};
+layout(std430, binding=1) readonly buffer vel_in_ssbo {
+  vec2 vel_in[];
+};
+layout(std430, binding=3) writeonly buffer pos_out_ssbo {
+  vec2 pos_out[];
+};
+layout(std430, binding=4) writeonly buffer vel_out_ssbo {
+  vec2 vel_out[];
+};
+vec2 load_pos(uint i) { return pos_in[i]; }
+vec2 load_vel(uint i) { return vel_in[i]; }
+void store_pos(uint i, vec2 v) { pos_out[i] = v; }
+void store_vel(uint i, vec2 v) { vel_out[i] = v; }
+)";
+    } else if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+        source += PACKED_PARTICLE_GLSL;
+        source += R"(
+layout(std430, binding=0) readonly buffer ssbo_in {
+  packed_particle_t prt_in[];
+};
+layout(std430, binding=3) writeonly buffer ssbo_out {
+  packed_particle_t prt_out[];
+};
+vec2 load_pos(uint i) { return unpack_pos(prt_in[i].pos); }
+vec2 load_vel(uint i) { return unpackHalf2x16(prt_in[i].vel); }
+void store_pos(uint i, vec2 v) { prt_out[i].pos = pack_pos(v); }
+void store_vel(uint i, vec2 v) { prt_out[i].vel = packHalf2x16(v); }
+)";
+    } else {
+        source += R"(
+struct particle_t {
+  vec2 pos;
+  vec2 vel;
+  vec4 color;
+};
+
+layout(std430, binding=0) readonly buffer ssbo_in {
+  particle_t prt_in[];
+};
+layout(std430, binding=3) writeonly buffer ssbo_out {
+  particle_t prt_out[];
+};
+vec2 load_pos(uint i) { return prt_in[i].pos; }
+vec2 load_vel(uint i) { return prt_in[i].vel; }
+void store_pos(uint i, vec2 v) { prt_out[i].pos = v; }
+void store_vel(uint i, vec2 v) { prt_out[i].vel = v; }
+)";
+    }
+    return integrate_compute_source(source);
+}
+
+uint32_t particle_state_sbufs() {
+    return state.config.layout == PARTICLE_LAYOUT_SOA ? 0x3 : 0x1;
+}
+
+// size of one particle in the storage buffers of the current layout
+uint32_t particle_state_bytes() {
+    if (state.config.fused) {
+        return 0;
+    }
+    switch (state.config.layout) {
+        case PARTICLE_LAYOUT_SOA: return 2 * sizeof(HMM_Vec2) + sizeof(HMM_Vec4);
+        case PARTICLE_LAYOUT_PACKED: return sizeof(packed_particle_t);
+        default: return sizeof(particle_t);
+    }
+}
+
+// bytes moved per particle by the integrate pass (pos/vel read + write) and
+// the vertex shader (pos/color read), interleaved layouts pull in whole
+// records because neighbouring particles share the cache lines
+uint32_t particle_compute_bytes() {
+    return state.config.layout == PARTICLE_LAYOUT_SOA ? 4 * sizeof(HMM_Vec2) : 2 * particle_state_bytes();
+}
+
+uint32_t particle_graphics_bytes() {
+    return state.config.layout == PARTICLE_LAYOUT_SOA ? sizeof(HMM_Vec2) + sizeof(HMM_Vec4) : particle_state_bytes();
+}
+
+// reference path: generate particles on the CPU and upload them chunk by chunk
+void init_particles_cpu(uint32_t count) {
+    std::default_random_engine rndEngine((uint32_t)time(nullptr));
+    std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+
+    std::vector<particle_t> particles{PARTICLE_UPLOAD_CHUNK};
+    std::vector<HMM_Vec2> pos;
+    std::vector<HMM_Vec2> vel;
+    std::vector<HMM_Vec4> color;
+    std::vector<packed_particle_t> packed;
+    if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+        packed.resize(PARTICLE_UPLOAD_CHUNK);
+    }
+    if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+        pos.resize(PARTICLE_UPLOAD_CHUNK);
+        vel.resize(PARTICLE_UPLOAD_CHUNK);
+        color.resize(PARTICLE_UPLOAD_CHUNK);
+    }
+    for (uint32_t base = 0; base < count; base += PARTICLE_UPLOAD_CHUNK) {
+        const uint32_t num = std::min(PARTICLE_UPLOAD_CHUNK, count - base);
+        for (uint32_t i = 0; i < num; i++) {
+            float r = 0.25f * std::sqrt(rndDist(rndEngine));
+            float theta = rndDist(rndEngine) * 2.0f * 3.14159265358979323846f;
+            float x = r * std::cos(theta) * SCREEN_HEIGHT / SCREEN_HEIGHT;
+            float y = r * std::sin(theta);
+            particles[i].pos = HMM_V2(x, y);
+            particles[i].vel = HMM_Norm(HMM_V2(x, y)) * 0.25f;
+            particles[i].color = HMM_V4(rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine));
+        }
+
+        if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+            upload_buffer_range(state.compute.buf, sizeof(particle_t) * base, particles.data(), sizeof(particle_t) * num);
+        } else if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+            for (uint32_t i = 0; i < num; i++) {
+                packed[i] = pack_particle(particles[i]);
+            }
+            upload_buffer_range(state.compute.buf, sizeof(packed_particle_t) * base, packed.data(), sizeof(packed_particle_t) * num);
+        } else {
+            for (uint32_t i = 0; i < num; i++) {
+                pos[i] = particles[i].pos;
+                vel[i] = particles[i].vel;
+                color[i] = particles[i].color;
+            }
+            upload_buffer_range(state.compute.soa.pos, sizeof(HMM_Vec2) * base, pos.data(), sizeof(HMM_Vec2) * num);
+            upload_buffer_range(state.compute.soa.vel, sizeof(HMM_Vec2) * base, vel.data(), sizeof(HMM_Vec2) * num);
+            upload_buffer_range(state.compute.soa.color, sizeof(HMM_Vec4) * base, color.data(), sizeof(HMM_Vec4) * num);
+        }
+    }
+}
+
+// seed the particle buffers in place with the init compute pipeline, no data
+// is uploaded from the CPU
+void init_particles_gpu(uint32_t count) {
+    const init_params_t init_params = { (int32_t)time(nullptr), (int32_t)count };
+
+    sg_bindings _init_bindings{};
+    if (state.config.layout != PARTICLE_LAYOUT_SOA) {
+        _init_bindings.storage_buffers[0] = state.compute.buf;
+    } else {
+        _init_bindings.storage_buffers[0] = state.compute.soa.pos;
+        _init_bindings.storage_buffers[1] = state.compute.soa.vel;
+        _init_bindings.storage_buffers[2] = state.compute.soa.color;
+    }
+    sg_pass _init_pass = { .compute=true, .label="init_pass" };
+    sg_begin_pass(&_init_pass);
+    sg_apply_pipeline(state.compute.init_pip);
+    sg_apply_bindings(_init_bindings);
+    sg_apply_uniforms(0, SG_RANGE(init_params));
+    dispatch_items(count);
+    sg_end_pass();
+}
+
+// blocking readback of the GPU position/velocity state into SoA lanes
+void download_particle_state(particle_cpu_state_t* s) {
+    const uint32_t count = state.num_particles;
+    particle_cpu_resize(s, count);
+    std::vector<particle_t> particles;
+    std::vector<packed_particle_t> packed;
+    std::vector<HMM_Vec2> pos;
+    std::vector<HMM_Vec2> vel;
+    for (uint32_t base = 0; base < count; base += PARTICLE_UPLOAD_CHUNK) {
+        const uint32_t num = std::min(PARTICLE_UPLOAD_CHUNK, count - base);
+        if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+            particles.resize(num);
+            download_buffer_range(state.compute.buf, sizeof(particle_t) * base, particles.data(), sizeof(particle_t) * num);
+        } else if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+            particles.resize(num);
+            packed.resize(num);
+            download_buffer_range(state.compute.buf, sizeof(packed_particle_t) * base, packed.data(), sizeof(packed_particle_t) * num);
+            for (uint32_t i = 0; i < num; i++) {
+                particles[i] = unpack_particle(packed[i]);
+            }
+        } else {
+            particles.resize(num);
+            pos.resize(num);
+            vel.resize(num);
+            download_buffer_range(state.compute.soa.pos, sizeof(HMM_Vec2) * base, pos.data(), sizeof(HMM_Vec2) * num);
+            download_buffer_range(state.compute.soa.vel, sizeof(HMM_Vec2) * base, vel.data(), sizeof(HMM_Vec2) * num);
+            for (uint32_t i = 0; i < num; i++) {
+                particles[i].pos = pos[i];
+                particles[i].vel = vel[i];
+            }
+        }
+        for (uint32_t i = 0; i < num; i++) {
+            s->pos_x[base + i] = particles[i].pos.X;
+            s->pos_y[base + i] = particles[i].pos.Y;
+            s->vel_x[base + i] = particles[i].vel.X;
+            s->vel_y[base + i] = particles[i].vel.Y;
+        }
+    }
+}
+
+// snapshot section sizes of count particles in layout, returns the number of
+// sections
+int particle_snapshot_sizes(particle_layout_t layout, uint32_t count, size_t* sizes) {
+    switch (layout) {
+        case PARTICLE_LAYOUT_SOA: {
+            sizes[0] = sizeof(HMM_Vec2) * count;
+            sizes[1] = sizeof(HMM_Vec2) * count;
+            sizes[2] = sizeof(HMM_Vec4) * count;
+            return 3;
+        }
+        case PARTICLE_LAYOUT_PACKED: {
+            sizes[0] = sizeof(packed_particle_t) * count;
+            return 1;
+        }
+        default: {
+            sizes[0] = sizeof(particle_t) * count;
+            return 1;
+        }
+    }
+}
+
+// storage buffers of the newest state in snapshot section order, returns the
+// number of sections
+int particle_snapshot_buffers(uint32_t count, sg_buffer* buffers, size_t* sizes) {
+    if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+        buffers[0] = state.compute.soa.pos;
+        buffers[1] = state.compute.soa.vel;
+        buffers[2] = state.compute.soa.color;
+    } else {
+        buffers[0] = state.compute.buf;
+    }
+    return particle_snapshot_sizes(state.config.layout, count, sizes);
+}
+
+// queue an async save of the newest state, the file is written by
+// particle_snapshot_poll() a few frames later
+void save_particle_snapshot() {
+    sg_buffer buffers[PARTICLE_SNAPSHOT_MAX_SECTIONS];
+    size_t sizes[PARTICLE_SNAPSHOT_MAX_SECTIONS];
+    const int num_sections = particle_snapshot_buffers(state.num_particles, buffers, sizes);
+    particle_snapshot_header_t header{};
+    header.layout = (uint32_t)state.config.layout;
+    header.num_particles = state.num_particles;
+    header.step_hz = (uint32_t)state.config.step_hz;
+    header.num_steps = state.step.num_steps;
+    if (!particle_snapshot_begin_save(&state.snapshot.writer, state.config.save_path, header, buffers, sizes, num_sections)) {
+        printf("snapshot: previous save still in flight, skipped\n");
+    }
+}
+
+// keep only the particles of the ascending slots, in place
+void compact_particle_state(particle_cpu_state_t* s, const std::vector<uint32_t>& slots) {
+    for (size_t i = 0; i < slots.size(); i++) {
+        s->pos_x[i] = s->pos_x[slots[i]];
+        s->pos_y[i] = s->pos_y[slots[i]];
+        s->vel_x[i] = s->vel_x[slots[i]];
+        s->vel_y[i] = s->vel_y[slots[i]];
+    }
+    particle_cpu_resize(s, (uint32_t)slots.size());
+}
+
+// compare the GPU integrate result with the CPU step prepared in frame(),
+// only the particles of slots if given
+void validate_particles(const char* label, const std::vector<uint32_t>* slots = nullptr) {
+    particle_cpu_state_t& expected = state.validate.expected;
+    download_particle_state(&state.validate.result);
+    if (slots) {
+        compact_particle_state(&expected, *slots);
+        compact_particle_state(&state.validate.result, *slots);
+    }
+    // the GPU stores the packed layout quantized, so round the CPU result the same way
+    float pos_tol = 1.0e-5f;
+    if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+        for (uint32_t i = 0; i < expected.num_particles; i++) {
+            particle_t p{};
+            p.pos = HMM_V2(expected.pos_x[i], expected.pos_y[i]);
+            p.vel = HMM_V2(expected.vel_x[i], expected.vel_y[i]);
+            p = unpack_particle(pack_particle(p));
+            expected.pos_x[i] = p.pos.X;
+            expected.pos_y[i] = p.pos.Y;
+            expected.vel_x[i] = p.vel.X;
+            expected.vel_y[i] = p.vel.Y;
+        }
+        pos_tol = 2.0f * PACKED_POS_RANGE / 65535.0f;
+    }
+    const particle_cpu_compare_t cmp = particle_cpu_compare(expected, state.validate.result, pos_tol, 1.0e-6f);
+    printf("%s %10u particles: validate vs cpu (%s, %uT): max pos error %.3e | max vel error %.3e | %u mismatches | %s\n",
+        label,
+        expected.num_particles,
+        particle_cpu_simd_name(),
+        particle_cpu_pool_size(&state.validate.pool),
+        cmp.max_pos_error,
+        cmp.max_vel_error,
+        cmp.mismatches,
+        cmp.mismatches == 0 ? "ok" : "MISMATCH");
+    fflush(stdout);
+}
+
+sg_bindings particle_state_bindings() {
+    sg_bindings _bindings{};
+    if (state.config.layout != PARTICLE_LAYOUT_SOA) {
+        _bindings.storage_buffers[0] = state.compute.buf;
+    } else {
+        _bindings.storage_buffers[0] = state.compute.soa.pos;
+        _bindings.storage_buffers[1] = state.compute.soa.vel;
+    }
+    return _bindings;
+}
+
+// storage buffers of the state to draw, with --lag the oldest slot, which
+// was written lag frames ago and isn't touched by this frame's compute pass,
+// so the draw needs no barrier and doesn't wait for it
+sg_bindings particle_draw_bindings() {
+    const int slot = state.config.lag > 0 ? (state.compute.head + 1) % (state.config.lag + 1) : state.compute.head;
+    sg_bindings _bindings{};
+    if (state.config.layout != PARTICLE_LAYOUT_SOA) {
+        _bindings.storage_buffers[0] = state.compute.slots[slot];
+    } else {
+        _bindings.storage_buffers[0] = state.compute.pos_slots[slot];
+        _bindings.storage_buffers[2] = state.compute.soa.color;
+    }
+    return _bindings;
+}
+
+void create_lifecycle_buffers(uint32_t count) {
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.size = sizeof(float) * count;
+    _sg_buffer_desc.label = "particle-life-buffer";
+    state.lifecycle.life = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(uint32_t) * count;
+    _sg_buffer_desc.label = "alive-list-0";
+    state.lifecycle.alive[0] = sg_make_buffer(&_sg_buffer_desc);
+    _sg_buffer_desc.label = "alive-list-1";
+    state.lifecycle.alive[1] = sg_make_buffer(&_sg_buffer_desc);
+    _sg_buffer_desc.label = "dead-list";
+    state.lifecycle.dead = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(uint32_t) * 4;
+    _sg_buffer_desc.label = "lifecycle-counters";
+    state.lifecycle.counters = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = LIFECYCLE_ARGS_SIZE;
+    _sg_buffer_desc.label = "lifecycle-indirect-args";
+    state.lifecycle.args = sg_make_buffer(&_sg_buffer_desc);
+}
+
+// bindings of the reset, emit and simulate passes: the particle state of the
+// layout, alive[cur] receives the survivors of this frame
+sg_bindings lifecycle_compute_bindings() {
+    sg_bindings _bindings = particle_state_bindings();
+    if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+        _bindings.storage_buffers[2] = state.compute.soa.color;
+    }
+    _bindings.storage_buffers[3] = state.lifecycle.alive[state.lifecycle.cur];
+    _bindings.storage_buffers[4] = state.lifecycle.alive[state.lifecycle.cur ^ 1];
+    _bindings.storage_buffers[5] = state.lifecycle.counters;
+    _bindings.storage_buffers[6] = state.lifecycle.life;
+    _bindings.storage_buffers[7] = state.lifecycle.dead;
+    return _bindings;
+}
+
+// bindings of the prepare and finalize passes, which write the indirect arguments
+sg_bindings lifecycle_args_bindings() {
+    sg_bindings _bindings{};
+    _bindings.storage_buffers[5] = state.lifecycle.counters;
+    _bindings.storage_buffers[6] = state.lifecycle.args;
+    return _bindings;
+}
+
+// all particle slots start out on the dead list
+void reset_lifecycle() {
+    state.lifecycle.cur = 0;
+    state.lifecycle.emit_accum = 0.0f;
+    const reset_params_t reset_params = { (int32_t)state.num_particles };
+    sg_pass _reset_pass = { .compute=true, .label="lifecycle-reset-pass" };
+    sg_begin_pass(&_reset_pass);
+    sg_apply_pipeline(state.lifecycle.reset_pip);
+    sg_apply_bindings(lifecycle_compute_bindings());
+    sg_apply_uniforms(0, SG_RANGE(reset_params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+}
+
+void lifecycle_compute_pass(const cs_params_t& cs_params) {
+    state.lifecycle.cur ^= 1;
+
+    // emission budget for this frame, the GPU clamps it to the dead list size
+    state.lifecycle.emit_accum += (float)state.config.emit_rate * cs_params.dt * cs_params.substeps;
+    const uint32_t num_to_emit = std::min((uint32_t)state.lifecycle.emit_accum, state.num_particles);
+    state.lifecycle.emit_accum -= (float)num_to_emit;
+
+    const prepare_params_t prepare_params = { (int32_t)num_to_emit };
+    const emit_params_t emit_params = {
+        { state.lifecycle.emitter_pos.X, state.lifecycle.emitter_pos.Y },
+        state.config.lifetime,
+        state.lifecycle.frame_seed++,
+    };
+    const simulate_params_t simulate_params = { cs_params.dt, cs_params.substeps };
+    const sg_bindings _bindings = lifecycle_compute_bindings();
+    const sg_bindings _args_bindings = lifecycle_args_bindings();
+
+    sg_pass _compute_pass = { .compute=true, .label="lifecycle-pass" };
+    sg_begin_pass(&_compute_pass);
+    sg_apply_pipeline(state.lifecycle.prepare_pip);
+    sg_apply_bindings(_args_bindings);
+    sg_apply_uniforms(0, SG_RANGE(prepare_params));
+    sg_dispatch(1, 1, 1);
+    if (num_to_emit > 0) {
+        sg_apply_pipeline(state.lifecycle.emit_pip);
+        sg_apply_bindings(_bindings);
+        sg_apply_uniforms(0, SG_RANGE(emit_params));
+        sg_dispatch_indirect(state.lifecycle.args, LIFECYCLE_EMIT_ARGS_OFFSET);
+    }
+    sg_apply_pipeline(state.lifecycle.simulate_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(simulate_params));
+    sg_dispatch_indirect(state.lifecycle.args, LIFECYCLE_SIMULATE_ARGS_OFFSET);
+    sg_apply_pipeline(state.lifecycle.finalize_pip);
+    sg_apply_bindings(_args_bindings);
+    sg_dispatch(1, 1, 1);
+    sg_end_pass();
+}
+
+// blocking readback of the newest alive list in ascending slot order
+std::vector<uint32_t> download_alive_slots(const lifecycle_counters_t& counters) {
+    std::vector<uint32_t> slots(std::min(counters.alive_out_count, state.num_particles));
+    download_buffer_range(state.lifecycle.alive[state.lifecycle.cur], 0, slots.data(), sizeof(uint32_t) * slots.size());
+    std::sort(slots.begin(), slots.end());
+    return slots;
+}
+
+lifecycle_counters_t download_lifecycle_counters() {
+    lifecycle_counters_t counters{};
+    download_buffer_range(state.lifecycle.counters, 0, &counters, sizeof(counters));
+    return counters;
+}
+
+// every slot must be on either the alive or the dead list exactly once, the
+// survivors that were alive before the frame are compared with the CPU
+// reference, particles emitted this frame have none
+void validate_lifecycle(const char* label) {
+    const lifecycle_counters_t counters = download_lifecycle_counters();
+    const std::vector<uint32_t> alive = download_alive_slots(counters);
+    std::vector<uint32_t> dead(std::min(counters.dead_count, state.num_particles));
+    download_buffer_range(state.lifecycle.dead, 0, dead.data(), sizeof(uint32_t) * dead.size());
+
+    std::vector<uint8_t> seen(state.num_particles, 0);
+    uint32_t num_bad = 0;
+    const std::vector<uint32_t>* lists[] = { &alive, &dead };
+    for (const std::vector<uint32_t>* list : lists) {
+        for (uint32_t slot : *list) {
+            if ((slot >= state.num_particles) || seen[slot]) {
+                num_bad++;
+            } else {
+                seen[slot] = 1;
+            }
+        }
+    }
+    num_bad += (uint32_t)std::count(seen.begin(), seen.end(), 0);
+    printf("%s %10u slots: %u alive | %u dead | %u lost or duplicated | %s\n",
+        label,
+        state.num_particles,
+        counters.alive_out_count,
+        counters.dead_count,
+        num_bad,
+        num_bad == 0 ? "ok" : "MISMATCH");
+
+    std::vector<uint32_t> survivors;
+    std::set_intersection(state.validate.alive.begin(), state.validate.alive.end(), alive.begin(), alive.end(), std::back_inserter(survivors));
+    validate_particles(label, &survivors);
+}
+
+void create_collide_buffers(uint32_t count) {
+    // the cell size must cover a particle diameter, by default the radius
+    // is chosen so that a uniformly filled domain holds ~1 particle per cell
+    const float radius = state.config.collide_radius > 0.0f ? state.config.collide_radius : 1.0f / sqrtf((float)count);
+    const uint32_t grid_dim = std::clamp((uint32_t)(1.0f / radius), 1u, MAX_COLLIDE_GRID_DIM);
+    state.collide.params = { radius, 2.0f / (float)grid_dim, (int32_t)grid_dim, (int32_t)count };
+    state.collide.num_cells = grid_dim * grid_dim;
+
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.size = sizeof(uint32_t) * (state.collide.num_cells + 1);
+    _sg_buffer_desc.label = "collide-cell-start";
+    state.collide.cell_start = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(uint32_t) * count;
+    _sg_buffer_desc.label = "collide-particle-cell";
+    state.collide.particle_cell = sg_make_buffer(&_sg_buffer_desc);
+    _sg_buffer_desc.label = "collide-particle-rank";
+    state.collide.particle_rank = sg_make_buffer(&_sg_buffer_desc);
+    _sg_buffer_desc.label = "collide-sorted-index";
+    state.collide.sorted_index = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(HMM_Vec4) * count;
+    _sg_buffer_desc.label = "collide-sorted-pos-vel";
+    state.collide.sorted_pos_vel = sg_make_buffer(&_sg_buffer_desc);
+
+    gpu_scan_init(&state.collide.scan, state.collide.num_cells + 1);
+}
+
+void destroy_collide_buffers() {
+    gpu_scan_shutdown(&state.collide.scan);
+    sg_destroy_buffer(state.collide.cell_start);
+    sg_destroy_buffer(state.collide.particle_cell);
+    sg_destroy_buffer(state.collide.particle_rank);
+    sg_destroy_buffer(state.collide.sorted_index);
+    sg_destroy_buffer(state.collide.sorted_pos_vel);
+}
+
+sg_bindings collide_bindings() {
+    sg_bindings _bindings = particle_state_bindings();
+    _bindings.storage_buffers[2] = state.collide.cell_start;
+    _bindings.storage_buffers[3] = state.collide.particle_cell;
+    _bindings.storage_buffers[4] = state.collide.particle_rank;
+    _bindings.storage_buffers[5] = state.collide.sorted_pos_vel;
+    _bindings.storage_buffers[6] = state.collide.sorted_index;
+    return _bindings;
+}
+
+// one compute pass per stage, so that each stage gets its own timer span
+void collide_passes() {
+    const sg_bindings _bindings = collide_bindings();
+    const collide_params_t& params = state.collide.params;
+    const collide_clear_params_t clear_params = { params.grid_dim };
+    const collide_keys_params_t keys_params = { params.cell_size, params.grid_dim, params.num_particles };
+    const collide_scatter_params_t scatter_params = { params.num_particles };
+
+    sg_pass _keys_pass = { .compute=true, .label="collide-keys-pass" };
+    sg_begin_pass(&_keys_pass);
+    sg_apply_pipeline(state.collide.clear_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(clear_params));
+    dispatch_items(state.collide.num_cells + 1);
+    sg_apply_pipeline(state.collide.keys_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(keys_params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+    stage_stamp("keys");
+
+    sg_pass _scan_pass = { .compute=true, .label="collide-scan-pass" };
+    sg_begin_pass(&_scan_pass);
+    gpu_scan_exclusive(&state.collide.scan, state.collide.cell_start, state.collide.num_cells + 1);
+    sg_end_pass();
+    stage_stamp("scan");
+
+    sg_pass _scatter_pass = { .compute=true, .label="collide-scatter-pass" };
+    sg_begin_pass(&_scatter_pass);
+    sg_apply_pipeline(state.collide.scatter_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(scatter_params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+    stage_stamp("scatter");
+
+    sg_pass _collide_pass = { .compute=true, .label="collide-pass" };
+    sg_begin_pass(&_collide_pass);
+    sg_apply_pipeline(state.collide.collide_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+    stage_stamp("collide");
+}
+
+uint32_t gravity_level_offset(int level) {
+    return ((1u << (2 * level)) - 1) / 3;
+}
+
+void create_gravity_buffers(uint32_t count) {
+    // about one particle per leaf
+    int leaf_level = 0;
+    while ((leaf_level < GRAVITY_MAX_LEAF_LEVEL) && ((1u << (2 * leaf_level)) < count)) {
+        leaf_level++;
+    }
+    state.gravity.leaf_level = std::max(leaf_level, GRAVITY_MIN_LEAF_LEVEL);
+    state.gravity.num_frames = 0;
+    if (state.config.gravity == GRAVITY_AUTO) {
+        state.gravity.mode = count <= GRAVITY_TILED_MAX_PARTICLES ? GRAVITY_TILED : GRAVITY_BARNES_HUT;
+    }
+
+    const uint32_t num_leaves = 1u << (2 * state.gravity.leaf_level);
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.size = sizeof(uint32_t) * 3 * num_leaves;
+    _sg_buffer_desc.label = "gravity-leaves";
+    state.gravity.leaves = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(HMM_Vec4) * gravity_level_offset(state.gravity.leaf_level + 1);
+    _sg_buffer_desc.label = "gravity-nodes";
+    state.gravity.nodes = sg_make_buffer(&_sg_buffer_desc);
+
+    const uint32_t zero[2] = {};
+    _sg_buffer_desc.size = 0;
+    _sg_buffer_desc.data = SG_RANGE(zero);
+    _sg_buffer_desc.label = "gravity-stats";
+    state.gravity.stats = sg_make_buffer(&_sg_buffer_desc);
+}
+
+void destroy_gravity_buffers() {
+    sg_destroy_buffer(state.gravity.leaves);
+    sg_destroy_buffer(state.gravity.nodes);
+    sg_destroy_buffer(state.gravity.stats);
+}
+
+void gravity_passes(float dt) {
+    const float softening2 = GRAVITY_SOFTENING * GRAVITY_SOFTENING;
+    const gravity_params_t params = {
+        dt,
+        GRAVITY_TOTAL_MASS / (float)state.num_particles,
+        softening2,
+        GRAVITY_THETA * GRAVITY_THETA,
+        (int32_t)state.num_particles,
+        state.gravity.leaf_level,
+    };
+    sg_bindings _bindings = particle_state_bindings();
+    _bindings.storage_buffers[2] = state.gravity.leaves;
+    _bindings.storage_buffers[3] = state.gravity.nodes;
+    _bindings.storage_buffers[4] = state.gravity.stats;
+
+    if (state.gravity.mode == GRAVITY_TILED) {
+        sg_pass _gravity_pass = { .compute=true, .label="gravity-pass" };
+        sg_begin_pass(&_gravity_pass);
+        const gravity_tiled_params_t tiled_params = { params.dt, params.strength, params.softening2, params.num_particles };
+        sg_apply_pipeline(state.gravity.tiled_pip);
+        sg_apply_bindings(_bindings);
+        sg_apply_uniforms(0, SG_RANGE(tiled_params));
+        dispatch_items(state.num_particles, GRAVITY_TILE_SIZE);
+        sg_end_pass();
+        stage_stamp("gravity");
+        return;
+    }
+
+    // build the tree bottom-up: bin particles into leaves, then sum 2x2
+    // children into their parent level by level
+    const uint32_t num_leaves = 1u << (2 * state.gravity.leaf_level);
+    const gravity_level_params_t leaf_params = { state.gravity.leaf_level };
+    const gravity_insert_params_t insert_params = { params.num_particles, params.leaf_level };
+    sg_pass _tree_pass = { .compute=true, .label="gravity-tree-pass" };
+    sg_begin_pass(&_tree_pass);
+    sg_apply_pipeline(state.gravity.clear_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(leaf_params));
+    dispatch_items(3 * num_leaves);
+    sg_apply_pipeline(state.gravity.insert_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(insert_params));
+    dispatch_items(state.num_particles);
+    sg_apply_pipeline(state.gravity.leaf_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(leaf_params));
+    dispatch_items(num_leaves);
+    for (int level = state.gravity.leaf_level - 1; level >= 0; level--) {
+        const gravity_level_params_t reduce_params = { level };
+        sg_apply_pipeline(state.gravity.reduce_pip);
+        sg_apply_bindings(_bindings);
+        sg_apply_uniforms(0, SG_RANGE(reduce_params));
+        dispatch_items(1u << (2 * level));
+    }
+    sg_end_pass();
+    stage_stamp("tree");
+
+    sg_pass _gravity_pass = { .compute=true, .label="gravity-pass" };
+    sg_begin_pass(&_gravity_pass);
+    sg_apply_pipeline(state.gravity.traverse_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+    stage_stamp("gravity");
+    state.gravity.num_frames++;
+}
+
+// regenerate the field texture if its parameters changed since the last time
+void curl_field_pass() {
+    if (state.curl.valid && (0 == memcmp(&state.curl.params, &state.curl.generated, sizeof(curl_field_params_t)))) {
+        return;
+    }
+    sg_pass _generate_pass = { .compute=true, .attachments=state.curl.atts, .label="curl-generate-pass" };
+    sg_begin_pass(&_generate_pass);
+    sg_apply_pipeline(state.curl.generate_pip);
+    sg_apply_uniforms(0, SG_RANGE(state.curl.params));
+    sg_dispatch(CURL_FIELD_SIZE / 4, CURL_FIELD_SIZE / 4, CURL_FIELD_SIZE / 4);
+    sg_end_pass();
+    state.curl.generated = state.curl.params;
+    state.curl.valid = true;
+    state.curl.num_generated++;
+}
+
+void curl_passes(float dt) {
+    curl_field_pass();
+
+    // z follows the simulated time, not the frame time, so the flow is deterministic
+    const double time = (double)state.step.num_steps / state.config.step_hz;
+    const curl_params_t params = {
+        dt,
+        state.config.curl_speed,
+        CURL_DRAG,
+        (float)fmod(time / CURL_FIELD_PERIOD, 1.0),
+        (int32_t)state.num_particles,
+    };
+    sg_bindings _bindings = particle_state_bindings();
+    _bindings.images[0] = state.curl.field;
+    _bindings.samplers[0] = state.curl.smp;
+    sg_pass _curl_pass = { .compute=true, .label="curl-pass" };
+    sg_begin_pass(&_curl_pass);
+    sg_apply_pipeline(state.curl.advect_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+    stage_stamp("curl");
+}
+
+// workgroups of the stats reduction, dispatch_items() may round up in x
+uint32_t stats_num_groups(uint32_t num_particles) {
+    const uint32_t num_groups = (num_particles + STATS_GROUP_SIZE - 1) / STATS_GROUP_SIZE;
+    const uint32_t groups_y = (num_groups + MAX_DISPATCH_GROUPS - 1) / MAX_DISPATCH_GROUPS;
+    return (num_groups + groups_y - 1) / groups_y * groups_y;
+}
+
+// reduce the newest state and queue its readback, harvests an older result
+void stats_passes() {
+    sg_bindings _bindings = particle_state_bindings();
+    if (lifecycle_enabled()) {
+        _bindings.storage_buffers[3] = state.lifecycle.alive[state.lifecycle.cur];
+        _bindings.storage_buffers[5] = state.lifecycle.counters;
+    }
+    _bindings.storage_buffers[6] = state.stats.partials;
+    _bindings.storage_buffers[7] = state.stats.result;
+    const stats_reduce_params_t reduce_params = { (int32_t)state.num_particles };
+    const stats_final_params_t final_params = { (int32_t)stats_num_groups(state.num_particles) };
+
+    sg_pass _stats_pass = { .compute=true, .label="stats-pass" };
+    sg_begin_pass(&_stats_pass);
+    sg_apply_pipeline(state.stats.reduce_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(reduce_params));
+    dispatch_items(state.num_particles, STATS_GROUP_SIZE);
+    sg_apply_pipeline(state.stats.final_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(final_params));
+    sg_dispatch(1, 1, 1);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "stats");
+
+    if (gpu_readback_push(&state.stats.readback, state.stats.result, &state.stats.latest)) {
+        state.stats.valid = true;
+    }
+}
+
+void stats_report(const char* label) {
+    if (!state.stats.valid) {
+        return;
+    }
+    const particle_stats_t& s = state.stats.latest;
+    printf("%s %10u particles: stats of frame %llu (%llu behind): live %u | avg speed %.4f | bounds (%.3f, %.3f) - (%.3f, %.3f) | %llu dropped\n",
+        label,
+        state.num_particles,
+        (unsigned long long)state.stats.readback.result_frame,
+        (unsigned long long)(state.stats.readback.frame_index - 1 - state.stats.readback.result_frame),
+        s.num_live,
+        s.avg_speed,
+        s.min_x, s.min_y, s.max_x, s.max_y,
+        (unsigned long long)state.stats.readback.num_dropped);
+}
+
+const char* gravity_mode_name(gravity_mode_t mode) {
+    switch (mode) {
+        case GRAVITY_TILED: return "tiled";
+        case GRAVITY_BARNES_HUT: return "barnes-hut";
+        default: return "off";
+    }
+}
+
+// interactions per second of the active gravity mode from the averaged GPU
+// time of the first step of a frame, must be called before the timer averages
+// are reset; the Barnes-Hut interaction count is accumulated on the GPU over
+// all steps and read back here
+void gravity_report(const char* label) {
+    const double n = (double)state.num_particles;
+    double interactions = n * n;
+    double ms = gpu_timer_ms(&state.timer, "gravity");
+    if (state.gravity.mode == GRAVITY_BARNES_HUT) {
+        uint32_t counter[2] = {};
+        download_buffer_range(state.gravity.stats, 0, counter, sizeof(counter));
+        interactions = ((double)counter[1] * 4294967296.0 + (double)counter[0]) / std::max(state.gravity.num_frames, 1u);
+        ms += gpu_timer_ms(&state.timer, "tree");
+
+        const uint32_t zero[2] = {};
+        upload_buffer_range(state.gravity.stats, 0, zero, sizeof(zero));
+        state.gravity.num_frames = 0;
+    }
+    printf("%s %10u particles: gravity %s %.3e interactions/step | %.3fms | %.3f Ginteractions/s\n",
+        label,
+        state.num_particles,
+        gravity_mode_name(state.gravity.mode),
+        interactions,
+        ms,
+        ms > 0.0 ? interactions / (ms * 1.0e6) : 0.0);
+}
+
+void create_raster_buffers(uint32_t count) {
+    const raster_params_t& params = state.raster.params;
+    const uint32_t num_tiles = (uint32_t)(params.tiles_x * params.tiles_y);
+
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.size = sizeof(uint32_t) * (num_tiles + 1);
+    _sg_buffer_desc.label = "raster-tile-offset";
+    state.raster.tile_offset = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(uint32_t) * num_tiles;
+    _sg_buffer_desc.label = "raster-tile-fill";
+    state.raster.tile_fill = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(uint32_t) * RASTER_MAX_TILES_PER_PARTICLE * (size_t)count;
+    _sg_buffer_desc.label = "raster-tile-list";
+    state.raster.tile_list = sg_make_buffer(&_sg_buffer_desc);
+}
+
+void destroy_raster_buffers() {
+    sg_destroy_buffer(state.raster.tile_offset);
+    sg_destroy_buffer(state.raster.tile_fill);
+    sg_destroy_buffer(state.raster.tile_list);
+}
+
+// bin the drawn particles into tiles, then splat every tile into the raster image
+void raster_passes() {
+    const raster_params_t& params = state.raster.params;
+    const uint32_t num_tiles = (uint32_t)(params.tiles_x * params.tiles_y);
+    const raster_clear_params_t clear_params = { params.tiles_x, params.tiles_y };
+    const raster_bin_params_t bin_params = { (int32_t)state.num_particles, params.tiles_x, params.img_w, params.img_h, params.point_size };
+    const raster_splat_params_t splat_params = { params.tiles_x, params.img_w, params.img_h, params.point_size };
+
+    sg_bindings _bindings = particle_draw_bindings();
+    _bindings.storage_buffers[4] = state.raster.tile_offset;
+    _bindings.storage_buffers[5] = state.raster.tile_fill;
+    _bindings.storage_buffers[6] = state.raster.tile_list;
+
+    sg_pass _bin_pass = { .compute=true, .label="raster-bin-pass" };
+    sg_begin_pass(&_bin_pass);
+    sg_apply_pipeline(state.raster.clear_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(clear_params));
+    dispatch_items(num_tiles + 1);
+    sg_apply_pipeline(state.raster.count_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(bin_params));
+    dispatch_items(state.num_particles);
+    gpu_scan_exclusive(&state.raster.scan, state.raster.tile_offset, num_tiles + 1);
+    sg_apply_pipeline(state.raster.scatter_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(bin_params));
+    dispatch_items(state.num_particles);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "bin");
+
+    sg_pass _raster_pass = { .compute=true, .attachments=state.raster.atts, .label="raster-pass" };
+    sg_begin_pass(&_raster_pass);
+    sg_apply_pipeline(state.raster.raster_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(splat_params));
+    sg_dispatch(params.tiles_x, params.tiles_y, 1);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "raster");
+}
+
+void create_cull_buffers(uint32_t count) {
+    const cull_params_t& params = state.cull.params;
+
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.size = sizeof(uint32_t) * (size_t)(params.cells_x * params.cells_y);
+    _sg_buffer_desc.label = "cull-cell-winner";
+    state.cull.cell_winner = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(uint32_t) * ((size_t)count + 1);
+    _sg_buffer_desc.label = "cull-offsets";
+    state.cull.offsets = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = sizeof(uint32_t) * (size_t)count;
+    _sg_buffer_desc.label = "cull-draw-list";
+    state.cull.draw_list = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.size = CULL_ARGS_SIZE;
+    _sg_buffer_desc.label = "cull-indirect-args";
+    state.cull.args = sg_make_buffer(&_sg_buffer_desc);
+
+    gpu_scan_init(&state.cull.scan, count + 1);
+}
+
+void destroy_cull_buffers() {
+    gpu_scan_shutdown(&state.cull.scan);
+    sg_destroy_buffer(state.cull.cell_winner);
+    sg_destroy_buffer(state.cull.offsets);
+    sg_destroy_buffer(state.cull.draw_list);
+    sg_destroy_buffer(state.cull.args);
+}
+
+sg_bindings cull_bindings() {
+    sg_bindings _bindings = particle_draw_bindings();
+    _bindings.storage_buffers[3] = state.cull.draw_list;
+    _bindings.storage_buffers[4] = state.cull.cell_winner;
+    _bindings.storage_buffers[5] = state.cull.offsets;
+    _bindings.storage_buffers[6] = state.cull.args;
+    return _bindings;
+}
+
+// build the draw list and the indirect draw args from the state to draw
+void cull_passes() {
+    cull_params_t params = state.cull.params;
+    params.num_particles = (int32_t)state.num_particles;
+    const cull_clear_params_t clear_params = { params.cells_x, params.cells_y };
+    const cull_flag_params_t flag_params = { params.num_particles, params.cells_x, params.cells_y, params.cell_size, params.img_w, params.img_h };
+    const cull_count_params_t count_params = { params.num_particles };
+    const sg_bindings _bindings = cull_bindings();
+
+    sg_pass _cull_pass = { .compute=true, .label="cull-pass" };
+    sg_begin_pass(&_cull_pass);
+    sg_apply_pipeline(state.cull.clear_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(clear_params));
+    dispatch_items((uint32_t)(params.cells_x * params.cells_y));
+    sg_apply_pipeline(state.cull.mark_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    dispatch_items(state.num_particles);
+    sg_apply_pipeline(state.cull.flag_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(flag_params));
+    dispatch_items(state.num_particles + 1);
+    gpu_scan_exclusive(&state.cull.scan, state.cull.offsets, state.num_particles + 1);
+    sg_apply_pipeline(state.cull.scatter_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(count_params));
+    dispatch_items(state.num_particles);
+    sg_apply_pipeline(state.cull.args_pip);
+    sg_apply_bindings(_bindings);
+    sg_apply_uniforms(0, SG_RANGE(count_params));
+    sg_dispatch(1, 1, 1);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "cull");
+}
+
+// blocking readback of the number of particles drawn by the last cull pass
+uint32_t cull_num_drawn() {
+    uint32_t args[CULL_ARGS_SIZE / sizeof(uint32_t)] = {};
+    download_buffer_range(state.cull.args, 0, args, sizeof(args));
+    return args[1];
+}
+
+// make slot[head] the current particle state
+void set_particle_state_head(int head) {
+    state.compute.head = head;
+    state.compute.buf = state.compute.slots[head];
+    state.compute.soa.pos = state.compute.pos_slots[head];
+    state.compute.soa.vel = state.compute.vel_slots[head];
+}
+
+void create_particle_buffers(uint32_t count) {
+    state.num_particles = count;
+    state.validate.frame = 0;
+    // with --load every state slot starts from the mapped snapshot sections
+    const particle_snapshot_t* snapshot = state.snapshot.loaded.data ? &state.snapshot.loaded : nullptr;
+    state.step.num_steps = snapshot ? snapshot->header.num_steps : 0;
+    if (state.config.fused) {
+        state.fused.time = 0.0;
+        state.fused.seed = (int32_t)time(nullptr);
+        return;
+    }
+
+    const int num_slots = state.config.lag + 1;
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    for (int i = 0; i < num_slots; i++) {
+        if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+            _sg_buffer_desc.size = sizeof(particle_t) * count;
+            _sg_buffer_desc.data = snapshot ? particle_snapshot_section(snapshot, 0) : sg_range{};
+            _sg_buffer_desc.label = "particle-buffer";
+            state.compute.slots[i] = sg_make_buffer(&_sg_buffer_desc);
+        } else if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+            _sg_buffer_desc.size = sizeof(packed_particle_t) * count;
+            _sg_buffer_desc.data = snapshot ? particle_snapshot_section(snapshot, 0) : sg_range{};
+            _sg_buffer_desc.label = "packed-particle-buffer";
+            state.compute.slots[i] = sg_make_buffer(&_sg_buffer_desc);
+        } else {
+            _sg_buffer_desc.size = sizeof(HMM_Vec2) * count;
+            _sg_buffer_desc.data = snapshot ? particle_snapshot_section(snapshot, 0) : sg_range{};
+            _sg_buffer_desc.label = "particle-pos-buffer";
+            state.compute.pos_slots[i] = sg_make_buffer(&_sg_buffer_desc);
+
+            _sg_buffer_desc.size = sizeof(HMM_Vec2) * count;
+            _sg_buffer_desc.data = snapshot ? particle_snapshot_section(snapshot, 1) : sg_range{};
+            _sg_buffer_desc.label = "particle-vel-buffer";
+            state.compute.vel_slots[i] = sg_make_buffer(&_sg_buffer_desc);
+        }
+    }
+    if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+        _sg_buffer_desc.size = sizeof(HMM_Vec4) * count;
+        _sg_buffer_desc.data = snapshot ? particle_snapshot_section(snapshot, 2) : sg_range{};
+        _sg_buffer_desc.label = "particle-color-buffer";
+        state.compute.soa.color = sg_make_buffer(&_sg_buffer_desc);
+    }
+    set_particle_state_head(0);
+
+    if (state.config.stats) {
+        sg_buffer_desc _stats_buffer_desc{};
+        _stats_buffer_desc.usage.storage_buffer = true;
+        _stats_buffer_desc.size = 2 * sizeof(HMM_Vec4) * stats_num_groups(count);
+        _stats_buffer_desc.label = "stats-partials";
+        state.stats.partials = sg_make_buffer(&_stats_buffer_desc);
+        state.stats.valid = false;
+    }
+
+    if (lifecycle_enabled()) {
+        create_lifecycle_buffers(count);
+        reset_lifecycle();
+        return;
+    }
+    if (state.config.collide) {
+        create_collide_buffers(count);
+    }
+    if (state.config.gravity != GRAVITY_OFF) {
+        create_gravity_buffers(count);
+    }
+    if (state.config.raster) {
+        create_raster_buffers(count);
+    }
+    if (state.config.cull_cell_size > 0) {
+        create_cull_buffers(count);
+    }
+
+    // in bench mode, measure initialization with a blocking timestamp query pair
+    GLuint init_queries[2] = {};
+    const uint64_t init_start = stm_now();
+    if (state.config.bench) {
+        glGenQueries(2, init_queries);
+        glQueryCounter(init_queries[0], GL_TIMESTAMP);
+    }
+    if (snapshot) {
+        // already uploaded from the mapped file when the buffers were made
+    } else if (state.config.cpu_init) {
+        init_particles_cpu(count);
+    } else {
+        init_particles_gpu(count);
+    }
+    // all state slots start out identical
+    for (int i = 1; i < num_slots; i++) {
+        if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+            copy_buffer(state.compute.pos_slots[0], state.compute.pos_slots[i], sizeof(HMM_Vec2) * count);
+            copy_buffer(state.compute.vel_slots[0], state.compute.vel_slots[i], sizeof(HMM_Vec2) * count);
+        } else {
+            copy_buffer(state.compute.slots[0], state.compute.slots[i], particle_state_bytes() * count);
+        }
+    }
+    if (state.config.bench) {
+        glQueryCounter(init_queries[1], GL_TIMESTAMP);
+        GLuint64 gpu_start = 0, gpu_end = 0;
+        glGetQueryObjectui64v(init_queries[0], GL_QUERY_RESULT, &gpu_start);
+        glGetQueryObjectui64v(init_queries[1], GL_QUERY_RESULT, &gpu_end);
+        glDeleteQueries(2, init_queries);
+        printf("init %u particles (%s): cpu %.3fms | gpu %.3fms\n",
+            count,
+            state.config.cpu_init ? "cpu" : "gpu",
+            stm_ms(stm_since(init_start)),
+            (double)(gpu_end - gpu_start) * 1.0e-6);
+        fflush(stdout);
+    }
+}
+
+void destroy_particle_buffers() {
+    if (state.config.fused) {
+        return;
+    }
+    if (lifecycle_enabled()) {
+        sg_destroy_buffer(state.lifecycle.life);
+        sg_destroy_buffer(state.lifecycle.alive[0]);
+        sg_destroy_buffer(state.lifecycle.alive[1]);
+        sg_destroy_buffer(state.lifecycle.dead);
+        sg_destroy_buffer(state.lifecycle.counters);
+        sg_destroy_buffer(state.lifecycle.args);
+    }
+    if (state.config.collide) {
+        destroy_collide_buffers();
+    }
+    if (state.config.gravity != GRAVITY_OFF) {
+        destroy_gravity_buffers();
+    }
+    if (state.config.raster) {
+        destroy_raster_buffers();
+    }
+    if (state.config.cull_cell_size > 0) {
+        destroy_cull_buffers();
+    }
+    if (state.config.stats) {
+        sg_destroy_buffer(state.stats.partials);
+    }
+    for (int i = 0; i < state.config.lag + 1; i++) {
+        if (state.config.layout != PARTICLE_LAYOUT_SOA) {
+            sg_destroy_buffer(state.compute.slots[i]);
+        } else {
+            sg_destroy_buffer(state.compute.pos_slots[i]);
+            sg_destroy_buffer(state.compute.vel_slots[i]);
+        }
+    }
+    if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+        sg_destroy_buffer(state.compute.soa.color);
+    }
+}
+
+void init() {
+    sg_desc _sg_desc{};
+    _sg_desc.environment = sglue_environment();
+    _sg_desc.logger.func = slog_func;
+    sg_setup(&_sg_desc);
+    stm_setup();
+
+    // compute
+    {
+        sg_shader_desc _sg_compute_shader_desc{};
+        const std::string compute_source = integrate_compute_source(particle_state_decls());
+        _sg_compute_shader_desc.compute_func.source = compute_source.c_str();
+
+        _sg_compute_shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _sg_compute_shader_desc.uniform_blocks[0].size = sizeof(cs_params_t);
+        _sg_compute_shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt",  };
+        _sg_compute_shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles",  };
+        _sg_compute_shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "substeps",  };
+
+        _sg_compute_shader_desc.storage_buffers[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _sg_compute_shader_desc.storage_buffers[0].readonly = false;
+        _sg_compute_shader_desc.storage_buffers[0].glsl_binding_n = 0;
+        if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+            _sg_compute_shader_desc.storage_buffers[1].stage = SG_SHADERSTAGE_COMPUTE;
+            _sg_compute_shader_desc.storage_buffers[1].readonly = false;
+            _sg_compute_shader_desc.storage_buffers[1].glsl_binding_n = 1;
+        }
+
+        _sg_compute_shader_desc.label = "compute-shader";
+
+        sg_shader compute_shd = sg_make_shader(&_sg_compute_shader_desc);
+
+        sg_pipeline_desc _compute_pipeline_desc{};
+        _compute_pipeline_desc.compute = true;
+        _compute_pipeline_desc.shader = compute_shd;
+        _compute_pipeline_desc.label = "compute-pipeline";
+
+        state.compute.pip = sg_make_pipeline(&_compute_pipeline_desc);
+    }
+
+    // --lag: integrate from one state slot into the next
+    if (state.config.lag > 0) {
+        const std::string source = pingpong_compute_source();
+        const uint32_t sbufs = state.config.layout == PARTICLE_LAYOUT_SOA ? 0x1B : 0x9;
+        const uint32_t readonly = state.config.layout == PARTICLE_LAYOUT_SOA ? 0x3 : 0x1;
+        state.compute.pingpong_pip = make_compute_pipeline("pingpong-compute", source.c_str(), sizeof(cs_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "substeps" },
+        }, sbufs, readonly);
+    }
+
+    // graphics
+    {
+        sg_shader_desc _shader_desc{};
+        std::string packed_source;
+        if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+            _shader_desc.vertex_func.source = R"(
+#version 430 core
+
+struct particle_t {
+  vec2 pos;
+  vec2 vel;
+  vec4 color;
+};
+
+layout(std430, binding=0) readonly buffer ssbo {
+  particle_t prt[];
+};
+
+layout(location=0) out vec4 vColor;
+
+void main() {
+  vec2 pos = prt[gl_InstanceID].pos;
+  vec4 color = prt[gl_InstanceID].color;
+  gl_Position = vec4(pos, 0.0f, 1.0f);
+  gl_PointSize = 20.0f;
+  vColor = color;
+}
+)";
+        } else if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+            packed_source = "#version 430 core\n";
+            packed_source += PACKED_PARTICLE_GLSL;
+            packed_source += R"(
+layout(std430, binding=0) readonly buffer ssbo {
+  packed_particle_t prt[];
+};
+
+layout(location=0) out vec4 vColor;
+
+void main() {
+  vec2 pos = unpack_pos(prt[gl_InstanceID].pos);
+  vec4 color = unpackUnorm4x8(prt[gl_InstanceID].color);
+  gl_Position = vec4(pos, 0.0f, 1.0f);
+  gl_PointSize = 20.0f;
+  vColor = color;
+}
+)";
+            _shader_desc.vertex_func.source = packed_source.c_str();
+        } else {
+            _shader_desc.vertex_func.source = R"(
+#version 430 core
+
+layout(std430, binding=0) readonly buffer pos_ssbo {
+  vec2 prt_pos[];
+};
+layout(std430, binding=2) readonly buffer color_ssbo {
+  vec4 prt_color[];
+};
+
+layout(location=0) out vec4 vColor;
+
+void main() {
+  vec2 pos = prt_pos[gl_InstanceID];
+  vec4 color = prt_color[gl_InstanceID];
+  gl_Position = vec4(pos, 0.0f, 1.0f);
+  gl_PointSize = 20.0f;
+  vColor = color;
+}
+)";
+        }
+        _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(location=0) in vec4 vColor;
+out vec4 frag_color;
+
+void main() {
+  frag_color = vColor;
+}
+)";
+        _shader_desc.storage_buffers[0].stage = SG_SHADERSTAGE_VERTEX;
+        _shader_desc.storage_buffers[0].readonly = true;
+        _shader_desc.storage_buffers[0].glsl_binding_n = 0;
+        if (state.config.layout == PARTICLE_LAYOUT_SOA) {
+            _shader_desc.storage_buffers[2].stage = SG_SHADERSTAGE_VERTEX;
+            _shader_desc.storage_buffers[2].readonly = true;
+            _shader_desc.storage_buffers[2].glsl_binding_n = 2;
+        }
+
+        _shader_desc.label = "fragment-shader";
+
+        sg_shader graphics_shd = sg_make_shader(&_shader_desc);
+
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.shader = graphics_shd;
+        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
+        state.graphics.pip = sg_make_pipeline(&_pipeline_desc);
+
+        state.graphics.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.2f, 0.3f, 0.3f, 1.0f } };
+    }
+
+    // fused: the vertex shader seeds each particle like the init pass and
+    // evaluates the bounce analytically, nothing is stored between frames
+    if (state.config.fused) {
+        sg_shader_desc _shader_desc{};
+        const std::string vs_source = std::string(R"(
+#version 430 core
+uniform float time;
+uniform int seed;
+
+layout(location=0) out vec4 vColor;
+)") + PCG_HASH_GLSL + R"(
+// straight motion folded into [-1, 1], equivalent to flipping the velocity
+// at the border: a triangle wave with period 4
+vec2 bounce(vec2 x) {
+  return 1.0 - abs(mod(x + 1.0, 4.0) - 2.0);
+}
+
+void main() {
+  uint idx = uint(gl_InstanceID);
+  float r = 0.25 * sqrt(rnd(idx, 0u));
+  float theta = rnd(idx, 1u) * 2.0 * 3.14159265358979323846;
+  vec2 pos = r * vec2(cos(theta), sin(theta));
+  vec2 vel = normalize(pos) * 0.25;
+  gl_Position = vec4(bounce(pos + vel * time), 0.0f, 1.0f);
+  gl_PointSize = 20.0f;
+  vColor = vec4(rnd(idx, 2u), rnd(idx, 3u), rnd(idx, 4u), rnd(idx, 5u));
+}
+)";
+        _shader_desc.vertex_func.source = vs_source.c_str();
+        _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(location=0) in vec4 vColor;
+out vec4 frag_color;
+
+void main() {
+  frag_color = vColor;
+}
+)";
+        _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_VERTEX;
+        _shader_desc.uniform_blocks[0].size = sizeof(fused_params_t);
+        _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "time" };
+        _shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "seed" };
+        _shader_desc.label = "fused-shader";
+
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
+        _pipeline_desc.label = "fused-pipeline";
+        state.fused.pip = sg_make_pipeline(&_pipeline_desc);
+    }
+
+    // compute rasterizer
+    if (state.config.raster) {
+        const int tiles_x = ((int)SCREEN_WIDTH + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+        const int tiles_y = ((int)SCREEN_HEIGHT + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+        state.raster.params = { tiles_x, tiles_y, (int32_t)SCREEN_WIDTH, (int32_t)SCREEN_HEIGHT, PARTICLE_POINT_SIZE };
+        gpu_scan_init(&state.raster.scan, (uint32_t)(tiles_x * tiles_y) + 1);
+
+        sg_image_desc _sg_image_desc{};
+        _sg_image_desc.usage.storage_attachment = true;
+        _sg_image_desc.width = SCREEN_WIDTH;
+        _sg_image_desc.height = SCREEN_HEIGHT;
+        _sg_image_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        _sg_image_desc.label = "raster-image";
+        state.raster.img = sg_make_image(&_sg_image_desc);
+
+        sg_attachments_desc _sg_attachments_desc{};
+        _sg_attachments_desc.storages[0].image = state.raster.img;
+        _sg_attachments_desc.label = "raster-attachments";
+        state.raster.atts = sg_make_attachments(&_sg_attachments_desc);
+
+        const std::string decls = R"(
+#version 430
+)" + particle_draw_decls() + R"(
+layout(std430, binding=4) buffer tile_offset_ssbo {
+  uint tile_offset[];
+};
+layout(std430, binding=5) buffer tile_fill_ssbo {
+  uint tile_fill[];
+};
+layout(std430, binding=6) buffer tile_list_ssbo {
+  uint tile_list[];
+};
+
+const int TILE_SIZE = 32;
+
+uint item_index() {
+  return gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+}
+
+// tile rect [xy, zw) overlapped by a non-empty pixel rect
+ivec4 tile_rect(ivec4 r) {
+  return ivec4(r.xy / TILE_SIZE, (r.zw - 1) / TILE_SIZE + 1);
+}
+)";
+        // pixel rect [xy, zw) covered by a point sprite of point_size around pos,
+        // image row 0 is the top of the screen
+        const std::string particle_rect_decl = R"(
+ivec4 particle_rect(vec2 pos) {
+  vec2 c = vec2(pos.x * 0.5 + 0.5, 0.5 - pos.y * 0.5) * vec2(img_w, img_h);
+  ivec2 lo = ivec2(floor(c - 0.5 * point_size + 0.5));
+  ivec2 hi = lo + int(point_size);
+  return ivec4(max(lo, ivec2(0)), min(hi, ivec2(img_w, img_h)));
+}
+)";
+        const std::string bin_decls = decls + R"(
+uniform int num_particles;
+uniform int tiles_x;
+uniform int img_w;
+uniform int img_h;
+uniform float point_size;
+)" + particle_rect_decl;
+        const std::initializer_list<sg_glsl_shader_uniform> bin_uniforms = {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "tiles_x" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_w" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_h" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "point_size" },
+        };
+        const uint32_t sbufs = particle_draw_sbufs() | 0x70;
+        const uint32_t readonly = particle_draw_sbufs();
+
+        // zero the tile counts (including the total slot) and cursors
+        const std::string clear_source = decls + R"(
+uniform int tiles_x;
+uniform int tiles_y;
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+  uint idx = item_index();
+  uint num_tiles = uint(tiles_x * tiles_y);
+  if (idx > num_tiles) {
+    return;
+  }
+  tile_offset[idx] = 0u;
+  if (idx < num_tiles) {
+    tile_fill[idx] = 0u;
+  }
+}
+)";
+        state.raster.clear_pip = make_compute_pipeline("raster-clear", clear_source.c_str(), sizeof(raster_clear_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "tiles_x" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "tiles_y" },
+        }, sbufs, readonly);
+
+        const std::string count_source = bin_decls + R"(
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+  ivec4 r = particle_rect(draw_pos(idx));
+  if ((r.x >= r.z) || (r.y >= r.w)) {
+    return;
+  }
+  ivec4 t = tile_rect(r);
+  for (int ty = t.y; ty < t.w; ty++) {
+    for (int tx = t.x; tx < t.z; tx++) {
+      atomicAdd(tile_offset[ty * tiles_x + tx], 1u);
+    }
+  }
+}
+)";
+        state.raster.count_pip = make_compute_pipeline("raster-count", count_source.c_str(), sizeof(raster_bin_params_t), bin_uniforms, sbufs, readonly);
+
+        const std::string scatter_source = bin_decls + R"(
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+  ivec4 r = particle_rect(draw_pos(idx));
+  if ((r.x >= r.z) || (r.y >= r.w)) {
+    return;
+  }
+  ivec4 t = tile_rect(r);
+  for (int ty = t.y; ty < t.w; ty++) {
+    for (int tx = t.x; tx < t.z; tx++) {
+      uint tile = uint(ty * tiles_x + tx);
+      tile_list[tile_offset[tile] + atomicAdd(tile_fill[tile], 1u)] = idx;
+    }
+  }
+}
+)";
+        state.raster.scatter_pip = make_compute_pipeline("raster-scatter", scatter_source.c_str(), sizeof(raster_bin_params_t), bin_uniforms, sbufs, readonly);
+
+        // one workgroup per tile: every pixel keeps the highest covering particle
+        // index (later instances are drawn on top of earlier ones with GL points),
+        // then resolves it to a color
+        const std::string raster_source = decls + R"(
+uniform int tiles_x;
+uniform int img_w;
+uniform int img_h;
+uniform float point_size;
+)" + particle_rect_decl + R"(
+layout(binding=0, rgba8) uniform writeonly image2D raster_img;
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+shared uint winner[1024];
+
+void main() {
+  uint tile = gl_WorkGroupID.y * uint(tiles_x) + gl_WorkGroupID.x;
+  ivec2 tile_min = ivec2(gl_WorkGroupID.xy) * TILE_SIZE;
+  uint lid = gl_LocalInvocationID.x;
+
+  for (uint i = lid; i < 1024u; i += 256u) {
+    winner[i] = 0u;
+  }
+  barrier();
+
+  uint end = tile_offset[tile + 1u];
+  for (uint j = tile_offset[tile] + lid; j < end; j += 256u) {
+    uint idx = tile_list[j];
+    ivec4 r = particle_rect(draw_pos(idx));
+    ivec2 lo = max(r.xy, tile_min) - tile_min;
+    ivec2 hi = min(r.zw, tile_min + TILE_SIZE) - tile_min;
+    for (int y = lo.y; y < hi.y; y++) {
+      for (int x = lo.x; x < hi.x; x++) {
+        atomicMax(winner[y * TILE_SIZE + x], idx + 1u);
+      }
+    }
+  }
+  barrier();
+
+  for (uint i = lid; i < 1024u; i += 256u) {
+    ivec2 p = tile_min + ivec2(i % uint(TILE_SIZE), i / uint(TILE_SIZE));
+    if ((p.x >= img_w) || (p.y >= img_h)) {
+      continue;
+    }
+    uint w = winner[i];
+    vec4 color = (w > 0u) ? vec4(draw_color(w - 1u).xyz, 1.0) : vec4(0.2, 0.3, 0.3, 1.0);
+    imageStore(raster_img, p, color);
+  }
+}
+)";
+        sg_shader_desc _raster_shader_desc{};
+        _raster_shader_desc.compute_func.source = raster_source.c_str();
+        _raster_shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _raster_shader_desc.uniform_blocks[0].size = sizeof(raster_splat_params_t);
+        _raster_shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "tiles_x" };
+        _raster_shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_w" };
+        _raster_shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_h" };
+        _raster_shader_desc.uniform_blocks[0].glsl_uniforms[3] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "point_size" };
+        for (int i = 0; i < SG_MAX_STORAGEBUFFER_BINDSLOTS; i++) {
+            if (sbufs & (1u << i)) {
+                _raster_shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_COMPUTE;
+                _raster_shader_desc.storage_buffers[i].readonly = (readonly & (1u << i)) != 0;
+                _raster_shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+            }
+        }
+        _raster_shader_desc.storage_images[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _raster_shader_desc.storage_images[0].image_type = SG_IMAGETYPE_2D;
+        _raster_shader_desc.storage_images[0].access_format = SG_PIXELFORMAT_RGBA8;
+        _raster_shader_desc.storage_images[0].writeonly = true;
+        _raster_shader_desc.storage_images[0].glsl_binding_n = 0;
+        _raster_shader_desc.label = "raster-shader";
+
+        sg_pipeline_desc _raster_pipeline_desc{};
+        _raster_pipeline_desc.compute = true;
+        _raster_pipeline_desc.shader = sg_make_shader(&_raster_shader_desc);
+        _raster_pipeline_desc.label = "raster-pipeline";
+        state.raster.raster_pip = sg_make_pipeline(&_raster_pipeline_desc);
+
+        // full-screen quad, same as GLnoise
+        sg_shader_desc _shader_desc{};
+        _shader_desc.vertex_func.source = R"(
+#version 430 core
+layout(location=0) out vec2 vUV;
+
+const vec4 vertices[4] = {
+  // pos         uv
+  {-1.0f, -1.0f, 0.0f, 1.0f},
+  { 1.0f, -1.0f, 1.0f, 1.0f},
+  {-1.0f,  1.0f, 0.0f, 0.0f},
+  { 1.0f,  1.0f, 1.0f, 0.0f},
+};
+const int indices[6] = { 0, 1, 2, 1, 3, 2 };
+
+void main() {
+  vec2 position = vertices[indices[gl_VertexID]].xy;
+  vec2 texcoord0 = vertices[indices[gl_VertexID]].zw;
+  gl_Position = vec4(position, 0.0f, 1.0f);
+  vUV = texcoord0;
+}
+)";
+        _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(binding=0) uniform sampler2D disp_tex;
+layout(location=0) in vec2 vUV;
+out vec4 frag_color;
+
+void main() {
+  frag_color = vec4(texture(disp_tex, vUV).xyz, 1.0f);
+}
+)";
+        _shader_desc.label = "composite-shader";
+        _shader_desc.images[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.images[0].image_type = SG_IMAGETYPE_2D;
+        _shader_desc.images[0].sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+        _shader_desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+        _shader_desc.image_sampler_pairs[0].stage = SG_SHADERSTAGE_FRAGMENT;
+        _shader_desc.image_sampler_pairs[0].image_slot = 0;
+        _shader_desc.image_sampler_pairs[0].sampler_slot = 0;
+        _shader_desc.image_sampler_pairs[0].glsl_name = "disp_tex";
+
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
+        _pipeline_desc.label = "composite-pipeline";
+        state.raster.composite_pip = sg_make_pipeline(&_pipeline_desc);
+
+        sg_sampler_desc _sg_sampler_desc{};
+        _sg_sampler_desc.min_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.mag_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.label = "Linear sampler";
+        state.raster.smp = sg_make_sampler(&_sg_sampler_desc);
+    }
+
+    // telemetry reduction
+    if (state.config.stats) {
+        std::string decls;
+        std::string count_decls;
+        uint32_t sbufs = 0;
+        uint32_t readonly = 0;
+        if (lifecycle_enabled()) {
+            decls = particle_state_decls() + R"(
+layout(std430, binding=3) readonly buffer alive_ssbo {
+  uint alive[];
+};
+layout(std430, binding=5) readonly buffer counters_ssbo {
+  uint alive_in_count;
+  uint alive_out_count;
+  uint dead_count;
+  uint emit_count;
+};
+)";
+            count_decls = R"(
+// survivors of this frame's simulate pass, never more than the dispatch covers
+uint stats_count() { return min(alive_out_count, uint(num_particles)); }
+uint stats_particle(uint i) { return alive[i]; }
+)";
+            readonly = particle_state_sbufs() | 0x28;
+        } else {
+            decls = particle_state_decls();
+            count_decls = R"(
+uint stats_count() { return uint(num_particles); }
+uint stats_particle(uint i) { return i; }
+)";
+            readonly = particle_state_sbufs();
+        }
+        sbufs = readonly | 0xC0;
+        decls += R"(
+struct stats_partial_t {
+  vec4 count_speed;     // x: count, y: speed sum
+  vec4 bounds;          // xy: min, zw: max
+};
+layout(std430, binding=6) buffer partials_ssbo {
+  stats_partial_t partials[];
+};
+layout(std430, binding=7) buffer stats_ssbo {
+  uint num_live;
+  float avg_speed;
+  vec2 bounds_min;
+  vec2 bounds_max;
+  uint pad[2];
+};
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+
+const vec4 EMPTY_BOUNDS = vec4(1.0e30, 1.0e30, -1.0e30, -1.0e30);
+
+// min goes into xy and max into zw of the reduced bounds
+vec4 reduce_bounds(vec4 bounds) {
+  return vec4(wg_min(bounds).xy, wg_max(bounds).zw);
+}
+)";
+        // subgroup reductions where the driver has them, shared memory otherwise
+        const bool subgroups = gpu_subgroups_default();
+        const std::string reduce_source = gpu_workgroup_source(R"(
+#version 430
+uniform int num_particles;
+)" + decls + count_decls + R"(
+void main() {
+  uint idx = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 256 + gl_GlobalInvocationID.x;
+  vec4 count_speed = vec4(0.0);
+  vec4 bounds = EMPTY_BOUNDS;
+  if (idx < stats_count()) {
+    uint p = stats_particle(idx);
+    vec2 pos = load_pos(p);
+    count_speed = vec4(1.0, length(load_vel(p)), 0.0, 0.0);
+    bounds = vec4(pos, pos);
+  }
+  count_speed = wg_add(count_speed);
+  bounds = reduce_bounds(bounds);
+  if (gl_LocalInvocationIndex == 0u) {
+    partials[gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x] = stats_partial_t(count_speed, bounds);
+  }
+}
+)", subgroups, STATS_GROUP_SIZE);
+        state.stats.reduce_pip = make_compute_pipeline(subgroups ? "stats-reduce-subgroup" : "stats-reduce", reduce_source.c_str(), sizeof(stats_reduce_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, sbufs, readonly);
+
+        // one workgroup folds all partials, counts stay exact as uints
+        const std::string final_source = gpu_workgroup_source(R"(
+#version 430
+uniform int num_partials;
+)" + decls + R"(
+void main() {
+  uint t = gl_LocalInvocationIndex;
+  uint count = 0u;
+  vec4 count_speed = vec4(0.0);
+  vec4 bounds = EMPTY_BOUNDS;
+  for (uint i = t; i < uint(num_partials); i += 256u) {
+    stats_partial_t partial = partials[i];
+    count += uint(partial.count_speed.x);
+    count_speed += partial.count_speed;
+    bounds = vec4(min(bounds.xy, partial.bounds.xy), max(bounds.zw, partial.bounds.zw));
+  }
+  count = wg_add_uint(count);
+  count_speed = wg_add(count_speed);
+  bounds = reduce_bounds(bounds);
+  if (t == 0u) {
+    num_live = count;
+    avg_speed = count > 0u ? count_speed.y / float(count) : 0.0;
+    bounds_min = count > 0u ? bounds.xy : vec2(0.0);
+    bounds_max = count > 0u ? bounds.zw : vec2(0.0);
+  }
+}
+)", subgroups, STATS_GROUP_SIZE);
+        state.stats.final_pip = make_compute_pipeline(subgroups ? "stats-final-subgroup" : "stats-final", final_source.c_str(), sizeof(stats_final_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_partials" },
+        }, sbufs, readonly);
+
+        sg_buffer_desc _sg_buffer_desc{};
+        _sg_buffer_desc.usage.storage_buffer = true;
+        _sg_buffer_desc.size = sizeof(particle_stats_t);
+        _sg_buffer_desc.label = "stats-result";
+        state.stats.result = sg_make_buffer(&_sg_buffer_desc);
+        gpu_readback_init(&state.stats.readback, sizeof(particle_stats_t));
+    }
+
+    // curl-noise flow field
+    if (state.config.curl_speed > 0.0f) {
+        sg_image_desc _sg_image_desc{};
+        _sg_image_desc.type = SG_IMAGETYPE_3D;
+        _sg_image_desc.usage.storage_attachment = true;
+        _sg_image_desc.width = CURL_FIELD_SIZE;
+        _sg_image_desc.height = CURL_FIELD_SIZE;
+        _sg_image_desc.num_slices = CURL_FIELD_SIZE;
+        _sg_image_desc.pixel_format = SG_PIXELFORMAT_RGBA16F;
+        _sg_image_desc.label = "curl-field";
+        state.curl.field = sg_make_image(&_sg_image_desc);
+
+        sg_attachments_desc _sg_attachments_desc{};
+        _sg_attachments_desc.storages[0].image = state.curl.field;
+        _sg_attachments_desc.label = "curl-field-attachments";
+        state.curl.atts = sg_make_attachments(&_sg_attachments_desc);
+
+        // the field tiles in all three directions
+        sg_sampler_desc _sg_sampler_desc{};
+        _sg_sampler_desc.min_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.mag_filter = SG_FILTER_LINEAR;
+        _sg_sampler_desc.wrap_u = SG_WRAP_REPEAT;
+        _sg_sampler_desc.wrap_v = SG_WRAP_REPEAT;
+        _sg_sampler_desc.wrap_w = SG_WRAP_REPEAT;
+        _sg_sampler_desc.label = "curl-field-sampler";
+        state.curl.smp = sg_make_sampler(&_sg_sampler_desc);
+
+        // psi is a sum of periodic gradient noise octaves, the lattice is
+        // wrapped to the period so that the texture repeats seamlessly. The
+        // velocity (dpsi/dy, -dpsi/dx) is divergence free in every z slice
+        sg_shader_desc _generate_shader_desc{};
+        _generate_shader_desc.compute_func.source = R"(
+#version 430
+uniform int frequency;
+uniform int octaves;
+uniform int seed;
+uniform int size;
+
+layout(binding=0, rgba16f) uniform writeonly image3D field_out;
+layout(local_size_x=4, local_size_y=4, local_size_z=4) in;
+
+vec3 lattice_gradient(ivec3 c, int period) {
+  c = ((c % period) + period) % period;
+  uint h = uint(c.x) * 1597334673u ^ uint(c.y) * 3812015801u ^ uint(c.z) * 2798796415u ^ uint(seed) * 2654435761u;
+  h ^= h >> 16;
+  h *= 2246822519u;
+  h ^= h >> 13;
+  vec3 g = vec3(uvec3(h, h >> 10, h >> 20) & 1023u) / 511.5 - 1.0;
+  return g / max(length(g), 1.0e-3);
+}
+
+float gradient_noise(vec3 p, int period) {
+  ivec3 i = ivec3(floor(p));
+  vec3 f = fract(p);
+  vec3 u = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+  float n000 = dot(lattice_gradient(i + ivec3(0, 0, 0), period), f - vec3(0, 0, 0));
+  float n100 = dot(lattice_gradient(i + ivec3(1, 0, 0), period), f - vec3(1, 0, 0));
+  float n010 = dot(lattice_gradient(i + ivec3(0, 1, 0), period), f - vec3(0, 1, 0));
+  float n110 = dot(lattice_gradient(i + ivec3(1, 1, 0), period), f - vec3(1, 1, 0));
+  float n001 = dot(lattice_gradient(i + ivec3(0, 0, 1), period), f - vec3(0, 0, 1));
+  float n101 = dot(lattice_gradient(i + ivec3(1, 0, 1), period), f - vec3(1, 0, 1));
+  float n011 = dot(lattice_gradient(i + ivec3(0, 1, 1), period), f - vec3(0, 1, 1));
+  float n111 = dot(lattice_gradient(i + ivec3(1, 1, 1), period), f - vec3(1, 1, 1));
+  return mix(mix(mix(n000, n100, u.x), mix(n010, n110, u.x), u.y),
+             mix(mix(n001, n101, u.x), mix(n011, n111, u.x), u.y), u.z);
+}
+
+// uvw in [0, 1)^3 is one period of the field
+float potential(vec3 uvw) {
+  float psi = 0.0;
+  float amplitude = 1.0;
+  int period = frequency;
+  for (int o = 0; o < octaves; o++) {
+    psi += amplitude * gradient_noise(uvw * float(period), period);
+    amplitude *= 0.5;
+    period *= 2;
+  }
+  return psi;
+}
+
+void main() {
+  ivec3 gid = ivec3(gl_GlobalInvocationID.xyz);
+  if (any(greaterThanEqual(gid, ivec3(size)))) {
+    return;
+  }
+  vec3 uvw = (vec3(gid) + 0.5) / float(size);
+  float e = 0.5 / float(size);
+  float dpsi_dx = potential(uvw + vec3(e, 0, 0)) - potential(uvw - vec3(e, 0, 0));
+  float dpsi_dy = potential(uvw + vec3(0, e, 0)) - potential(uvw - vec3(0, e, 0));
+  // central differences over the particle domain [-1, 1] (2 units per period),
+  // divided by the base frequency so that the speed doesn't grow with it
+  vec2 vel = vec2(dpsi_dy, -dpsi_dx) / (4.0 * e * float(frequency));
+  imageStore(field_out, gid, vec4(vel, potential(uvw), 0.0));
+}
+)";
+        _generate_shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _generate_shader_desc.uniform_blocks[0].size = sizeof(curl_field_params_t);
+        _generate_shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "frequency" };
+        _generate_shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "octaves" };
+        _generate_shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "seed" };
+        _generate_shader_desc.uniform_blocks[0].glsl_uniforms[3] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "size" };
+        _generate_shader_desc.storage_images[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _generate_shader_desc.storage_images[0].image_type = SG_IMAGETYPE_3D;
+        _generate_shader_desc.storage_images[0].access_format = SG_PIXELFORMAT_RGBA16F;
+        _generate_shader_desc.storage_images[0].writeonly = true;
+        _generate_shader_desc.storage_images[0].glsl_binding_n = 0;
+        _generate_shader_desc.label = "curl-generate-shader";
+
+        sg_pipeline_desc _generate_pipeline_desc{};
+        _generate_pipeline_desc.compute = true;
+        _generate_pipeline_desc.shader = sg_make_shader(&_generate_shader_desc);
+        _generate_pipeline_desc.label = "curl-generate-pipeline";
+        state.curl.generate_pip = sg_make_pipeline(&_generate_pipeline_desc);
+
+        // relax each velocity towards the flow at the particle position
+        const std::string advect_source = R"(
+#version 430
+uniform float dt;
+uniform float speed;
+uniform float drag;
+uniform float z;
+uniform int num_particles;
+uniform sampler3D curl_tex;
+)" + particle_state_decls() + R"(
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+  uint idx = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+  if (idx >= num_particles) {
+    return;
+  }
+  vec2 uv = load_pos(idx) * 0.5 + 0.5;
+  vec2 flow = speed * textureLod(curl_tex, vec3(uv, z), 0.0).xy;
+  vec2 vel = load_vel(idx);
+  store_vel(idx, mix(vel, flow, 1.0 - exp(-drag * dt)));
+}
+)";
+        sg_shader_desc _advect_shader_desc{};
+        _advect_shader_desc.compute_func.source = advect_source.c_str();
+        _advect_shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _advect_shader_desc.uniform_blocks[0].size = sizeof(curl_params_t);
+        _advect_shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt" };
+        _advect_shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "speed" };
+        _advect_shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "drag" };
+        _advect_shader_desc.uniform_blocks[0].glsl_uniforms[3] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "z" };
+        _advect_shader_desc.uniform_blocks[0].glsl_uniforms[4] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" };
+        for (int i = 0; i < 2; i++) {
+            if (particle_state_sbufs() & (1u << i)) {
+                _advect_shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_COMPUTE;
+                _advect_shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+            }
+        }
+        _advect_shader_desc.images[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _advect_shader_desc.images[0].image_type = SG_IMAGETYPE_3D;
+        _advect_shader_desc.images[0].sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+        _advect_shader_desc.samplers[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _advect_shader_desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+        _advect_shader_desc.image_sampler_pairs[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _advect_shader_desc.image_sampler_pairs[0].image_slot = 0;
+        _advect_shader_desc.image_sampler_pairs[0].sampler_slot = 0;
+        _advect_shader_desc.image_sampler_pairs[0].glsl_name = "curl_tex";
+        _advect_shader_desc.label = "curl-advect-shader";
+
+        sg_pipeline_desc _advect_pipeline_desc{};
+        _advect_pipeline_desc.compute = true;
+        _advect_pipeline_desc.shader = sg_make_shader(&_advect_shader_desc);
+        _advect_pipeline_desc.label = "curl-advect-pipeline";
+        state.curl.advect_pip = sg_make_pipeline(&_advect_pipeline_desc);
+
+        state.curl.params = { 4, 3, 1, CURL_FIELD_SIZE };
+    }
+
+    // cull/LOD compaction
+    if (state.config.cull_cell_size > 0) {
+        const int cell_size = state.config.cull_cell_size;
+        state.cull.params = {
+            0,
+            ((int)SCREEN_WIDTH + cell_size - 1) / cell_size,
+            ((int)SCREEN_HEIGHT + cell_size - 1) / cell_size,
+            cell_size,
+            (int32_t)SCREEN_WIDTH,
+            (int32_t)SCREEN_HEIGHT,
+            PARTICLE_POINT_SIZE,
+        };
+
+        const std::string decls = R"(
+#version 430
+)" + particle_draw_decls() + R"(
+layout(std430, binding=3) buffer draw_list_ssbo {
+  uint draw_list[];
+};
+layout(std430, binding=4) buffer cell_winner_ssbo {
+  uint cell_winner[];
+};
+layout(std430, binding=5) buffer offsets_ssbo {
+  uint offsets[];
+};
+layout(std430, binding=6) buffer args_ssbo {
+  uint draw_args[];
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+uint item_index() {
+  return gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+}
+)";
+        // needs img_w/img_h, cells_x/cells_y and cell_size
+        const std::string cell_decls = R"(
+// pixel position of a particle, image row 0 is the top of the screen
+vec2 screen_pos(uint i) {
+  vec2 pos = draw_pos(i);
+  return vec2(pos.x * 0.5 + 0.5, 0.5 - pos.y * 0.5) * vec2(img_w, img_h);
+}
+
+uint cell_index(vec2 c) {
+  ivec2 cell = clamp(ivec2(floor(c)) / cell_size, ivec2(0), ivec2(cells_x, cells_y) - 1);
+  return uint(cell.y * cells_x + cell.x);
+}
+)";
+        const std::initializer_list<sg_glsl_shader_uniform> count_uniforms = {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        };
+        const uint32_t sbufs = particle_draw_sbufs() | 0x78;
+        const uint32_t readonly = particle_draw_sbufs();
+
+        const std::string clear_source = decls + R"(
+uniform int cells_x;
+uniform int cells_y;
+
+void main() {
+  uint idx = item_index();
+  if (idx < uint(cells_x * cells_y)) {
+    cell_winner[idx] = 0u;
+  }
+}
+)";
+        state.cull.clear_pip = make_compute_pipeline("cull-clear", clear_source.c_str(), sizeof(cull_clear_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cells_x" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cells_y" },
+        }, sbufs, readonly);
+
+        // later particles are drawn on top, so the highest index of a cell is its impostor
+        const std::string mark_source = decls + R"(
+uniform int num_particles;
+uniform int cells_x;
+uniform int cells_y;
+uniform int cell_size;
+uniform int img_w;
+uniform int img_h;
+uniform float point_size;
+)" + cell_decls + R"(
+// the point sprite overlaps the viewport
+bool on_screen(vec2 c) {
+  float r = 0.5 * point_size;
+  return all(greaterThan(c + r, vec2(0.0))) && all(lessThan(c - r, vec2(img_w, img_h)));
+}
+
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+  vec2 c = screen_pos(idx);
+  if (on_screen(c)) {
+    atomicMax(cell_winner[cell_index(c)], idx + 1u);
+  }
+}
+)";
+        state.cull.mark_pip = make_compute_pipeline("cull-mark", mark_source.c_str(), sizeof(cull_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cells_x" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cells_y" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cell_size" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_w" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_h" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "point_size" },
+        }, sbufs, readonly);
+
+        // one flag per particle plus a trailing 0, so that the scan leaves the total in offsets[num_particles]
+        const std::string flag_source = decls + R"(
+uniform int num_particles;
+uniform int cells_x;
+uniform int cells_y;
+uniform int cell_size;
+uniform int img_w;
+uniform int img_h;
+)" + cell_decls + R"(
+void main() {
+  uint idx = item_index();
+  if (idx > num_particles) {
+    return;
+  }
+  offsets[idx] = ((idx < num_particles) && (cell_winner[cell_index(screen_pos(idx))] == idx + 1u)) ? 1u : 0u;
+}
+)";
+        state.cull.flag_pip = make_compute_pipeline("cull-flag", flag_source.c_str(), sizeof(cull_flag_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cells_x" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cells_y" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "cell_size" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_w" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "img_h" },
+        }, sbufs, readonly);
+
+        const std::string scatter_source = decls + R"(
+uniform int num_particles;
+
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+  uint dst = offsets[idx];
+  if (offsets[idx + 1u] != dst) {
+    draw_list[dst] = idx;
+  }
+}
+)";
+        state.cull.scatter_pip = make_compute_pipeline("cull-scatter", scatter_source.c_str(), sizeof(cull_count_params_t), count_uniforms, sbufs, readonly);
+
+        const std::string args_source = decls + R"(
+uniform int num_particles;
+
+void main() {
+  if (gl_GlobalInvocationID.x == 0u) {
+    draw_args[0] = 1u;
+    draw_args[1] = offsets[num_particles];
+    draw_args[2] = 0u;
+    draw_args[3] = 0u;
+  }
+}
+)";
+        state.cull.args_pip = make_compute_pipeline("cull-args", args_source.c_str(), sizeof(cull_count_params_t), count_uniforms, sbufs, readonly);
+
+        const std::string draw_source = "#version 430 core\n" + particle_draw_decls() + R"(
+layout(std430, binding=3) readonly buffer draw_list_ssbo {
+  uint draw_list[];
+};
+
+layout(location=0) out vec4 vColor;
+
+void main() {
+  uint p = draw_list[gl_InstanceID];
+  gl_Position = vec4(draw_pos(p), 0.0f, 1.0f);
+  gl_PointSize = 20.0f;
+  vColor = draw_color(p);
+}
+)";
+        sg_shader_desc _shader_desc{};
+        _shader_desc.vertex_func.source = draw_source.c_str();
+        _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(location=0) in vec4 vColor;
+out vec4 frag_color;
+
+void main() {
+  frag_color = vColor;
+}
+)";
+        const uint32_t vs_sbufs = particle_draw_sbufs() | 0x8;
+        for (int i = 0; i < SG_MAX_STORAGEBUFFER_BINDSLOTS; i++) {
+            if (vs_sbufs & (1u << i)) {
+                _shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_VERTEX;
+                _shader_desc.storage_buffers[i].readonly = true;
+                _shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+            }
+        }
+        _shader_desc.label = "cull-draw-shader";
+
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
+        _pipeline_desc.label = "cull-draw-pipeline";
+        state.cull.draw_pip = sg_make_pipeline(&_pipeline_desc);
+    }
+
+    // init
+    {
+        std::string source = R"(
+#version 430
+uniform int seed;
+uniform int num_particles;
+)";
+        if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+            source += R"(
+struct particle_t {
+  vec2 pos;
+  vec2 vel;
+  vec4 color;
+};
+
+layout(std430, binding=0) writeonly buffer ssbo {
+  particle_t prt[];
+};
+)";
+        } else if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+            source += PACKED_PARTICLE_GLSL;
+            source += R"(
+layout(std430, binding=0) writeonly buffer ssbo {
+  packed_particle_t prt[];
+};
+)";
+        } else {
+            source += R"(
+layout(std430, binding=0) writeonly buffer pos_ssbo {
+  vec2 prt_pos[];
+};
+layout(std430, binding=1) writeonly buffer vel_ssbo {
+  vec2 prt_vel[];
+};
+layout(std430, binding=2) writeonly buffer color_ssbo {
+  vec4 prt_color[];
+};
+)";
+        }
+        source += PCG_HASH_GLSL;
+        source += R"(
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+void main() {
+  uint idx = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+  if (idx >= num_particles) {
+    return;
+  }
+
+  // same disc distribution as the CPU path
+  float r = 0.25 * sqrt(rnd(idx, 0u));
+  float theta = rnd(idx, 1u) * 2.0 * 3.14159265358979323846;
+  vec2 pos = r * vec2(cos(theta), sin(theta));
+  vec2 vel = normalize(pos) * 0.25;
+  vec4 color = vec4(rnd(idx, 2u), rnd(idx, 3u), rnd(idx, 4u), rnd(idx, 5u));
+)";
+        if (state.config.layout == PARTICLE_LAYOUT_AOS) {
+            source += R"(
+  prt[idx].pos = pos;
+  prt[idx].vel = vel;
+  prt[idx].color = color;
+}
+)";
+        } else if (state.config.layout == PARTICLE_LAYOUT_PACKED) {
+            source += R"(
+  prt[idx].pos = pack_pos(pos);
+  prt[idx].vel = packHalf2x16(vel);
+  prt[idx].color = packUnorm4x8(color);
+}
+)";
+        } else {
+            source += R"(
+  prt_pos[idx] = pos;
+  prt_vel[idx] = vel;
+  prt_color[idx] = color;
+}
+)";
+        }
+
+        sg_shader_desc _sg_init_shader_desc{};
+        _sg_init_shader_desc.compute_func.source = source.c_str();
+
+        _sg_init_shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+        _sg_init_shader_desc.uniform_blocks[0].size = sizeof(init_params_t);
+        _sg_init_shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "seed",  };
+        _sg_init_shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles",  };
+
+        const int num_sbufs = state.config.layout == PARTICLE_LAYOUT_SOA ? 3 : 1;
+        for (int i = 0; i < num_sbufs; i++) {
+            _sg_init_shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_COMPUTE;
+            _sg_init_shader_desc.storage_buffers[i].readonly = false;
+            _sg_init_shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+        }
+
+        _sg_init_shader_desc.label = "init-shader";
+
+        sg_shader init_shd = sg_make_shader(&_sg_init_shader_desc);
+
+        sg_pipeline_desc _init_pipeline_desc{};
+        _init_pipeline_desc.compute = true;
+        _init_pipeline_desc.shader = init_shd;
+        _init_pipeline_desc.label = "init-pipeline";
+
+        state.compute.init_pip = sg_make_pipeline(&_init_pipeline_desc);
+    }
+
+    // emit/kill lifecycle
+    if (lifecycle_enabled()) {
+        // the particle state keeps its layout bindings (0-2), the lists and
+        // counters follow it, alive_out and counters are also read by the
+        // draw and stats shaders at bindings 3 and 5
+        const std::string counters_decl = R"(
+#version 430
+layout(std430, binding=5) buffer counters_ssbo {
+  uint alive_in_count;
+  uint alive_out_count;
+  uint dead_count;
+  uint emit_count;
+};
+
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+uint item_index() {
+  return gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+}
+)";
+        const std::string lists_decl = R"(
+layout(std430, binding=3) buffer alive_out_ssbo {
+  uint alive_out[];
+};
+layout(std430, binding=4) buffer alive_in_ssbo {
+  uint alive_in[];
+};
+layout(std430, binding=6) buffer life_ssbo {
+  float prt_life[];
+};
+layout(std430, binding=7) buffer dead_ssbo {
+  uint dead_list[];
+};
+)";
+        const uint32_t list_sbufs = 0xF8;
+        const uint32_t args_sbufs = 0x60;
+
+        // only the tiny prepare/finalize passes write the indirect arguments,
+        // they are bound with lifecycle_args_bindings()
+        const std::string args_decl = R"(
+layout(std430, binding=6) buffer args_ssbo {
+  uint simulate_args[3];
+  uint emit_args[3];
+  uint draw_args[4];
+};
+
+// fold group counts above the dispatch limit into y, see dispatch_items()
+void write_dispatch_args(inout uint args[3], uint num_items) {
+  uint num_groups = (num_items + 63u) / 64u;
+  uint num_groups_x = clamp(num_groups, 1u, 65535u);
+  args[0] = num_groups_x;
+  args[1] = (num_groups + num_groups_x - 1u) / num_groups_x;
+  args[2] = 1u;
+}
+)";
+
+        const std::string reset_source = counters_decl + lists_decl + R"(
+uniform int num_particles;
+
+void main() {
+  uint idx = item_index();
+  if (idx >= num_particles) {
+    return;
+  }
+  dead_list[idx] = idx;
+  if (idx == 0) {
+    alive_in_count = 0u;
+    alive_out_count = 0u;
+    dead_count = uint(num_particles);
+    emit_count = 0u;
+  }
+}
+)";
+        state.lifecycle.reset_pip = make_compute_pipeline("lifecycle-reset", reset_source.c_str(), sizeof(reset_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, list_sbufs);
+
+        // last frame's survivors become this frame's input, emit and simulate
+        // are dispatched with exactly as many groups as they have items
+        const std::string prepare_source = counters_decl + args_decl + R"(
+uniform int num_to_emit;
+
+void main() {
+  if (item_index() == 0) {
+    alive_in_count = alive_out_count;
+    alive_out_count = 0u;
+    emit_count = min(uint(num_to_emit), dead_count);
+    write_dispatch_args(emit_args, emit_count);
+    write_dispatch_args(simulate_args, alive_in_count + emit_count);
+  }
+}
+)";
+        state.lifecycle.prepare_pip = make_compute_pipeline("lifecycle-prepare", prepare_source.c_str(), sizeof(prepare_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_to_emit" },
+        }, args_sbufs);
+
+        // pop a slot from the dead list, spawn it at the emitter and append it
+        // to the alive list that is simulated this frame
+        const std::string emit_source = counters_decl + particle_state_decls() + particle_color_decls() + lists_decl + R"(
+uniform vec2 emitter_pos;
+uniform float lifetime;
+uniform int seed;
+)" + PCG_HASH_GLSL + R"(
+void main() {
+  uint idx = item_index();
+  if (idx >= emit_count) {
+    return;
+  }
+  uint top = atomicAdd(dead_count, 0xFFFFFFFFu);
+  uint p = dead_list[top - 1u];
+
+  float theta = rnd(idx, 0u) * 2.0 * 3.14159265358979323846;
+  float speed = 0.1 + 0.3 * rnd(idx, 1u);
+  store_pos(p, emitter_pos);
+  store_vel(p, speed * vec2(cos(theta), sin(theta)));
+  store_color(p, vec4(rnd(idx, 2u), rnd(idx, 3u), rnd(idx, 4u), 1.0));
+  prt_life[p] = lifetime * (0.5 + 0.5 * rnd(idx, 5u));
+
+  alive_in[atomicAdd(alive_in_count, 1u)] = p;
+}
+)";
+        state.lifecycle.emit_pip = make_compute_pipeline("lifecycle-emit", emit_source.c_str(), sizeof(emit_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT2, .glsl_name = "emitter_pos" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "lifetime" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "seed" },
+        }, particle_state_sbufs() | particle_color_sbufs() | list_sbufs);
+
+        // age and integrate live particles, expired slots go back to the dead list
+        const std::string simulate_source = counters_decl + particle_state_decls() + lists_decl + R"(
+uniform float dt;
+uniform int substeps;
+)" + INTEGRATE_GLSL + R"(
+
+void main() {
+  uint idx = item_index();
+  if (idx >= alive_in_count) {
+    return;
+  }
+  uint p = alive_in[idx];
+  float life = prt_life[p] - dt * float(substeps);
+  if (life <= 0.0) {
+    dead_list[atomicAdd(dead_count, 1u)] = p;
+    return;
+  }
+  prt_life[p] = life;
+  integrate_particle(p);
+  alive_out[atomicAdd(alive_out_count, 1u)] = p;
+}
+)";
+        state.lifecycle.simulate_pip = make_compute_pipeline("lifecycle-simulate", simulate_source.c_str(), sizeof(simulate_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "substeps" },
+        }, particle_state_sbufs() | list_sbufs);
+
+        // one point instance per survivor
+        const std::string finalize_source = counters_decl + args_decl + R"(
+void main() {
+  if (item_index() == 0) {
+    draw_args[0] = 1u;
+    draw_args[1] = alive_out_count;
+    draw_args[2] = 0u;
+    draw_args[3] = 0u;
+  }
+}
+)";
+        state.lifecycle.finalize_pip = make_compute_pipeline("lifecycle-finalize", finalize_source.c_str(), 0, {}, args_sbufs);
+
+        sg_shader_desc _shader_desc{};
+        const std::string draw_source = "#version 430 core\n" + particle_draw_decls() + R"(
+layout(std430, binding=3) readonly buffer alive_ssbo {
+  uint alive[];
+};
+
+layout(location=0) out vec4 vColor;
+
+void main() {
+  uint p = alive[gl_InstanceID];
+  gl_Position = vec4(draw_pos(p), 0.0f, 1.0f);
+  gl_PointSize = 20.0f;
+  vColor = draw_color(p);
+}
+)";
+        _shader_desc.vertex_func.source = draw_source.c_str();
+        _shader_desc.fragment_func.source = R"(
+#version 430 core
+layout(location=0) in vec4 vColor;
+out vec4 frag_color;
 
-        std::vector<particle_t> particles{PARTICLE_COUNT};
-        for (uint32_t i = 0; i < PARTICLE_COUNT; i++) {
-            float r = 0.25f * std::sqrt(rndDist(rndEngine));
-            float theta = rndDist(rndEngine) * 2.0f * 3.14159265358979323846f;
-            float x = r * std::cos(theta) * SCREEN_HEIGHT / SCREEN_HEIGHT;
-            float y = r * std::sin(theta);
-            particles[i].pos = HMM_V2(x, y);
-            particles[i].vel = HMM_Norm(HMM_V2(x, y)) * 0.25f;
-            particles[i].color = HMM_V4(rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine));
+void main() {
+  frag_color = vColor;
+}
+)";
+        const uint32_t vs_sbufs = particle_draw_sbufs() | 0x8;
+        for (int i = 0; i < SG_MAX_STORAGEBUFFER_BINDSLOTS; i++) {
+            if (vs_sbufs & (1u << i)) {
+                _shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_VERTEX;
+                _shader_desc.storage_buffers[i].readonly = true;
+                _shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+            }
         }
+        _shader_desc.label = "lifecycle-draw-shader";
 
-        sg_buffer_desc _sg_buffer_desc{};
-        _sg_buffer_desc.usage.storage_buffer = true;
-        _sg_buffer_desc.data.ptr = particles.data();
-        _sg_buffer_desc.data.size = sizeof(particle_t) * PARTICLE_COUNT;
-        _sg_buffer_desc.label = "particle-buffer";
-        state.compute.buf = sg_make_buffer(&_sg_buffer_desc);
+        sg_pipeline_desc _pipeline_desc{};
+        _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
+        _pipeline_desc.label = "lifecycle-draw-pipeline";
+        state.lifecycle.draw_pip = sg_make_pipeline(&_pipeline_desc);
+    }
 
-        sg_shader_desc _sg_compute_shader_desc{};
-        _sg_compute_shader_desc.compute_func.source = R"(
+    // spatial hash collisions
+    if (state.config.collide) {
+        std::string decls = R"(
 #version 430
-uniform float dt;
-uniform int num_particles;
-
-struct particle_t {
-  vec2 pos;
-  vec2 vel;
-  vec4 color;
+)";
+        decls += particle_state_decls();
+        decls += R"(
+layout(std430, binding=2) buffer cell_ssbo {
+  uint cell_start[];
 };
-
-layout(std430, binding=0) buffer ssbo {
-  particle_t prt[];
+layout(std430, binding=3) buffer particle_cell_ssbo {
+  uint particle_cell[];
+};
+layout(std430, binding=4) buffer particle_rank_ssbo {
+  uint particle_rank[];
+};
+layout(std430, binding=5) buffer sorted_ssbo {
+  vec4 sorted_pos_vel[];
+};
+layout(std430, binding=6) buffer sorted_index_ssbo {
+  uint sorted_index[];
 };
 
-layout(local_size_x=64, local_size_y=1, local_size_y=1) in;
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+uint item_index() {
+  return gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+}
+)";
+        // particles outside the domain are clamped into the border cells
+        const std::string cell_coord_decl = R"(
+ivec2 cell_coord(vec2 pos) {
+  return clamp(ivec2(floor((pos + 1.0) / cell_size)), ivec2(0), ivec2(grid_dim - 1));
+}
+)";
+        const uint32_t sbufs = particle_state_sbufs() | 0x7C;
+
+        const std::string clear_source = decls + R"(
+uniform int grid_dim;
+
 void main() {
-  uint idx = gl_GlobalInvocationID.x;
-  if (idx >= num_particles) {
+  uint idx = item_index();
+  if (idx <= uint(grid_dim * grid_dim)) {
+    cell_start[idx] = 0u;
+  }
+}
+)";
+        state.collide.clear_pip = make_compute_pipeline("collide-clear", clear_source.c_str(), sizeof(collide_clear_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "grid_dim" },
+        }, sbufs);
+
+        // count particles per cell, the returned slot makes the later scatter
+        // a plain write without a second round of atomics
+        const std::string keys_source = decls + R"(
+uniform float cell_size;
+uniform int grid_dim;
+uniform int num_particles;
+)" + cell_coord_decl + R"(
+void main() {
+  uint idx = item_index();
+  if (idx >= uint(num_particles)) {
     return;
   }
+  ivec2 c = cell_coord(load_pos(idx));
+  uint cell = uint(c.y * grid_dim + c.x);
+  particle_cell[idx] = cell;
+  particle_rank[idx] = atomicAdd(cell_start[cell], 1u);
+}
+)";
+        state.collide.keys_pip = make_compute_pipeline("collide-keys", keys_source.c_str(), sizeof(collide_keys_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "cell_size" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "grid_dim" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, sbufs);
 
-  vec2 pos = prt[idx].pos;
-  vec2 vel = prt[idx].vel;
-  pos = pos + vel * dt;
+        // copy pos/vel into cell order, so that neighbor queries read
+        // contiguous memory
+        const std::string scatter_source = decls + R"(
+uniform int num_particles;
 
-  // Flip movement at window border
-  if ( (pos.x <= -1.0) || (pos.x >= 1.0) ) {
-      vel.x *= -1.0;
+void main() {
+  uint idx = item_index();
+  if (idx >= uint(num_particles)) {
+    return;
   }
-  if ( (pos.y <= -1.0) || (pos.y >= 1.0) ) {
-      vel.y *= -1.0;
+  uint dst = cell_start[particle_cell[idx]] + particle_rank[idx];
+  sorted_pos_vel[dst] = vec4(load_pos(idx), load_vel(idx));
+  sorted_index[dst] = idx;
+}
+)";
+        state.collide.scatter_pip = make_compute_pipeline("collide-scatter", scatter_source.c_str(), sizeof(collide_scatter_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, sbufs);
+
+        // resolve overlaps against the 3x3 neighborhood, every thread only
+        // writes its own particle and reads the sorted snapshot
+        const std::string collide_source = decls + R"(
+uniform float radius;
+uniform float cell_size;
+uniform int grid_dim;
+uniform int num_particles;
+)" + cell_coord_decl + R"(
+void main() {
+  uint idx = item_index();
+  if (idx >= uint(num_particles)) {
+    return;
   }
+  vec2 pos = load_pos(idx);
+  vec2 vel = load_vel(idx);
+  float diameter = 2.0 * radius;
+  ivec2 c = cell_coord(pos);
+  ivec2 cmin = max(c - 1, ivec2(0));
+  ivec2 cmax = min(c + 1, ivec2(grid_dim - 1));
 
-  prt[idx].pos = pos;
-  prt[idx].vel = vel;
+  vec2 dpos = vec2(0.0);
+  vec2 dvel = vec2(0.0);
+  for (int y = cmin.y; y <= cmax.y; y++) {
+    // the cells of a row are contiguous in the sorted arrays
+    uint row = uint(y * grid_dim);
+    uint first = cell_start[row + uint(cmin.x)];
+    uint last = cell_start[row + uint(cmax.x) + 1u];
+    for (uint k = first; k < last; k++) {
+      if (sorted_index[k] == idx) {
+        continue;
+      }
+      vec4 other = sorted_pos_vel[k];
+      vec2 d = pos - other.xy;
+      float dist2 = dot(d, d);
+      if ((dist2 >= diameter * diameter) || (dist2 < 1e-12)) {
+        continue;
+      }
+      float dist = sqrt(dist2);
+      vec2 n = d / dist;
+      // push apart by half the overlap, exchange the approaching normal
+      // velocity (equal masses)
+      dpos += n * (0.5 * (diameter - dist));
+      float vn = dot(vel - other.zw, n);
+      if (vn < 0.0) {
+        dvel -= vn * n;
+      }
+    }
+  }
+  store_pos(idx, pos + dpos);
+  store_vel(idx, vel + dvel);
 }
 )";
+        state.collide.collide_pip = make_compute_pipeline("collide", collide_source.c_str(), sizeof(collide_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "radius" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "cell_size" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "grid_dim" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, sbufs);
+    }
 
-        _sg_compute_shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
-        _sg_compute_shader_desc.uniform_blocks[0].size = sizeof(cs_params_t);
-        _sg_compute_shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt",  };
-        _sg_compute_shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles",  };
+    // N-body gravity
+    if (state.config.gravity != GRAVITY_OFF) {
+        // all-pairs: every workgroup streams all positions through a shared
+        // memory tile, out-of-range threads still help loading tiles
+        const std::string tiled_source = R"(
+#version 430
+uniform float dt;
+uniform float strength;
+uniform float softening2;
+uniform int num_particles;
+)" + particle_state_decls() + R"(
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+shared vec2 tile[256];
 
-        _sg_compute_shader_desc.storage_buffers[0].stage = SG_SHADERSTAGE_COMPUTE;
-        _sg_compute_shader_desc.storage_buffers[0].readonly = false;
-        _sg_compute_shader_desc.storage_buffers[0].glsl_binding_n = 0;
+void main() {
+  uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+  uint lid = gl_LocalInvocationID.x;
+  uint idx = group * 256u + lid;
+  bool in_range = idx < uint(num_particles);
+  vec2 pos = in_range ? load_pos(idx) : vec2(0.0);
 
-        _sg_compute_shader_desc.label = "compute-shader";
+  vec2 acc = vec2(0.0);
+  for (uint base = 0u; base < uint(num_particles); base += 256u) {
+    uint j = base + lid;
+    tile[lid] = (j < uint(num_particles)) ? load_pos(j) : vec2(0.0);
+    barrier();
+    uint count = min(256u, uint(num_particles) - base);
+    for (uint k = 0u; k < count; k++) {
+      vec2 d = tile[k] - pos;
+      float r2 = dot(d, d) + softening2;
+      acc += d * inversesqrt(r2 * r2 * r2);
+    }
+    barrier();
+  }
+  if (in_range) {
+    store_vel(idx, load_vel(idx) + strength * acc * dt);
+  }
+}
+)";
+        state.gravity.tiled_pip = make_compute_pipeline("gravity-tiled", tiled_source.c_str(), sizeof(gravity_tiled_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "strength" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "softening2" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+        }, particle_state_sbufs());
 
-        sg_shader compute_shd = sg_make_shader(&_sg_compute_shader_desc);
+        const std::string tree_decls = R"(
+#version 430
+)" + particle_state_decls() + R"(
+layout(std430, binding=2) buffer leaves_ssbo {
+  uint leaves[];
+};
+layout(std430, binding=3) buffer nodes_ssbo {
+  vec4 nodes[];
+};
+layout(std430, binding=4) buffer stats_ssbo {
+  uint interactions_lo;
+  uint interactions_hi;
+};
 
-        sg_pipeline_desc _compute_pipeline_desc{};
-        _compute_pipeline_desc.compute = true;
-        _compute_pipeline_desc.shader = compute_shd;
-        _compute_pipeline_desc.label = "compute-pipeline";
+layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
+uint item_index() {
+  return gl_GlobalInvocationID.y * gl_NumWorkGroups.x * 64 + gl_GlobalInvocationID.x;
+}
 
-        state.compute.pip = sg_make_pipeline(&_compute_pipeline_desc);
-    }
+// positions within a leaf are summed as 12-bit fixed point with integer atomics
+const float LEAF_FIXED_SCALE = 4096.0;
 
-    // graphics
-    {
-        sg_shader_desc _shader_desc{};
-        _shader_desc.vertex_func.source = R"(
-#version 430 core
+uint level_offset(uint l) {
+  return ((1u << (2u * l)) - 1u) / 3u;
+}
+)";
+        const std::string leaf_coord_decl = R"(
+vec2 leaf_coord(vec2 pos) {
+  float dim = float(1u << uint(leaf_level));
+  return clamp((pos + 1.0) * 0.5, vec2(0.0), vec2(0.99999)) * dim;
+}
+)";
+        const uint32_t tree_sbufs = particle_state_sbufs() | 0x1C;
+        const std::initializer_list<sg_glsl_shader_uniform> level_uniforms = {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "level" },
+        };
 
-struct particle_t {
-  vec2 pos;
-  vec2 vel;
-  vec4 color;
-};
+        // level is the leaf level here
+        const std::string clear_source = tree_decls + R"(
+uniform int level;
 
-layout(std430, binding=0) readonly buffer ssbo {
-  particle_t prt[];
-};
+void main() {
+  uint idx = item_index();
+  if (idx < 3u * (1u << (2u * uint(level)))) {
+    leaves[idx] = 0u;
+  }
+}
+)";
+        state.gravity.clear_pip = make_compute_pipeline("gravity-clear", clear_source.c_str(), sizeof(gravity_level_params_t), level_uniforms, tree_sbufs);
 
-layout(location=0) out vec4 vColor;
+        const std::string insert_source = tree_decls + R"(
+uniform int num_particles;
+uniform int leaf_level;
+)" + leaf_coord_decl + R"(
+void main() {
+  uint idx = item_index();
+  if (idx >= uint(num_particles)) {
+    return;
+  }
+  vec2 p = leaf_coord(load_pos(idx));
+  uvec2 c = uvec2(p);
+  uvec2 f = uvec2((p - vec2(c)) * LEAF_FIXED_SCALE);
+  uint leaf = 3u * (c.y * (1u << uint(leaf_level)) + c.x);
+  atomicAdd(leaves[leaf + 0u], 1u);
+  atomicAdd(leaves[leaf + 1u], f.x);
+  atomicAdd(leaves[leaf + 2u], f.y);
+}
+)";
+        state.gravity.insert_pip = make_compute_pipeline("gravity-insert", insert_source.c_str(), sizeof(gravity_insert_params_t), {
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "leaf_level" },
+        }, tree_sbufs);
+
+        // level is the leaf level here
+        const std::string leaf_source = tree_decls + R"(
+uniform int level;
 
 void main() {
-  vec2 pos = prt[gl_InstanceID].pos;
-  vec4 color = prt[gl_InstanceID].color;
-  gl_Position = vec4(pos, 0.0f, 1.0f);
-  gl_PointSize = 20.0f;
-  vColor = color;
+  uint idx = item_index();
+  uint dim = 1u << uint(level);
+  if (idx >= dim * dim) {
+    return;
+  }
+  float mass = float(leaves[3u * idx]);
+  vec4 node = vec4(0.0);
+  if (mass > 0.0) {
+    vec2 frac = vec2(leaves[3u * idx + 1u], leaves[3u * idx + 2u]) / (LEAF_FIXED_SCALE * mass);
+    vec2 c = vec2(idx % dim, idx / dim) + frac;
+    node = vec4(c / float(dim) * 2.0 - 1.0, mass, 0.0);
+  }
+  nodes[level_offset(uint(level)) + idx] = node;
 }
 )";
-        _shader_desc.fragment_func.source = R"(
-#version 430 core
-layout(location=0) in vec4 vColor;
-out vec4 frag_color;
+        state.gravity.leaf_pip = make_compute_pipeline("gravity-leaf", leaf_source.c_str(), sizeof(gravity_level_params_t), level_uniforms, tree_sbufs);
+
+        const std::string reduce_source = tree_decls + R"(
+uniform int level;
 
 void main() {
-  frag_color = vColor;
+  uint idx = item_index();
+  uint dim = 1u << uint(level);
+  if (idx >= dim * dim) {
+    return;
+  }
+  uvec2 c = uvec2(idx % dim, idx / dim);
+  uint child_base = level_offset(uint(level) + 1u);
+  float mass = 0.0;
+  vec2 weighted = vec2(0.0);
+  for (uint i = 0u; i < 4u; i++) {
+    uvec2 cc = 2u * c + uvec2(i & 1u, i >> 1u);
+    vec4 child = nodes[child_base + cc.y * 2u * dim + cc.x];
+    mass += child.z;
+    weighted += child.xy * child.z;
+  }
+  nodes[level_offset(uint(level)) + idx] = (mass > 0.0) ? vec4(weighted / mass, mass, 0.0) : vec4(0.0);
 }
 )";
-        _shader_desc.storage_buffers[0].stage = SG_SHADERSTAGE_VERTEX;
-        _shader_desc.storage_buffers[0].readonly = true;
-        _shader_desc.storage_buffers[0].glsl_binding_n = 0;
+        state.gravity.reduce_pip = make_compute_pipeline("gravity-reduce", reduce_source.c_str(), sizeof(gravity_level_params_t), level_uniforms, tree_sbufs);
 
-        _shader_desc.label = "fragment-shader";
+        // depth-first walk from the root, a cell is taken as a whole when
+        // size^2 < theta^2 * dist^2, otherwise its four children are visited
+        const std::string traverse_source = tree_decls + R"(
+uniform float dt;
+uniform float strength;
+uniform float softening2;
+uniform float theta2;
+uniform int num_particles;
+uniform int leaf_level;
+)" + leaf_coord_decl + R"(
+shared uint group_interactions;
 
-        sg_shader graphics_shd = sg_make_shader(&_shader_desc);
+void main() {
+  uint idx = item_index();
+  bool in_range = idx < uint(num_particles);
+  if (gl_LocalInvocationIndex == 0u) {
+    group_interactions = 0u;
+  }
+  barrier();
 
-        sg_pipeline_desc _pipeline_desc{};
-        _pipeline_desc.shader = graphics_shd;
-        _pipeline_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
-        state.graphics.pip = sg_make_pipeline(&_pipeline_desc);
+  uint interactions = 0u;
+  if (in_range) {
+    vec2 pos = load_pos(idx);
+    uvec2 own_leaf = uvec2(leaf_coord(pos));
+    vec2 acc = vec2(0.0);
 
-        state.graphics.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.2f, 0.3f, 0.3f, 1.0f } };
+    // node codes: level << 20 | y << 10 | x
+    uint stack[48];
+    int sp = 0;
+    stack[sp++] = 0u;
+    while (sp > 0) {
+      uint code = stack[--sp];
+      uint l = code >> 20u;
+      uvec2 c = uvec2(code & 1023u, (code >> 10u) & 1023u);
+      uint dim = 1u << l;
+      vec4 node = nodes[level_offset(l) + c.y * dim + c.x];
+      float mass = node.z;
+      if (mass <= 0.0) {
+        continue;
+      }
+      vec2 d = node.xy - pos;
+      float size = 2.0 / float(dim);
+      bool is_leaf = (l == uint(leaf_level));
+      if (is_leaf || (size * size < theta2 * dot(d, d))) {
+        if (is_leaf && all(equal(c, own_leaf))) {
+          // remove the particle itself from its own leaf
+          if (mass <= 1.0) {
+            continue;
+          }
+          vec2 com = (node.xy * mass - pos) / (mass - 1.0);
+          mass -= 1.0;
+          d = com - pos;
+        }
+        float r2 = dot(d, d) + softening2;
+        acc += mass * d * inversesqrt(r2 * r2 * r2);
+        interactions++;
+      } else {
+        uint child = (l + 1u) << 20u;
+        for (uint i = 0u; i < 4u; i++) {
+          uvec2 cc = 2u * c + uvec2(i & 1u, i >> 1u);
+          stack[sp++] = child | (cc.y << 10u) | cc.x;
+        }
+      }
+    }
+    store_vel(idx, load_vel(idx) + strength * acc * dt);
+  }
+
+  // 64-bit interaction counter, one atomic per workgroup
+  atomicAdd(group_interactions, interactions);
+  barrier();
+  if (gl_LocalInvocationIndex == 0u) {
+    uint old = atomicAdd(interactions_lo, group_interactions);
+    if (old + group_interactions < old) {
+      atomicAdd(interactions_hi, 1u);
+    }
+  }
+}
+)";
+        state.gravity.traverse_pip = make_compute_pipeline("gravity-traverse", traverse_source.c_str(), sizeof(gravity_params_t), {
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "dt" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "strength" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "softening2" },
+            { .type = SG_UNIFORMTYPE_FLOAT, .glsl_name = "theta2" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_particles" },
+            { .type = SG_UNIFORMTYPE_INT, .glsl_name = "leaf_level" },
+        }, tree_sbufs);
+        state.gravity.mode = state.config.gravity;
     }
 
+    gpu_timer_init(&state.timer);
+    if (state.config.validate) {
+        particle_cpu_pool_init(&state.validate.pool, 0);
+    }
 
+    create_particle_buffers(state.config.sweep_counts.empty() ? state.config.particle_count : state.config.sweep_counts[0]);
  }
 
-void frame() {
-    const double dt = sapp_frame_duration();
+constexpr int SWEEP_WARMUP_FRAMES = 30;
+constexpr int SWEEP_MEASURE_FRAMES = 240;
+
+const char* particle_layout_name(particle_layout_t layout) {
+    switch (layout) {
+        case PARTICLE_LAYOUT_SOA: return "soa";
+        case PARTICLE_LAYOUT_PACKED: return "packed";
+        default: return "aos";
+    }
+}
 
-    const cs_params_t cs_params = { (float)dt, PARTICLE_COUNT};
+// effective bandwidth in GB/s of a pass that moves bytes_per_particle for
+// every particle in ms milliseconds
+double particle_bandwidth(uint32_t bytes_per_particle, double ms) {
+    return ms > 0.0 ? (double)bytes_per_particle * state.num_particles / (ms * 1.0e6) : 0.0;
+}
 
-    // compute pass
+// sweep mode: run each particle count for a fixed number of frames, print the
+// averaged frame time and per-pass GPU times, then move on to the next count
+void sweep_frame(double dt, const char* label) {
+    state.sweep.frame++;
+    if (state.sweep.frame == SWEEP_WARMUP_FRAMES) {
+        gpu_timer_reset(&state.timer);
+        state.sweep.frame_ms = 0.0;
+        state.sweep.num_barriers = 0;
+        state.sweep.num_substeps = 0;
+    }
+    if (state.sweep.frame <= SWEEP_WARMUP_FRAMES) {
+        return;
+    }
+    state.sweep.frame_ms += dt * 1000.0;
+    // stats of the previous frame, close enough for a steady state average
+    state.sweep.num_barriers += sg_query_frame_stats().gl.num_memory_barriers;
+    state.sweep.num_substeps += state.step.substeps;
+    if (state.sweep.frame < SWEEP_WARMUP_FRAMES + SWEEP_MEASURE_FRAMES) {
+        return;
+    }
+    const double compute_ms = gpu_timer_ms(&state.timer, "compute");
+    const double graphics_ms = gpu_timer_ms(&state.timer, "graphics");
+    printf("%s %10u particles (%uB): frame %.3fms | barriers %.1f/frame | compute %.3fms %.1fGB/s | graphics %.3fms %.1fGB/s\n",
+        label,
+        state.num_particles,
+        particle_state_bytes(),
+        state.sweep.frame_ms / SWEEP_MEASURE_FRAMES,
+        (double)state.sweep.num_barriers / SWEEP_MEASURE_FRAMES,
+        compute_ms,
+        particle_bandwidth(particle_compute_bytes(), compute_ms),
+        graphics_ms,
+        particle_bandwidth(particle_graphics_bytes(), graphics_ms));
+    printf("%s %10u particles: %.2f steps/frame at %dHz | %llu steps dropped\n",
+        label,
+        state.num_particles,
+        (double)state.sweep.num_substeps / SWEEP_MEASURE_FRAMES,
+        state.config.step_hz,
+        (unsigned long long)state.step.num_dropped);
+    if (forces_enabled()) {
+        // the stage timings below are of the first step, this is all the others
+        printf("%s %10u particles: remaining steps %.3fms\n", label, state.num_particles, gpu_timer_ms(&state.timer, "steps"));
+    }
+    if (state.config.raster) {
+        printf("%s %10u particles: bin %.3fms | raster %.3fms | %.1f Mparticles/s\n",
+            label,
+            state.num_particles,
+            gpu_timer_ms(&state.timer, "bin"),
+            gpu_timer_ms(&state.timer, "raster"),
+            state.num_particles / ((gpu_timer_ms(&state.timer, "bin") + gpu_timer_ms(&state.timer, "raster") + graphics_ms) * 1.0e3));
+    }
+    if (state.config.cull_cell_size > 0) {
+        const uint32_t num_drawn = cull_num_drawn();
+        printf("%s %10u particles: cull %.3fms | drawn %u (%.2f%%, %dpx cells)\n",
+            label,
+            state.num_particles,
+            gpu_timer_ms(&state.timer, "cull"),
+            num_drawn,
+            100.0 * num_drawn / state.num_particles,
+            state.config.cull_cell_size);
+    }
+    if (state.config.collide) {
+        printf("%s %10u particles: keys %.3fms | scan %.3fms | scatter %.3fms | collide %.3fms\n",
+            label,
+            state.num_particles,
+            gpu_timer_ms(&state.timer, "keys"),
+            gpu_timer_ms(&state.timer, "scan"),
+            gpu_timer_ms(&state.timer, "scatter"),
+            gpu_timer_ms(&state.timer, "collide"));
+    }
+    if (state.gravity.mode != GRAVITY_OFF) {
+        gravity_report(label);
+    }
+    if (state.config.curl_speed > 0.0f) {
+        printf("%s %10u particles: curl %.3fms | field %d^3 generated %u times\n",
+            label,
+            state.num_particles,
+            gpu_timer_ms(&state.timer, "curl"),
+            CURL_FIELD_SIZE,
+            state.curl.num_generated);
+    }
+    if (state.config.stats) {
+        printf("%s %10u particles: stats reduction %.3fms\n", label, state.num_particles, gpu_timer_ms(&state.timer, "stats"));
+        stats_report(label);
+    }
+    fflush(stdout);
+
+    state.sweep.index++;
+    state.sweep.frame = 0;
+    if (state.sweep.index >= state.config.sweep_counts.size()) {
+        sapp_request_quit();
+        return;
+    }
+    destroy_particle_buffers();
+    create_particle_buffers(state.config.sweep_counts[state.sweep.index]);
+}
+
+// one dispatch of the integration shader over the current state, with
+// pingpong the result goes to the next slot and becomes the new head
+void integrate_pass(const cs_params_t& cs_params, bool pingpong) {
+    if (pingpong) {
+        const int next = (state.compute.head + 1) % (state.config.lag + 1);
+        sg_bindings _compute_bindings = particle_state_bindings();
+        if (state.config.layout != PARTICLE_LAYOUT_SOA) {
+            _compute_bindings.storage_buffers[3] = state.compute.slots[next];
+        } else {
+            _compute_bindings.storage_buffers[3] = state.compute.pos_slots[next];
+            _compute_bindings.storage_buffers[4] = state.compute.vel_slots[next];
+        }
+        sg_pass _compute_pass = { .compute=true, .label="pingpong-compute-pass" };
+        sg_begin_pass(&_compute_pass);
+        sg_apply_pipeline(state.compute.pingpong_pip);
+        sg_apply_bindings(_compute_bindings);
+        sg_apply_uniforms(0, SG_RANGE(cs_params));
+        dispatch_items(state.num_particles);
+        sg_end_pass();
+        set_particle_state_head(next);
+        return;
+    }
     sg_bindings _compute_bindings{};
-    _compute_bindings.storage_buffers[0] = state.compute.buf;
+    if (state.config.layout != PARTICLE_LAYOUT_SOA) {
+        _compute_bindings.storage_buffers[0] = state.compute.buf;
+    } else {
+        _compute_bindings.storage_buffers[0] = state.compute.soa.pos;
+        _compute_bindings.storage_buffers[1] = state.compute.soa.vel;
+    }
     sg_pass _compute_pass = { .compute=true, .label="compute_pass" };
     sg_begin_pass(&_compute_pass);
     sg_apply_pipeline(state.compute.pip);
     sg_apply_bindings(_compute_bindings);
     sg_apply_uniforms(0, SG_RANGE(cs_params));
-    sg_dispatch((PARTICLE_COUNT + 63)/64, 1, 1);
+    dispatch_items(state.num_particles);
     sg_end_pass();
+}
+
+// number of fixed steps to simulate this frame
+int consume_fixed_steps(double dt) {
+    const double step_dt = 1.0 / state.config.step_hz;
+    state.step.accum += dt;
+    int steps = (int)(state.step.accum / step_dt);
+    state.step.accum -= steps * step_dt;
+    if (steps > MAX_SUBSTEPS) {
+        state.step.num_dropped += steps - MAX_SUBSTEPS;
+        steps = MAX_SUBSTEPS;
+    }
+    state.step.substeps = steps;
+    return steps;
+}
+
+void frame() {
+    const double dt = sapp_frame_duration();
+
+    // the simulation only ever sees the fixed step, dt is just the frame time
+    const int substeps = consume_fixed_steps(dt);
+    const float step_dt = 1.0f / (float)state.config.step_hz;
+    const cs_params_t cs_params = { step_dt, (int32_t)state.num_particles, substeps };
+
+    gpu_timer_begin_frame(&state.timer);
+
+    // the CPU reference steps the state the last compute dispatch is about to
+    // see, after the forces of that step were applied
+    const bool validate_frame = state.config.validate && (++state.validate.frame == VALIDATE_FRAME);
+
+    // compute pass
+    if (state.config.fused) {
+        // nothing to simulate, the span stays for comparable timings
+        state.fused.time += (double)step_dt * substeps;
+        gpu_timer_stamp(&state.timer, "compute");
+    } else if (lifecycle_enabled()) {
+        if (validate_frame) {
+            download_particle_state(&state.validate.expected);
+            state.validate.alive = download_alive_slots(download_lifecycle_counters());
+            for (int i = 0; i < substeps; i++) {
+                particle_cpu_step(&state.validate.expected, &state.validate.pool, step_dt);
+            }
+        }
+        lifecycle_compute_pass(cs_params);
+        gpu_timer_stamp(&state.timer, "compute");
+    } else if (forces_enabled()) {
+        // forces between every fixed step, the first step is timed stage by
+        // stage and the remaining ones together as "steps"
+        const cs_params_t step_params = { step_dt, (int32_t)state.num_particles, 1 };
+        for (int i = 0; i < substeps; i++) {
+            state.step.untimed = i > 0;
+            if (state.gravity.mode != GRAVITY_OFF) {
+                gravity_passes(step_dt);
+            }
+            if (state.config.curl_speed > 0.0f) {
+                curl_passes(step_dt);
+            }
+            if (state.config.collide) {
+                collide_passes();
+            }
+            if (validate_frame && (i == substeps - 1)) {
+                download_particle_state(&state.validate.expected);
+                particle_cpu_step(&state.validate.expected, &state.validate.pool, step_dt);
+            }
+            integrate_pass(step_params, (state.config.lag > 0) && (i == 0));
+            if (i == 0) {
+                gpu_timer_stamp(&state.timer, "compute");
+            }
+            state.step.num_steps++;
+        }
+        state.step.untimed = false;
+        if (substeps == 0) {
+            if (validate_frame) {
+                download_particle_state(&state.validate.expected);
+            }
+            gpu_timer_stamp(&state.timer, "compute");
+        }
+        gpu_timer_stamp(&state.timer, "steps");
+    } else {
+        if (validate_frame) {
+            download_particle_state(&state.validate.expected);
+            for (int i = 0; i < substeps; i++) {
+                particle_cpu_step(&state.validate.expected, &state.validate.pool, step_dt);
+            }
+        }
+        // a frame shorter than a step leaves the state unchanged
+        if (substeps > 0) {
+            integrate_pass(cs_params, state.config.lag > 0);
+        }
+        gpu_timer_stamp(&state.timer, "compute");
+        state.step.num_steps += substeps;
+    }
+    particle_snapshot_poll(&state.snapshot.writer, false);
+    if (state.snapshot.save_requested) {
+        state.snapshot.save_requested = false;
+        save_particle_snapshot();
+    }
+    if (validate_frame && lifecycle_enabled()) {
+        validate_lifecycle((std::string("lifecycle-") + particle_layout_name(state.config.layout)).c_str());
+    } else if (validate_frame) {
+        validate_particles(particle_layout_name(state.config.layout));
+    }
+    if (state.config.stats) {
+        stats_passes();
+    }
 
     // graphics pass
     sg_bindings _graphics_bindings{};
-    _graphics_bindings.storage_buffers[0] = state.compute.buf;
+    sg_pipeline graphics_pip = state.graphics.pip;
+    if (lifecycle_enabled()) {
+        _graphics_bindings = particle_draw_bindings();
+        _graphics_bindings.storage_buffers[3] = state.lifecycle.alive[state.lifecycle.cur];
+        graphics_pip = state.lifecycle.draw_pip;
+    } else if (state.config.cull_cell_size > 0) {
+        _graphics_bindings = cull_bindings();
+        graphics_pip = state.cull.draw_pip;
+    } else {
+        _graphics_bindings = particle_draw_bindings();
+    }
+    if (state.config.raster) {
+        raster_passes();
+    } else if (state.config.cull_cell_size > 0) {
+        cull_passes();
+    }
     sg_pass _graphics_pass = { .action=state.graphics.pass_action, .swapchain=sglue_swapchain() };
     sg_begin_pass(&_graphics_pass);
-    sg_apply_pipeline(state.graphics.pip);
-    sg_apply_bindings(_graphics_bindings);
-    sg_draw(0, 1, PARTICLE_COUNT);
+    if (state.config.raster) {
+        sg_bindings _composite_bindings{};
+        _composite_bindings.images[0] = state.raster.img;
+        _composite_bindings.samplers[0] = state.raster.smp;
+        sg_apply_pipeline(state.raster.composite_pip);
+        sg_apply_bindings(_composite_bindings);
+        sg_draw(0, 6, 1);
+    } else if (state.config.fused) {
+        const fused_params_t fused_params = { (float)state.fused.time, state.fused.seed };
+        sg_apply_pipeline(state.fused.pip);
+        sg_apply_uniforms(0, SG_RANGE(fused_params));
+        sg_draw(0, 1, (int)state.num_particles);
+    } else {
+        sg_apply_pipeline(graphics_pip);
+        sg_apply_bindings(_graphics_bindings);
+        if (lifecycle_enabled()) {
+            sg_draw_indirect(state.lifecycle.args, LIFECYCLE_DRAW_ARGS_OFFSET);
+        } else if (state.config.cull_cell_size > 0) {
+            sg_draw_indirect(state.cull.args, 0);
+        } else {
+            sg_draw(0, 1, (int)state.num_particles);
+        }
+    }
     sg_end_pass();
+    gpu_timer_stamp(&state.timer, "graphics");
     sg_commit();
+
+    std::string label = state.config.fused ? "fused" : particle_layout_name(state.config.layout);
+    if (lifecycle_enabled()) {
+        label = "lifecycle-" + label;
+    }
+    if (state.config.lag > 0) {
+        label += "-lag" + std::to_string(state.config.lag);
+    }
+    if (state.config.raster) {
+        label += "-raster";
+    }
+    if (state.config.cull_cell_size > 0) {
+        label += "-cull";
+    }
+    const char* layout_name = label.c_str();
+    if (!state.config.sweep_counts.empty()) {
+        sweep_frame(dt, layout_name);
+    } else if (state.config.bench && (state.timer.num_samples >= 120)) {
+        if (state.gravity.mode != GRAVITY_OFF) {
+            gravity_report(layout_name);
+        }
+        if (!lifecycle_enabled() && !state.config.fused) {
+            printf("%s %10u particles (%uB): compute %.1fGB/s | graphics %.1fGB/s\n",
+                layout_name,
+                state.num_particles,
+                particle_state_bytes(),
+                particle_bandwidth(particle_compute_bytes(), gpu_timer_ms(&state.timer, "compute")),
+                particle_bandwidth(particle_graphics_bytes(), gpu_timer_ms(&state.timer, "graphics")));
+        }
+        gpu_timer_report(&state.timer, layout_name);
+    } else if (state.config.stats && (state.stats.readback.frame_index % STATS_REPORT_INTERVAL == 0)) {
+        stats_report(layout_name);
+    }
 }
 
 void cleanup() {
+    // --save: checkpoint the final state, then wait for all writes
+    if (state.config.save_path) {
+        particle_snapshot_poll(&state.snapshot.writer, true);
+        save_particle_snapshot();
+        particle_snapshot_poll(&state.snapshot.writer, true);
+    }
+    particle_snapshot_close(&state.snapshot.loaded);
+    destroy_particle_buffers();
+    if (state.config.stats) {
+        gpu_readback_shutdown(&state.stats.readback);
+        sg_destroy_buffer(state.stats.result);
+    }
+    if (state.config.raster) {
+        gpu_scan_shutdown(&state.raster.scan);
+    }
+    particle_cpu_pool_shutdown(&state.validate.pool);
+    gpu_timer_shutdown(&state.timer);
     sg_shutdown();
 }
 
-void input(const sapp_event* event) {}
+void input(const sapp_event* event) {
+    // the lifecycle emitter follows the mouse
+    if (event->type == SAPP_EVENTTYPE_MOUSE_MOVE) {
+        state.lifecycle.emitter_pos.X = 2.0f * event->mouse_x / sapp_widthf() - 1.0f;
+        state.lifecycle.emitter_pos.Y = 1.0f - 2.0f * event->mouse_y / sapp_heightf();
+    }
+    // C reseeds the curl-noise field, F cycles its frequency, both regenerate it
+    if ((event->type == SAPP_EVENTTYPE_KEY_DOWN) && !event->key_repeat && (state.config.curl_speed > 0.0f)) {
+        if (event->key_code == SAPP_KEYCODE_C) {
+            state.curl.params.seed++;
+        } else if (event->key_code == SAPP_KEYCODE_F) {
+            state.curl.params.frequency = state.curl.params.frequency >= CURL_MAX_FREQUENCY ? 1 : 2 * state.curl.params.frequency;
+        }
+    }
+    // S saves a snapshot of the current state if --save was given
+    if ((event->type == SAPP_EVENTTYPE_KEY_DOWN) && (event->key_code == SAPP_KEYCODE_S) && !event->key_repeat && state.config.save_path) {
+        state.snapshot.save_requested = true;
+    }
+    // G cycles the gravity mode (tiled -> barnes-hut -> off) if --gravity was given
+    if ((event->type == SAPP_EVENTTYPE_KEY_DOWN) && (event->key_code == SAPP_KEYCODE_G) && (state.config.gravity != GRAVITY_OFF)) {
+        switch (state.gravity.mode) {
+            case GRAVITY_TILED: state.gravity.mode = GRAVITY_BARNES_HUT; break;
+            case GRAVITY_BARNES_HUT: state.gravity.mode = GRAVITY_OFF; break;
+            default: state.gravity.mode = GRAVITY_TILED; break;
+        }
+        state.gravity.num_frames = 0;
+        const uint32_t zero[2] = {};
+        upload_buffer_range(state.gravity.stats, 0, zero, sizeof(zero));
+        printf("gravity: %s\n", gravity_mode_name(state.gravity.mode));
+        fflush(stdout);
+    }
+}
+
+// options can be given on the command line or through environment variables:
+//   --layout=aos|soa|packed PARTICLE_LAYOUT particle storage layout (default: aos)
+//   --init=gpu|cpu     PARTICLE_INIT     seed particles with a compute pass or upload from the CPU (default: gpu)
+//   --count=N          PARTICLE_COUNT    number of particles, k/m suffix allowed (default: 8192)
+//   --emit=N           PARTICLE_EMIT     spawn N particles per second into a pool of --count slots (default: 0, off)
+//   --lifetime=S       PARTICLE_LIFETIME max particle lifetime in seconds with --emit (default: 4)
+//   --gravity=MODE     PARTICLE_GRAVITY  n-body gravity: off, tiled, bh (barnes-hut) or auto (default: off)
+//   --collide[=R]      PARTICLE_COLLIDE  particle-particle collisions with radius R (default: 1/sqrt(count))
+//   --sweep[=N,N,...]  PARTICLE_SWEEP    report frame time for each count, then quit
+//   --bench            PARTICLE_BENCH    print averaged GPU timings of each pass
+//   --validate         PARTICLE_VALIDATE compare one integrate step per count with the CPU reference
+//   --fused            PARTICLE_FUSED    no compute pass, the vertex shader evaluates positions from time and seed
+//   --lag=N            PARTICLE_LAG      draw the state from N frames ago (0-2) so compute and draw overlap (default: 0)
+//   --raster           PARTICLE_RASTER   draw with the tile-binned compute rasterizer instead of GL points
+//   --cull[=N]         PARTICLE_CULL     drop off-screen particles and draw one impostor per NxN pixel cell (default: 4)
+//   --step-hz=N        PARTICLE_STEP_HZ  fixed simulation steps per second, run as substeps of one dispatch,
+//                                        or one dispatch per step with --gravity, --curl or --collide (default: 240)
+//   --curl[=SPEED]     PARTICLE_CURL     drag particles along a cached 3D curl-noise flow field (default speed: 0.5)
+//   --stats            PARTICLE_STATS    print live count, average speed and bounds, read back without stalling
+//   --save=FILE        PARTICLE_SAVE     write a state snapshot to FILE when S is pressed and at exit
+//   --load=FILE        PARTICLE_LOAD     start from a snapshot, its layout and particle count replace --layout/--count
+void parse_args(int argc, char* argv[]) {
+    const char* layout = getenv("PARTICLE_LAYOUT");
+    const char* init = getenv("PARTICLE_INIT");
+    const char* count = getenv("PARTICLE_COUNT");
+    const char* sweep = getenv("PARTICLE_SWEEP");
+    const char* emit = getenv("PARTICLE_EMIT");
+    const char* lifetime = getenv("PARTICLE_LIFETIME");
+    const char* collide = getenv("PARTICLE_COLLIDE");
+    const char* gravity = getenv("PARTICLE_GRAVITY");
+    state.config.bench = getenv("PARTICLE_BENCH") != nullptr;
+    state.config.validate = getenv("PARTICLE_VALIDATE") != nullptr;
+    state.config.fused = getenv("PARTICLE_FUSED") != nullptr;
+    const char* lag = getenv("PARTICLE_LAG");
+    state.config.raster = getenv("PARTICLE_RASTER") != nullptr;
+    const char* cull = getenv("PARTICLE_CULL");
+    const char* step_hz = getenv("PARTICLE_STEP_HZ");
+    const char* curl = getenv("PARTICLE_CURL");
+    state.config.stats = getenv("PARTICLE_STATS") != nullptr;
+    state.config.save_path = getenv("PARTICLE_SAVE");
+    const char* load = getenv("PARTICLE_LOAD");
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--layout=", 9)) {
+            layout = argv[i] + 9;
+        } else if (0 == strncmp(argv[i], "--init=", 7)) {
+            init = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--count=", 8)) {
+            count = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--emit=", 7)) {
+            emit = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--lifetime=", 11)) {
+            lifetime = argv[i] + 11;
+        } else if (0 == strncmp(argv[i], "--gravity=", 10)) {
+            gravity = argv[i] + 10;
+        } else if (0 == strcmp(argv[i], "--collide")) {
+            collide = "";
+        } else if (0 == strncmp(argv[i], "--collide=", 10)) {
+            collide = argv[i] + 10;
+        } else if (0 == strcmp(argv[i], "--sweep")) {
+            sweep = "";
+        } else if (0 == strncmp(argv[i], "--sweep=", 8)) {
+            sweep = argv[i] + 8;
+        } else if (0 == strcmp(argv[i], "--bench")) {
+            state.config.bench = true;
+        } else if (0 == strcmp(argv[i], "--validate")) {
+            state.config.validate = true;
+        } else if (0 == strcmp(argv[i], "--fused")) {
+            state.config.fused = true;
+        } else if (0 == strncmp(argv[i], "--lag=", 6)) {
+            lag = argv[i] + 6;
+        } else if (0 == strcmp(argv[i], "--raster")) {
+            state.config.raster = true;
+        } else if (0 == strcmp(argv[i], "--cull")) {
+            cull = "";
+        } else if (0 == strncmp(argv[i], "--cull=", 7)) {
+            cull = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--step-hz=", 10)) {
+            step_hz = argv[i] + 10;
+        } else if (0 == strcmp(argv[i], "--stats")) {
+            state.config.stats = true;
+        } else if (0 == strcmp(argv[i], "--curl")) {
+            curl = "";
+        } else if (0 == strncmp(argv[i], "--curl=", 7)) {
+            curl = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--save=", 7)) {
+            state.config.save_path = argv[i] + 7;
+        } else if (0 == strncmp(argv[i], "--load=", 7)) {
+            load = argv[i] + 7;
+        }
+    }
+    state.config.layout = PARTICLE_LAYOUT_AOS;
+    if (layout && (0 == strcmp(layout, "soa"))) {
+        state.config.layout = PARTICLE_LAYOUT_SOA;
+    } else if (layout && (0 == strcmp(layout, "packed"))) {
+        state.config.layout = PARTICLE_LAYOUT_PACKED;
+    }
+    state.config.cpu_init = init && (0 == strcmp(init, "cpu"));
+    state.config.emit_rate = emit ? parse_count(emit) : 0;
+    state.config.lifetime = lifetime ? (float)atof(lifetime) : DEFAULT_PARTICLE_LIFETIME;
+    state.config.collide = collide != nullptr;
+    state.config.collide_radius = (collide && *collide) ? (float)atof(collide) : 0.0f;
+    if (lifecycle_enabled() && state.config.collide) {
+        printf("--collide is not supported with --emit, ignoring --collide\n");
+        state.config.collide = false;
+    }
+    state.config.gravity = GRAVITY_OFF;
+    if (gravity && (0 == strcmp(gravity, "tiled"))) {
+        state.config.gravity = GRAVITY_TILED;
+    } else if (gravity && (0 == strcmp(gravity, "bh"))) {
+        state.config.gravity = GRAVITY_BARNES_HUT;
+    } else if (gravity && (0 == strcmp(gravity, "auto"))) {
+        state.config.gravity = GRAVITY_AUTO;
+    }
+    if (lifecycle_enabled() && (state.config.gravity != GRAVITY_OFF)) {
+        printf("--gravity is not supported with --emit, ignoring --gravity\n");
+        state.config.gravity = GRAVITY_OFF;
+    }
+    state.config.curl_speed = curl ? ((*curl) ? std::max((float)atof(curl), 0.0f) : DEFAULT_CURL_SPEED) : 0.0f;
+    if (lifecycle_enabled() && (state.config.curl_speed > 0.0f)) {
+        printf("--curl is not supported with --emit, ignoring --curl\n");
+        state.config.curl_speed = 0.0f;
+    }
+    if (state.config.fused && (lifecycle_enabled() || state.config.collide || (state.config.gravity != GRAVITY_OFF) || (state.config.curl_speed > 0.0f) || state.config.validate)) {
+        printf("--fused only supports stateless particles, ignoring --fused\n");
+        state.config.fused = false;
+    }
+    if (state.config.fused && state.config.stats) {
+        printf("--stats is not supported with --fused, ignoring --stats\n");
+        state.config.stats = false;
+    }
+    state.config.lag = lag ? std::clamp(atoi(lag), 0, MAX_PARTICLE_LAG) : 0;
+    if ((state.config.lag > 0) && (lifecycle_enabled() || state.config.fused)) {
+        printf("--lag is not supported with --emit or --fused, ignoring --lag\n");
+        state.config.lag = 0;
+    }
+    if (state.config.raster && (lifecycle_enabled() || state.config.fused)) {
+        printf("--raster is not supported with --emit or --fused, ignoring --raster\n");
+        state.config.raster = false;
+    }
+    state.config.cull_cell_size = cull ? ((*cull) ? std::clamp(atoi(cull), 1, 64) : DEFAULT_CULL_CELL_SIZE) : 0;
+    if ((state.config.cull_cell_size > 0) && (lifecycle_enabled() || state.config.fused || state.config.raster)) {
+        printf("--cull is not supported with --emit, --fused or --raster, ignoring --cull\n");
+        state.config.cull_cell_size = 0;
+    }
+    state.config.step_hz = step_hz ? std::clamp(atoi(step_hz), 1, 10000) : DEFAULT_STEP_HZ;
+    state.config.particle_count = count ? parse_count(count) : DEFAULT_PARTICLE_COUNT;
+    if (sweep) {
+        if (*sweep == 0) {
+            sweep = "8k,64k,256k,1m,4m,16m";
+        }
+        for (const char* str = sweep; *str; ) {
+            state.config.sweep_counts.push_back(parse_count(str));
+            str = strchr(str, ',');
+            if (!str) {
+                break;
+            }
+            str++;
+        }
+    }
+    if ((state.config.save_path || load) && (lifecycle_enabled() || state.config.fused)) {
+        printf("--save and --load are not supported with --emit or --fused, ignoring them\n");
+        state.config.save_path = nullptr;
+        load = nullptr;
+    }
+    if (load && particle_snapshot_open(&state.snapshot.loaded, load)) {
+        const particle_snapshot_header_t& header = state.snapshot.loaded.header;
+        if (header.layout > PARTICLE_LAYOUT_PACKED) {
+            printf("snapshot: %s: unknown layout %u, ignoring --load\n", load, header.layout);
+            particle_snapshot_close(&state.snapshot.loaded);
+            return;
+        }
+        // the sections must be exactly the buffers of the layout, checked
+        // before the snapshot overrides any option
+        const particle_layout_t layout = (particle_layout_t)header.layout;
+        size_t sizes[PARTICLE_SNAPSHOT_MAX_SECTIONS];
+        const int num_sections = particle_snapshot_sizes(layout, header.num_particles, sizes);
+        bool ok = (header.num_sections == (uint32_t)num_sections);
+        for (int i = 0; ok && (i < num_sections); i++) {
+            ok = (header.sections[i].size == sizes[i]);
+        }
+        if (!ok) {
+            printf("snapshot: %s: sections don't match the %s layout, ignoring --load\n", load, particle_layout_name(layout));
+            particle_snapshot_close(&state.snapshot.loaded);
+            return;
+        }
+        state.config.layout = layout;
+        state.config.particle_count = header.num_particles;
+        // resume with the same fixed step unless another one was asked for
+        if (!step_hz) {
+            state.config.step_hz = std::clamp((int)header.step_hz, 1, 10000);
+        }
+        if (!state.config.sweep_counts.empty()) {
+            printf("--sweep is not supported with --load, ignoring --sweep\n");
+            state.config.sweep_counts.clear();
+        }
+        printf("snapshot: loaded %u %s particles from %s (step %llu at %uHz)\n",
+            header.num_particles,
+            particle_layout_name(state.config.layout),
+            load,
+            (unsigned long long)header.num_steps,
+            header.step_hz);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
 
-int main() {
     sapp_desc desc = {0};
     desc.init_cb = init;
     desc.frame_cb = frame;
@@ -0,0 +1,243 @@
+#pragma once
+// Particle state snapshots (requires gl_ext.h before sokol_gfx.h).
+//
+// Saving copies the storage buffers into a staging buffer on the GPU and puts
+// a fence behind the copy, particle_snapshot_poll() writes the file once the
+// fence has signaled, so a save never stalls the frame.
+//
+// The file is a fixed little-endian header followed by one section per
+// storage buffer, every section starts at a PARTICLE_SNAPSHOT_ALIGN boundary.
+// particle_snapshot_open() maps the file read-only and the sections can be
+// passed to sg_buffer_desc.data as they are, without a copy on the CPU.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr char PARTICLE_SNAPSHOT_MAGIC[8] = { 'P', 'R', 'T', 'S', 'N', 'A', 'P', 0 };
+constexpr uint32_t PARTICLE_SNAPSHOT_VERSION = 1;
+// page size, sections of a mapped file are page aligned
+constexpr uint64_t PARTICLE_SNAPSHOT_ALIGN = 4096;
+// SoA: position, velocity, color
+constexpr int PARTICLE_SNAPSHOT_MAX_SECTIONS = 3;
+
+struct particle_snapshot_section_t {
+    uint64_t offset;                // from the start of the file
+    uint64_t size;
+};
+
+struct particle_snapshot_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t layout;                // particle_layout_t of the writer
+    uint32_t num_particles;
+    uint32_t step_hz;               // fixed steps per second of the simulation
+    uint32_t num_sections;
+    uint64_t num_steps;             // fixed steps simulated since the state was seeded
+    particle_snapshot_section_t sections[PARTICLE_SNAPSHOT_MAX_SECTIONS];
+};
+static_assert(sizeof(particle_snapshot_header_t) == 88, "snapshot header layout changed, bump PARTICLE_SNAPSHOT_VERSION");
+
+// an in-flight save
+struct particle_snapshot_writer_t {
+    particle_snapshot_header_t header;
+    std::string path;
+    GLuint staging;
+    GLsync fence;
+    bool pending;
+};
+
+// a mapped snapshot file
+struct particle_snapshot_t {
+    particle_snapshot_header_t header;
+    const uint8_t* data;
+    size_t size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+inline uint64_t particle_snapshot_align(uint64_t offset) {
+    return (offset + PARTICLE_SNAPSHOT_ALIGN - 1) / PARTICLE_SNAPSHOT_ALIGN * PARTICLE_SNAPSHOT_ALIGN;
+}
+
+// start a save of num_sections buffers, header only needs layout, num_particles,
+// step_hz and num_steps filled in. Returns false if a save is still in flight.
+// Must be called outside of sokol passes, after the buffers were written.
+inline bool particle_snapshot_begin_save(particle_snapshot_writer_t* w, const char* path, const particle_snapshot_header_t& header, const sg_buffer* buffers, const size_t* sizes, int num_sections) {
+    if (w->pending) {
+        return false;
+    }
+    w->header = header;
+    memcpy(w->header.magic, PARTICLE_SNAPSHOT_MAGIC, sizeof(PARTICLE_SNAPSHOT_MAGIC));
+    w->header.version = PARTICLE_SNAPSHOT_VERSION;
+    w->header.header_size = sizeof(particle_snapshot_header_t);
+    w->header.num_sections = (uint32_t)num_sections;
+    uint64_t offset = particle_snapshot_align(sizeof(particle_snapshot_header_t));
+    for (int i = 0; i < num_sections; i++) {
+        w->header.sections[i] = { offset, sizes[i] };
+        offset = particle_snapshot_align(offset + sizes[i]);
+    }
+    w->path = path;
+
+    // the staging buffer mirrors the file layout, header page included
+    glGenBuffers(1, &w->staging);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, w->staging);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)offset, nullptr, GL_STREAM_READ);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    for (int i = 0; i < num_sections; i++) {
+        const sg_gl_buffer_info info = sg_gl_query_buffer_info(buffers[i]);
+        glBindBuffer(GL_COPY_READ_BUFFER, info.buf[info.active_slot]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (GLintptr)w->header.sections[i].offset, (GLsizeiptr)sizes[i]);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    w->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    w->pending = true;
+    return true;
+}
+
+// write the file if the copy has finished, with wait the call blocks until it
+// has. Returns true when a file was written (or failed to write) by this call.
+inline bool particle_snapshot_poll(particle_snapshot_writer_t* w, bool wait) {
+    if (!w->pending) {
+        return false;
+    }
+    const GLenum status = glClientWaitSync(w->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+    if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED)) {
+        return false;
+    }
+    glDeleteSync(w->fence);
+    w->pending = false;
+
+    const particle_snapshot_section_t& last = w->header.sections[w->header.num_sections - 1];
+    const uint64_t file_size = last.offset + last.size;
+    glBindBuffer(GL_COPY_READ_BUFFER, w->staging);
+    const uint8_t* data = (const uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)file_size, GL_MAP_READ_BIT);
+    bool ok = false;
+    FILE* f = data ? fopen(w->path.c_str(), "wb") : nullptr;
+    if (f) {
+        // padding is written as zeros, so that the same state always gives
+        // the same file
+        static const uint8_t zeros[PARTICLE_SNAPSHOT_ALIGN] = {};
+        uint64_t pos = sizeof(particle_snapshot_header_t);
+        ok = (fwrite(&w->header, sizeof(particle_snapshot_header_t), 1, f) == 1);
+        for (uint32_t i = 0; ok && (i < w->header.num_sections); i++) {
+            const particle_snapshot_section_t& section = w->header.sections[i];
+            ok = (fwrite(zeros, 1, (size_t)(section.offset - pos), f) == section.offset - pos) &&
+                 ((section.size == 0) || (fwrite(data + section.offset, (size_t)section.size, 1, f) == 1));
+            pos = section.offset + section.size;
+        }
+        ok = (fclose(f) == 0) && ok;
+    }
+    if (data) {
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glDeleteBuffers(1, &w->staging);
+    w->staging = 0;
+    if (ok) {
+        printf("snapshot: wrote %u particles to %s (%.1fMB)\n", w->header.num_particles, w->path.c_str(), file_size / (1024.0 * 1024.0));
+    } else {
+        printf("snapshot: failed to write %s\n", w->path.c_str());
+    }
+    return true;
+}
+
+inline void particle_snapshot_close(particle_snapshot_t* s) {
+#if defined(_WIN32)
+    if (s->data) {
+        UnmapViewOfFile(s->data);
+    }
+    if (s->mapping) {
+        CloseHandle(s->mapping);
+    }
+    if (s->file && (s->file != INVALID_HANDLE_VALUE)) {
+        CloseHandle(s->file);
+    }
+#else
+    if (s->data) {
+        munmap((void*)s->data, s->size);
+    }
+#endif
+    *s = {};
+}
+
+// map a snapshot file and check its header, prints the reason on failure
+inline bool particle_snapshot_open(particle_snapshot_t* s, const char* path) {
+    *s = {};
+#if defined(_WIN32)
+    s->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER file_size = {};
+    if ((s->file == INVALID_HANDLE_VALUE) || !GetFileSizeEx(s->file, &file_size)) {
+        printf("snapshot: can't open %s\n", path);
+        particle_snapshot_close(s);
+        return false;
+    }
+    s->size = (size_t)file_size.QuadPart;
+    s->mapping = CreateFileMappingA(s->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    s->data = s->mapping ? (const uint8_t*)MapViewOfFile(s->mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    const int fd = open(path, O_RDONLY);
+    struct stat st = {};
+    if ((fd < 0) || (fstat(fd, &st) != 0)) {
+        printf("snapshot: can't open %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    s->size = (size_t)st.st_size;
+    void* data = s->size > 0 ? mmap(nullptr, s->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    s->data = data != MAP_FAILED ? (const uint8_t*)data : nullptr;
+#endif
+    if (!s->data) {
+        printf("snapshot: can't map %s\n", path);
+        particle_snapshot_close(s);
+        return false;
+    }
+
+    const char* error = nullptr;
+    if (s->size < sizeof(particle_snapshot_header_t)) {
+        error = "file too small";
+    } else {
+        memcpy(&s->header, s->data, sizeof(particle_snapshot_header_t));
+        if (0 != memcmp(s->header.magic, PARTICLE_SNAPSHOT_MAGIC, sizeof(PARTICLE_SNAPSHOT_MAGIC))) {
+            error = "not a particle snapshot";
+        } else if ((s->header.version != PARTICLE_SNAPSHOT_VERSION) || (s->header.header_size != sizeof(particle_snapshot_header_t))) {
+            error = "unsupported version";
+        } else if ((s->header.num_sections == 0) || (s->header.num_sections > PARTICLE_SNAPSHOT_MAX_SECTIONS)) {
+            error = "bad section count";
+        }
+        for (uint32_t i = 0; !error && (i < s->header.num_sections); i++) {
+            const particle_snapshot_section_t& section = s->header.sections[i];
+            if ((section.offset % PARTICLE_SNAPSHOT_ALIGN) || (section.offset > s->size) || (section.size > s->size - section.offset)) {
+                error = "bad section";
+            }
+        }
+    }
+    if (error) {
+        printf("snapshot: %s: %s\n", path, error);
+        particle_snapshot_close(s);
+        return false;
+    }
+    return true;
+}
+
+// section i of a mapped snapshot, ready for sg_buffer_desc.data
+inline sg_range particle_snapshot_section(const particle_snapshot_t* s, int i) {
+    return { s->data + s->header.sections[i].offset, (size_t)s->header.sections[i].size };
+}
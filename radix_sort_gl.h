@@ -0,0 +1,301 @@
+#pragma once
+// GPU LSD radix sort of 32-bit keys with 32-bit values (requires scan_gl.h).
+//
+// Every pass sorts by one RADIX_SORT_DIGIT_BITS digit in three steps:
+//   histogram: each workgroup counts the digits of its block of keys into a
+//              digit-major table hist[digit * num_blocks + block]
+//   scan:      an exclusive prefix sum of that table gives every (digit, block)
+//              pair its first output slot
+//   scatter:   each workgroup ranks its keys stably in shared memory and
+//              writes keys and values to their final slot
+// Passes ping-pong between the input and internal temp buffers. The pass count
+// is rounded up to an even number so that the result always ends up in the
+// caller's buffers, the padding pass uses shift 32 which maps every key to
+// digit 0 and is a plain stable copy. radix_sort() only records dispatches
+// and must be called inside a compute pass.
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+constexpr uint32_t RADIX_SORT_DIGIT_BITS = 4;
+constexpr uint32_t RADIX_SORT_NUM_DIGITS = 1 << RADIX_SORT_DIGIT_BITS;
+constexpr uint32_t RADIX_SORT_THREADS = 256;
+constexpr uint32_t RADIX_SORT_ITEMS_PER_THREAD = 4;
+constexpr uint32_t RADIX_SORT_BLOCK_SIZE = RADIX_SORT_THREADS * RADIX_SORT_ITEMS_PER_THREAD;
+
+struct radix_sort_t {
+    sg_pipeline histogram_pip;
+    sg_pipeline scatter_pip;
+    sg_buffer tmp_keys;
+    sg_buffer tmp_values;
+    sg_buffer hist;
+    gpu_scan_t scan;
+    uint32_t max_items;
+};
+
+struct radix_sort_params_t {
+    int32_t num_items;
+    int32_t num_blocks;
+    int32_t shift;
+};
+
+inline uint32_t radix_sort_num_blocks(uint32_t num_items) {
+    return (num_items + RADIX_SORT_BLOCK_SIZE - 1) / RADIX_SORT_BLOCK_SIZE;
+}
+
+// storage buffer slot n is bound to GLSL binding n for every bit n in sbuf_mask
+inline sg_pipeline radix_sort_make_pipeline(const char* label, const char* source, uint32_t sbuf_mask) {
+    sg_shader_desc _shader_desc{};
+    _shader_desc.compute_func.source = source;
+    _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.uniform_blocks[0].size = sizeof(radix_sort_params_t);
+    _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_items" };
+    _shader_desc.uniform_blocks[0].glsl_uniforms[1] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_blocks" };
+    _shader_desc.uniform_blocks[0].glsl_uniforms[2] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "shift" };
+    for (int i = 0; i < SG_MAX_STORAGEBUFFER_BINDSLOTS; i++) {
+        if (sbuf_mask & (1u << i)) {
+            _shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_COMPUTE;
+            _shader_desc.storage_buffers[i].readonly = false;
+            _shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+        }
+    }
+    _shader_desc.label = label;
+
+    sg_pipeline_desc _pipeline_desc{};
+    _pipeline_desc.compute = true;
+    _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+    _pipeline_desc.label = label;
+    return sg_make_pipeline(&_pipeline_desc);
+}
+
+inline void radix_sort_init(radix_sort_t* s, uint32_t max_items) {
+    *s = {};
+    s->max_items = max_items;
+
+    s->histogram_pip = radix_sort_make_pipeline("radix-sort-histogram", R"(
+#version 430
+uniform int num_items;
+uniform int num_blocks;
+uniform int shift;
+
+layout(std430, binding=0) buffer keys_in_ssbo {
+  uint keys_in[];
+};
+layout(std430, binding=4) buffer hist_ssbo {
+  uint hist[];
+};
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+shared uint local_hist[16];
+
+uint digit_of(uint key) {
+  return (shift < 32) ? ((key >> uint(shift)) & 15u) : 0u;
+}
+
+void main() {
+  uint block = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+  uint lid = gl_LocalInvocationID.x;
+  if (lid < 16u) {
+    local_hist[lid] = 0u;
+  }
+  barrier();
+
+  uint base = block * 1024u + lid * 4u;
+  for (uint i = 0u; i < 4u; i++) {
+    if (base + i < uint(num_items)) {
+      atomicAdd(local_hist[digit_of(keys_in[base + i])], 1u);
+    }
+  }
+  barrier();
+
+  if (lid < 16u) {
+    hist[lid * uint(num_blocks) + block] = local_hist[lid];
+  }
+}
+)", (1u << 0) | (1u << 4));
+
+    // counts[digit * 256 + thread] holds how many of the thread's keys have
+    // that digit, the exclusive scan of this digit-major table gives every
+    // thread its first slot per digit, relative to the block's digit start
+    s->scatter_pip = radix_sort_make_pipeline("radix-sort-scatter", R"(
+#version 430
+uniform int num_items;
+uniform int num_blocks;
+uniform int shift;
+
+layout(std430, binding=0) buffer keys_in_ssbo {
+  uint keys_in[];
+};
+layout(std430, binding=1) buffer values_in_ssbo {
+  uint values_in[];
+};
+layout(std430, binding=2) buffer keys_out_ssbo {
+  uint keys_out[];
+};
+layout(std430, binding=3) buffer values_out_ssbo {
+  uint values_out[];
+};
+layout(std430, binding=4) buffer hist_ssbo {
+  uint hist[];
+};
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+shared uint counts[16 * 256];
+shared uint partial[256];
+
+uint digit_of(uint key) {
+  return (shift < 32) ? ((key >> uint(shift)) & 15u) : 0u;
+}
+
+void main() {
+  uint block = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+  uint lid = gl_LocalInvocationID.x;
+  uint base = block * 1024u + lid * 4u;
+
+  uint keys[4];
+  uint digits[4];
+  for (uint d = 0u; d < 16u; d++) {
+    counts[d * 256u + lid] = 0u;
+  }
+  for (uint i = 0u; i < 4u; i++) {
+    if (base + i < uint(num_items)) {
+      keys[i] = keys_in[base + i];
+      digits[i] = digit_of(keys[i]);
+      counts[digits[i] * 256u + lid] += 1u;
+    }
+  }
+  barrier();
+
+  // block-wide exclusive scan over the 4096 counts, 16 per thread
+  uint v[16];
+  uint sum = 0u;
+  for (uint j = 0u; j < 16u; j++) {
+    v[j] = counts[lid * 16u + j];
+    sum += v[j];
+  }
+  partial[lid] = sum;
+  barrier();
+  for (uint offset = 1u; offset < 256u; offset <<= 1u) {
+    uint t = (lid >= offset) ? partial[lid - offset] : 0u;
+    barrier();
+    partial[lid] += t;
+    barrier();
+  }
+  uint prefix = partial[lid] - sum;
+  for (uint j = 0u; j < 16u; j++) {
+    counts[lid * 16u + j] = prefix;
+    prefix += v[j];
+  }
+  barrier();
+
+  for (uint i = 0u; i < 4u; i++) {
+    if (base + i >= uint(num_items)) {
+      break;
+    }
+    uint d = digits[i];
+    // earlier keys of the same thread with the same digit keep the sort stable
+    uint rank = counts[d * 256u + lid] - counts[d * 256u];
+    for (uint j = 0u; j < i; j++) {
+      rank += (digits[j] == d) ? 1u : 0u;
+    }
+    uint dst = hist[d * uint(num_blocks) + block] + rank;
+    keys_out[dst] = keys[i];
+    values_out[dst] = values_in[base + i];
+  }
+}
+)", 0x1F);
+
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.size = sizeof(uint32_t) * max_items;
+    _sg_buffer_desc.label = "radix-sort-tmp-keys";
+    s->tmp_keys = sg_make_buffer(&_sg_buffer_desc);
+    _sg_buffer_desc.label = "radix-sort-tmp-values";
+    s->tmp_values = sg_make_buffer(&_sg_buffer_desc);
+
+    const uint32_t hist_size = RADIX_SORT_NUM_DIGITS * radix_sort_num_blocks(max_items);
+    _sg_buffer_desc.size = sizeof(uint32_t) * hist_size;
+    _sg_buffer_desc.label = "radix-sort-histogram";
+    s->hist = sg_make_buffer(&_sg_buffer_desc);
+
+    gpu_scan_init(&s->scan, hist_size);
+}
+
+inline void radix_sort_shutdown(radix_sort_t* s) {
+    gpu_scan_shutdown(&s->scan);
+    sg_destroy_buffer(s->hist);
+    sg_destroy_buffer(s->tmp_values);
+    sg_destroy_buffer(s->tmp_keys);
+    sg_destroy_pipeline(s->scatter_pip);
+    sg_destroy_pipeline(s->histogram_pip);
+}
+
+// sort num_items key/value pairs in place by the lowest key_bits bits of the keys
+inline void radix_sort(radix_sort_t* s, sg_buffer keys, sg_buffer values, uint32_t num_items, uint32_t key_bits = 32) {
+    SOKOL_ASSERT(num_items <= s->max_items);
+    if (num_items < 2) {
+        return;
+    }
+    const uint32_t num_digit_passes = (key_bits + RADIX_SORT_DIGIT_BITS - 1) / RADIX_SORT_DIGIT_BITS;
+    const uint32_t num_passes = (num_digit_passes + 1) & ~1u;
+
+    const uint32_t num_blocks = radix_sort_num_blocks(num_items);
+    const uint32_t num_groups_x = num_blocks < 65535 ? num_blocks : 65535;
+    const uint32_t num_groups_y = (num_blocks + num_groups_x - 1) / num_groups_x;
+
+    sg_buffer src_keys = keys, src_values = values;
+    sg_buffer dst_keys = s->tmp_keys, dst_values = s->tmp_values;
+    for (uint32_t pass = 0; pass < num_passes; pass++) {
+        const uint32_t shift = (pass < num_digit_passes) ? pass * RADIX_SORT_DIGIT_BITS : 32;
+        const radix_sort_params_t params = { (int32_t)num_items, (int32_t)num_blocks, (int32_t)shift };
+
+        sg_bindings _bindings{};
+        _bindings.storage_buffers[0] = src_keys;
+        _bindings.storage_buffers[1] = src_values;
+        _bindings.storage_buffers[2] = dst_keys;
+        _bindings.storage_buffers[3] = dst_values;
+        _bindings.storage_buffers[4] = s->hist;
+
+        sg_apply_pipeline(s->histogram_pip);
+        sg_apply_bindings(&_bindings);
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_dispatch((int)num_groups_x, (int)num_groups_y, 1);
+
+        gpu_scan_exclusive(&s->scan, s->hist, RADIX_SORT_NUM_DIGITS * num_blocks);
+
+        sg_apply_pipeline(s->scatter_pip);
+        sg_apply_bindings(&_bindings);
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_dispatch((int)num_groups_x, (int)num_groups_y, 1);
+
+        std::swap(src_keys, dst_keys);
+        std::swap(src_values, dst_values);
+    }
+}
+
+// CPU reference with the same digit order, the output must match the GPU
+// sort exactly (including the order of values with equal keys)
+inline void radix_sort_reference(std::vector<uint32_t>& keys, std::vector<uint32_t>& values, uint32_t key_bits = 32) {
+    std::vector<uint32_t> tmp_keys(keys.size());
+    std::vector<uint32_t> tmp_values(values.size());
+    for (uint32_t shift = 0; shift < key_bits; shift += RADIX_SORT_DIGIT_BITS) {
+        uint32_t offsets[RADIX_SORT_NUM_DIGITS] = {};
+        for (uint32_t key : keys) {
+            offsets[(key >> shift) & (RADIX_SORT_NUM_DIGITS - 1)]++;
+        }
+        uint32_t sum = 0;
+        for (uint32_t& offset : offsets) {
+            const uint32_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            const uint32_t dst = offsets[(keys[i] >> shift) & (RADIX_SORT_NUM_DIGITS - 1)]++;
+            tmp_keys[dst] = keys[i];
+            tmp_values[dst] = values[i];
+        }
+        keys.swap(tmp_keys);
+        values.swap(tmp_values);
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+// Fenced readback of a small GPU buffer without stalling (requires gl_ext.h
+// before sokol_gfx.h).
+//
+// Every frame gpu_readback_push() copies the source buffer into the next of
+// GPU_READBACK_LATENCY staging buffers and puts a fence behind the copy. Before
+// a staging buffer is reused, its previous contents are mapped and returned if
+// the fence has signaled, which is GPU_READBACK_LATENCY frames later, so the
+// CPU never waits for the GPU. With GL 4.4 or ARB_buffer_storage the staging
+// buffers are persistently and coherently mapped once at init and a signaled
+// fence is all that is needed before reading them; on plain GL 4.3 they are
+// mapped only once their copy is known to be complete.
+
+#include <cstdint>
+#include <cstring>
+
+constexpr int GPU_READBACK_LATENCY = 3;
+
+struct gpu_readback_t {
+    GLuint bufs[GPU_READBACK_LATENCY];
+    const void* mapped[GPU_READBACK_LATENCY];   // persistent mappings, null without buffer storage
+    GLsync fences[GPU_READBACK_LATENCY];
+    uint64_t frames[GPU_READBACK_LATENCY];
+    size_t size;
+    uint64_t frame_index;
+    uint64_t result_frame;      // frame the last returned result was copied in
+    uint64_t num_dropped;       // results skipped because the GPU was too far behind
+};
+
+// glBufferStorage is core in GL 4.4, before that it needs ARB_buffer_storage
+inline bool gpu_readback_has_buffer_storage() {
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if ((major > 4) || ((major == 4) && (minor >= 4))) {
+        return true;
+    }
+    GLint num_ext = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_ext);
+    for (GLint i = 0; i < num_ext; i++) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (ext && (0 == strcmp(ext, "GL_ARB_buffer_storage"))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void gpu_readback_init(gpu_readback_t* r, size_t size) {
+    *r = {};
+    r->size = size;
+    const bool persistent = gpu_readback_has_buffer_storage();
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(GPU_READBACK_LATENCY, r->bufs);
+    for (int i = 0; i < GPU_READBACK_LATENCY; i++) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, r->bufs[i]);
+        if (persistent) {
+            glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)size, nullptr, flags);
+            r->mapped[i] = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)size, flags);
+        } else {
+            glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)size, nullptr, GL_STREAM_READ);
+        }
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+inline void gpu_readback_shutdown(gpu_readback_t* r) {
+    for (int i = 0; i < GPU_READBACK_LATENCY; i++) {
+        if (r->fences[i]) {
+            glDeleteSync(r->fences[i]);
+        }
+        if (r->mapped[i]) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, r->bufs[i]);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(GPU_READBACK_LATENCY, r->bufs);
+    *r = {};
+}
+
+// queue a copy of src (outside of sokol passes, after it was written), returns
+// true and fills result with r->size bytes if an older copy was ready
+inline bool gpu_readback_push(gpu_readback_t* r, sg_buffer src, void* result) {
+    const int slot = (int)(r->frame_index % GPU_READBACK_LATENCY);
+    bool have_result = false;
+    if (r->fences[slot]) {
+        const GLenum status = glClientWaitSync(r->fences[slot], 0, 0);
+        if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED)) {
+            r->num_dropped++;
+        } else if (r->mapped[slot]) {
+            // coherent mapping, the signaled fence makes the copy visible
+            memcpy(result, r->mapped[slot], r->size);
+            r->result_frame = r->frames[slot];
+            have_result = true;
+        } else {
+            glBindBuffer(GL_COPY_READ_BUFFER, r->bufs[slot]);
+            const void* data = glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)r->size, GL_MAP_READ_BIT);
+            if (data) {
+                memcpy(result, data, r->size);
+                glUnmapBuffer(GL_COPY_READ_BUFFER);
+                r->result_frame = r->frames[slot];
+                have_result = true;
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glDeleteSync(r->fences[slot]);
+        r->fences[slot] = nullptr;
+    }
+
+    const sg_gl_buffer_info info = sg_gl_query_buffer_info(src);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, info.buf[info.active_slot]);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, r->bufs[slot]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)r->size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    r->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    r->frames[slot] = r->frame_index;
+    r->frame_index++;
+    return have_result;
+}
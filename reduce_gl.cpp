@@ -0,0 +1,367 @@
+#define SOKOL_IMPL
+#define SOKOL_NO_ENTRY
+#define SOKOL_GLCORE
+#include "gl_ext.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_log.h"
+#include "sokol_time.h"
+
+#include "gpu_timer_gl.h"
+#include "scan_gl.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr uint32_t SCREEN_WIDTH = 400;
+constexpr uint32_t SCREEN_HEIGHT = 300;
+
+constexpr int REDUCE_WARMUP_FRAMES = 10;
+constexpr int REDUCE_MEASURE_FRAMES = 100;
+
+constexpr uint32_t REDUCE_THREADS = 256;
+constexpr uint32_t REDUCE_ITEMS_PER_THREAD = 4;
+constexpr uint32_t REDUCE_BLOCK_SIZE = REDUCE_THREADS * REDUCE_ITEMS_PER_THREAD;
+
+enum reduce_variant_t {
+    VARIANT_SHARED,
+    VARIANT_SUBGROUP,
+    NUM_VARIANTS,
+};
+
+const char* variant_names[NUM_VARIANTS] = { "shared", "subgroup" };
+
+struct reduce_params_t {
+    int32_t num_items;
+};
+
+// GLreduce is a micro-benchmark of the workgroup functions in subgroup_gl.h:
+// for every count it times a block sum reduction and the gpu_scan_exclusive()
+// prefix sum once with the shared memory fallback and once with subgroup ops
+// (if the driver has GL_KHR_shader_subgroup), and checks the last result of
+// each against the CPU
+struct {
+    struct {
+        std::vector<uint32_t> counts;
+        bool validate;
+    } config;
+    size_t count_index;
+    int frame;
+    int num_variants;
+    uint32_t num_items;
+    std::vector<uint32_t> src;
+    sg_buffer src_buf;
+    sg_buffer scan_buf[NUM_VARIANTS];
+    sg_buffer sums_buf[NUM_VARIANTS];
+    sg_pipeline reduce_pip[NUM_VARIANTS];
+    gpu_scan_t scan[NUM_VARIANTS];
+    sg_pass_action pass_action;
+    gpu_timer_t timer;
+} state;
+
+GLuint gl_buffer(sg_buffer buf) {
+    const sg_gl_buffer_info info = sg_gl_query_buffer_info(buf);
+    return info.buf[info.active_slot];
+}
+
+void copy_buffer(sg_buffer src, sg_buffer dst, size_t size) {
+    glBindBuffer(GL_COPY_READ_BUFFER, gl_buffer(src));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gl_buffer(dst));
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void read_buffer(sg_buffer buf, void* data, size_t size) {
+    glBindBuffer(GL_COPY_READ_BUFFER, gl_buffer(buf));
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)size, data);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+uint32_t num_blocks(uint32_t num_items) {
+    return (num_items + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE;
+}
+
+// sum of every REDUCE_BLOCK_SIZE items into one uint
+sg_pipeline make_reduce_pipeline(bool subgroups) {
+    const std::string source = gpu_workgroup_source(R"(
+#version 430
+uniform int num_items;
+
+layout(std430, binding=0) readonly buffer data_ssbo {
+  uint data[];
+};
+layout(std430, binding=1) writeonly buffer sums_ssbo {
+  uint block_sums[];
+};
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+
+void main() {
+  uint block = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+  uint base = block * 1024u + gl_LocalInvocationID.x * 4u;
+  uint sum = 0u;
+  for (uint i = 0u; i < 4u; i++) {
+    sum += (base + i < uint(num_items)) ? data[base + i] : 0u;
+  }
+  sum = wg_add_uint(sum);
+  if (gl_LocalInvocationIndex == 0u) {
+    block_sums[block] = sum;
+  }
+}
+)", subgroups, REDUCE_THREADS);
+
+    sg_shader_desc _shader_desc{};
+    _shader_desc.compute_func.source = source.c_str();
+    _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.uniform_blocks[0].size = sizeof(reduce_params_t);
+    _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_items" };
+    _shader_desc.storage_buffers[0] = { .stage = SG_SHADERSTAGE_COMPUTE, .readonly = true, .glsl_binding_n = 0 };
+    _shader_desc.storage_buffers[1] = { .stage = SG_SHADERSTAGE_COMPUTE, .readonly = false, .glsl_binding_n = 1 };
+    _shader_desc.label = subgroups ? "reduce-subgroup-shader" : "reduce-shared-shader";
+
+    sg_pipeline_desc _pipeline_desc{};
+    _pipeline_desc.compute = true;
+    _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+    _pipeline_desc.label = subgroups ? "reduce-subgroup" : "reduce-shared";
+    return sg_make_pipeline(&_pipeline_desc);
+}
+
+void create_buffers(uint32_t count) {
+    state.num_items = count;
+    state.frame = 0;
+
+    // small values so that the sums never wrap
+    std::mt19937 rnd(count);
+    state.src.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        state.src[i] = rnd() & 0xFF;
+    }
+
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.data = { state.src.data(), sizeof(uint32_t) * count };
+    _sg_buffer_desc.label = "reduce-src";
+    state.src_buf = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.data = {};
+    for (int v = 0; v < state.num_variants; v++) {
+        _sg_buffer_desc.size = sizeof(uint32_t) * count;
+        _sg_buffer_desc.label = "scan-data";
+        state.scan_buf[v] = sg_make_buffer(&_sg_buffer_desc);
+        _sg_buffer_desc.size = sizeof(uint32_t) * num_blocks(count);
+        _sg_buffer_desc.label = "reduce-block-sums";
+        state.sums_buf[v] = sg_make_buffer(&_sg_buffer_desc);
+    }
+}
+
+void destroy_buffers() {
+    sg_destroy_buffer(state.src_buf);
+    for (int v = 0; v < state.num_variants; v++) {
+        sg_destroy_buffer(state.scan_buf[v]);
+        sg_destroy_buffer(state.sums_buf[v]);
+    }
+}
+
+// compare the last GPU results of variant v with the CPU
+bool validate(int v) {
+    const uint32_t blocks = num_blocks(state.num_items);
+    std::vector<uint32_t> gpu_sums(blocks);
+    std::vector<uint32_t> gpu_scan(state.num_items);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    read_buffer(state.sums_buf[v], gpu_sums.data(), sizeof(uint32_t) * blocks);
+    read_buffer(state.scan_buf[v], gpu_scan.data(), sizeof(uint32_t) * state.num_items);
+
+    uint32_t prefix = 0;
+    for (uint32_t i = 0; i < state.num_items; i++) {
+        if (gpu_scan[i] != prefix) {
+            return false;
+        }
+        prefix += state.src[i];
+    }
+    for (uint32_t b = 0; b < blocks; b++) {
+        uint32_t sum = 0;
+        for (uint32_t i = b * REDUCE_BLOCK_SIZE; i < std::min((b + 1) * REDUCE_BLOCK_SIZE, state.num_items); i++) {
+            sum += state.src[i];
+        }
+        if (gpu_sums[b] != sum) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void init() {
+    sg_desc _sg_desc{};
+    _sg_desc.environment = sglue_environment();
+    _sg_desc.logger.func = slog_func;
+    sg_setup(&_sg_desc);
+    stm_setup();
+
+    state.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.0f, 0.0f, 0.0f, 1.0f} };
+
+    const sg_features features = sg_query_features();
+    state.num_variants = features.compute_subgroups ? NUM_VARIANTS : 1;
+    if (features.compute_subgroups) {
+        printf("subgroups: GL_KHR_shader_subgroup, subgroup size %d\n", sg_query_limits().gl_subgroup_size);
+    } else {
+        printf("subgroups: not supported, only the shared memory fallback is measured\n");
+    }
+
+    const uint32_t max_count = *std::max_element(state.config.counts.begin(), state.config.counts.end());
+    for (int v = 0; v < state.num_variants; v++) {
+        state.reduce_pip[v] = make_reduce_pipeline(v == VARIANT_SUBGROUP);
+        gpu_scan_init(&state.scan[v], max_count, v == VARIANT_SUBGROUP);
+    }
+    gpu_timer_init(&state.timer);
+    create_buffers(state.config.counts[0]);
+}
+
+void frame() {
+    gpu_timer_begin_frame(&state.timer);
+
+    // the scan is in place, restore its input first
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    for (int v = 0; v < state.num_variants; v++) {
+        copy_buffer(state.src_buf, state.scan_buf[v], sizeof(uint32_t) * state.num_items);
+    }
+    gpu_timer_stamp(&state.timer, "copy");
+
+    const reduce_params_t params = { (int32_t)state.num_items };
+    const uint32_t blocks = num_blocks(state.num_items);
+    const uint32_t groups_x = std::min(blocks, 65535u);
+    for (int v = 0; v < state.num_variants; v++) {
+        sg_bindings _reduce_bindings{};
+        _reduce_bindings.storage_buffers[0] = state.src_buf;
+        _reduce_bindings.storage_buffers[1] = state.sums_buf[v];
+        sg_pass _reduce_pass = { .compute=true, .label="reduce-pass" };
+        sg_begin_pass(&_reduce_pass);
+        sg_apply_pipeline(state.reduce_pip[v]);
+        sg_apply_bindings(&_reduce_bindings);
+        sg_apply_uniforms(0, SG_RANGE(params));
+        sg_dispatch((int)groups_x, (int)((blocks + groups_x - 1) / groups_x), 1);
+        sg_end_pass();
+        gpu_timer_stamp(&state.timer, v == VARIANT_SUBGROUP ? "reduce-subgroup" : "reduce-shared");
+
+        sg_pass _scan_pass = { .compute=true, .label="scan-pass" };
+        sg_begin_pass(&_scan_pass);
+        gpu_scan_exclusive(&state.scan[v], state.scan_buf[v], state.num_items);
+        sg_end_pass();
+        gpu_timer_stamp(&state.timer, v == VARIANT_SUBGROUP ? "scan-subgroup" : "scan-shared");
+    }
+
+    sg_pass _pass = { .action=state.pass_action, .swapchain=sglue_swapchain() };
+    sg_begin_pass(&_pass);
+    sg_end_pass();
+    sg_commit();
+
+    state.frame++;
+    if (state.frame == REDUCE_WARMUP_FRAMES) {
+        gpu_timer_reset(&state.timer);
+    }
+    if ((state.frame < REDUCE_WARMUP_FRAMES) || (state.timer.num_samples < REDUCE_MEASURE_FRAMES)) {
+        return;
+    }
+
+    for (int v = 0; v < state.num_variants; v++) {
+        const double reduce_ms = gpu_timer_ms(&state.timer, v == VARIANT_SUBGROUP ? "reduce-subgroup" : "reduce-shared");
+        const double scan_ms = gpu_timer_ms(&state.timer, v == VARIANT_SUBGROUP ? "scan-subgroup" : "scan-shared");
+        printf("%-8s %10u items: reduce %.3fms %8.1f Mitems/s | scan %.3fms %8.1f Mitems/s",
+            variant_names[v],
+            state.num_items,
+            reduce_ms,
+            state.num_items / (reduce_ms * 1.0e3),
+            scan_ms,
+            state.num_items / (scan_ms * 1.0e3));
+        if (state.config.validate) {
+            printf(" | %s", validate(v) ? "ok" : "MISMATCH");
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+
+    destroy_buffers();
+    state.count_index++;
+    if (state.count_index >= state.config.counts.size()) {
+        sapp_request_quit();
+        return;
+    }
+    create_buffers(state.config.counts[state.count_index]);
+    gpu_timer_reset(&state.timer);
+}
+
+void cleanup() {
+    if (state.count_index < state.config.counts.size()) {
+        destroy_buffers();
+    }
+    for (int v = 0; v < state.num_variants; v++) {
+        sg_destroy_pipeline(state.reduce_pip[v]);
+        gpu_scan_shutdown(&state.scan[v]);
+    }
+    gpu_timer_shutdown(&state.timer);
+    sg_shutdown();
+}
+
+// parse an item count with an optional k/m suffix (e.g. "16m")
+uint32_t parse_count(const char* str) {
+    char* end = nullptr;
+    unsigned long long count = strtoull(str, &end, 10);
+    if ((*end == 'k') || (*end == 'K')) {
+        count *= 1024;
+    } else if ((*end == 'm') || (*end == 'M')) {
+        count *= 1024 * 1024;
+    }
+    return (uint32_t)std::clamp(count, 1ull, 64ull * 1024 * 1024);
+}
+
+// options can be given on the command line or through environment variables:
+//   --count=N,N,...    REDUCE_COUNT        item counts to benchmark, k/m suffix allowed (default: 64k,256k,1m,4m,16m)
+//   --no-validate      REDUCE_NO_VALIDATE  skip the readback and CPU check
+void parse_args(int argc, char* argv[]) {
+    const char* counts = getenv("REDUCE_COUNT");
+    state.config.validate = getenv("REDUCE_NO_VALIDATE") == nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--count=", 8)) {
+            counts = argv[i] + 8;
+        } else if (0 == strcmp(argv[i], "--no-validate")) {
+            state.config.validate = false;
+        }
+    }
+    std::string list = counts ? counts : "64k,256k,1m,4m,16m";
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            state.config.counts.push_back(parse_count(list.substr(start, end - start).c_str()));
+        }
+        start = end + 1;
+    }
+    if (state.config.counts.empty()) {
+        state.config.counts.push_back(1024 * 1024);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    sapp_desc desc = {0};
+    desc.init_cb = init;
+    desc.frame_cb = frame;
+    desc.cleanup_cb = cleanup,
+    desc.width  = SCREEN_WIDTH,
+    desc.height = SCREEN_HEIGHT,
+    desc.window_title = "sokol cs subgroup reduce (GL4.3)",
+    desc.icon.sokol_default = true,
+    desc.logger.func = slog_func;
+    sapp_run(&desc);
+
+    return 0;
+}
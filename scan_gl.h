@@ -0,0 +1,196 @@
+#pragma once
+// GPU exclusive prefix sum over a storage buffer of uints.
+//
+// Each workgroup scans GPU_SCAN_BLOCK_SIZE items in shared memory and writes
+// its total into a block-sums buffer, which is scanned recursively and then
+// added back onto the blocks below it. gpu_scan_exclusive() only records
+// dispatches and must be called inside a compute pass, sokol-gfx issues the
+// storage buffer barriers between the levels. The block scan runs on
+// subgroup ops where the driver has them (see subgroup_gl.h).
+
+#include <cstdint>
+
+#include "subgroup_gl.h"
+
+constexpr uint32_t GPU_SCAN_THREADS = 256;
+constexpr uint32_t GPU_SCAN_ITEMS_PER_THREAD = 4;
+constexpr uint32_t GPU_SCAN_BLOCK_SIZE = GPU_SCAN_THREADS * GPU_SCAN_ITEMS_PER_THREAD;
+// 1024^4 items, more than any storage buffer can hold
+constexpr int GPU_SCAN_MAX_LEVELS = 4;
+
+struct gpu_scan_t {
+    sg_pipeline block_pip;
+    sg_pipeline add_pip;
+    // block sums of each level, level n+1 scans the sums of level n
+    sg_buffer sums[GPU_SCAN_MAX_LEVELS];
+    uint32_t max_items;
+    bool subgroups;
+};
+
+struct gpu_scan_params_t {
+    int32_t num_items;
+};
+
+inline uint32_t gpu_scan_num_blocks(uint32_t num_items) {
+    return (num_items + GPU_SCAN_BLOCK_SIZE - 1) / GPU_SCAN_BLOCK_SIZE;
+}
+
+inline sg_pipeline gpu_scan_make_pipeline(const char* label, const char* source) {
+    sg_shader_desc _shader_desc{};
+    _shader_desc.compute_func.source = source;
+    _shader_desc.uniform_blocks[0].stage = SG_SHADERSTAGE_COMPUTE;
+    _shader_desc.uniform_blocks[0].size = sizeof(gpu_scan_params_t);
+    _shader_desc.uniform_blocks[0].glsl_uniforms[0] = { .type = SG_UNIFORMTYPE_INT, .glsl_name = "num_items" };
+    for (int i = 0; i < 2; i++) {
+        _shader_desc.storage_buffers[i].stage = SG_SHADERSTAGE_COMPUTE;
+        _shader_desc.storage_buffers[i].readonly = false;
+        _shader_desc.storage_buffers[i].glsl_binding_n = (uint8_t)i;
+    }
+    _shader_desc.label = label;
+
+    sg_pipeline_desc _pipeline_desc{};
+    _pipeline_desc.compute = true;
+    _pipeline_desc.shader = sg_make_shader(&_shader_desc);
+    _pipeline_desc.label = label;
+    return sg_make_pipeline(&_pipeline_desc);
+}
+
+inline void gpu_scan_init(gpu_scan_t* s, uint32_t max_items, bool subgroups = gpu_subgroups_default()) {
+    *s = {};
+    s->max_items = max_items;
+    s->subgroups = subgroups;
+
+    // local exclusive scan of one block, the block total goes into block_sums
+    const std::string block_source = gpu_workgroup_source(R"(
+#version 430
+uniform int num_items;
+
+layout(std430, binding=0) buffer data_ssbo {
+  uint data[];
+};
+layout(std430, binding=1) buffer sums_ssbo {
+  uint block_sums[];
+};
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+
+void main() {
+  uint block = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+  uint lid = gl_LocalInvocationID.x;
+  uint base = block * 1024u + lid * 4u;
+
+  uint v[4];
+  uint sum = 0u;
+  for (uint i = 0u; i < 4u; i++) {
+    v[i] = (base + i < uint(num_items)) ? data[base + i] : 0u;
+    sum += v[i];
+  }
+
+  // exclusive scan of the per-thread sums
+  uint total;
+  uint prefix = wg_exclusive_add(sum, total);
+  for (uint i = 0u; i < 4u; i++) {
+    if (base + i < uint(num_items)) {
+      data[base + i] = prefix;
+    }
+    prefix += v[i];
+  }
+  if (lid == 0u) {
+    block_sums[block] = total;
+  }
+}
+)", subgroups, GPU_SCAN_THREADS);
+    s->block_pip = gpu_scan_make_pipeline(subgroups ? "scan-block-subgroup" : "scan-block", block_source.c_str());
+
+    // add the scanned block sums onto every item of the block
+    s->add_pip = gpu_scan_make_pipeline("scan-add", R"(
+#version 430
+uniform int num_items;
+
+layout(std430, binding=0) buffer data_ssbo {
+  uint data[];
+};
+layout(std430, binding=1) buffer sums_ssbo {
+  uint block_sums[];
+};
+
+layout(local_size_x=256, local_size_y=1, local_size_z=1) in;
+
+void main() {
+  uint block = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+  uint base = block * 1024u + gl_LocalInvocationID.x * 4u;
+  uint offset = block_sums[block];
+  for (uint i = 0u; i < 4u; i++) {
+    if (base + i < uint(num_items)) {
+      data[base + i] += offset;
+    }
+  }
+}
+)");
+
+    uint32_t num_items = max_items;
+    for (int level = 0; level < GPU_SCAN_MAX_LEVELS; level++) {
+        const uint32_t num_blocks = gpu_scan_num_blocks(num_items);
+        sg_buffer_desc _sg_buffer_desc{};
+        _sg_buffer_desc.usage.storage_buffer = true;
+        _sg_buffer_desc.size = sizeof(uint32_t) * num_blocks;
+        _sg_buffer_desc.label = "scan-block-sums";
+        s->sums[level] = sg_make_buffer(&_sg_buffer_desc);
+        if (num_blocks == 1) {
+            break;
+        }
+        num_items = num_blocks;
+    }
+}
+
+inline void gpu_scan_shutdown(gpu_scan_t* s) {
+    for (int level = 0; level < GPU_SCAN_MAX_LEVELS; level++) {
+        sg_destroy_buffer(s->sums[level]);
+    }
+    sg_destroy_pipeline(s->block_pip);
+    sg_destroy_pipeline(s->add_pip);
+}
+
+inline void gpu_scan_dispatch(sg_pipeline pip, sg_buffer data, sg_buffer sums, uint32_t num_items) {
+    // nothing to scan, and no groups to fold into y
+    if (num_items == 0) {
+        return;
+    }
+    const gpu_scan_params_t params = { (int32_t)num_items };
+    const uint32_t num_blocks = gpu_scan_num_blocks(num_items);
+    const uint32_t num_groups_x = num_blocks < 65535 ? num_blocks : 65535;
+
+    sg_bindings _bindings{};
+    _bindings.storage_buffers[0] = data;
+    _bindings.storage_buffers[1] = sums;
+    sg_apply_pipeline(pip);
+    sg_apply_bindings(&_bindings);
+    sg_apply_uniforms(0, SG_RANGE(params));
+    sg_dispatch((int)num_groups_x, (int)((num_blocks + num_groups_x - 1) / num_groups_x), 1);
+}
+
+// replace the first num_items uints in buf with their exclusive prefix sum
+inline void gpu_scan_exclusive(gpu_scan_t* s, sg_buffer buf, uint32_t num_items) {
+    SOKOL_ASSERT(num_items <= s->max_items);
+    sg_buffer data[GPU_SCAN_MAX_LEVELS];
+    uint32_t level_items[GPU_SCAN_MAX_LEVELS];
+    int num_levels = 0;
+
+    // scan down until a single block holds everything
+    data[0] = buf;
+    level_items[0] = num_items;
+    for (int level = 0; level < GPU_SCAN_MAX_LEVELS; level++) {
+        gpu_scan_dispatch(s->block_pip, data[level], s->sums[level], level_items[level]);
+        num_levels = level + 1;
+        const uint32_t num_blocks = gpu_scan_num_blocks(level_items[level]);
+        if ((num_blocks <= 1) || (level + 1 == GPU_SCAN_MAX_LEVELS)) {
+            break;
+        }
+        data[level + 1] = s->sums[level];
+        level_items[level + 1] = num_blocks;
+    }
+    // ...then propagate the block offsets back up
+    for (int level = num_levels - 2; level >= 0; level--) {
+        gpu_scan_dispatch(s->add_pip, data[level], s->sums[level], level_items[level]);
+    }
+}
@@ -0,0 +1,265 @@
+#define SOKOL_IMPL
+#define SOKOL_NO_ENTRY
+#define SOKOL_GLCORE
+#include "gl_ext.h"
+#include "sokol_app.h"
+#include "sokol_gfx.h"
+#include "sokol_glue.h"
+#include "sokol_log.h"
+#include "sokol_time.h"
+
+#include "gpu_timer_gl.h"
+#include "scan_gl.h"
+#include "radix_sort_gl.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr uint32_t SCREEN_WIDTH = 400;
+constexpr uint32_t SCREEN_HEIGHT = 300;
+
+constexpr int SORT_WARMUP_FRAMES = 10;
+constexpr int SORT_MEASURE_FRAMES = 100;
+
+// GLsort benchmarks radix_sort_gl.h: for every count, random keys are copied
+// into the sort buffers each frame and sorted, the GPU time of the sort is
+// averaged and the last result is checked against radix_sort_reference()
+struct {
+    struct {
+        std::vector<uint32_t> counts;
+        uint32_t key_bits;
+        bool validate;
+    } config;
+    size_t count_index;
+    int frame;
+    uint32_t num_items;
+    std::vector<uint32_t> src_keys;
+    std::vector<uint32_t> src_values;
+    sg_buffer src_keys_buf;
+    sg_buffer src_values_buf;
+    sg_buffer keys_buf;
+    sg_buffer values_buf;
+    radix_sort_t sorter;
+    sg_pass_action pass_action;
+    gpu_timer_t timer;
+} state;
+
+GLuint gl_buffer(sg_buffer buf) {
+    const sg_gl_buffer_info info = sg_gl_query_buffer_info(buf);
+    return info.buf[info.active_slot];
+}
+
+void copy_buffer(sg_buffer src, sg_buffer dst, size_t size) {
+    glBindBuffer(GL_COPY_READ_BUFFER, gl_buffer(src));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gl_buffer(dst));
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void read_buffer(sg_buffer buf, void* data, size_t size) {
+    glBindBuffer(GL_COPY_READ_BUFFER, gl_buffer(buf));
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)size, data);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void create_sort_buffers(uint32_t count) {
+    state.num_items = count;
+    state.frame = 0;
+
+    std::mt19937 rnd(count);
+    state.src_keys.resize(count);
+    state.src_values.resize(count);
+    const uint32_t key_mask = state.config.key_bits < 32 ? (1u << state.config.key_bits) - 1 : 0xFFFFFFFFu;
+    for (uint32_t i = 0; i < count; i++) {
+        state.src_keys[i] = rnd() & key_mask;
+        state.src_values[i] = i;
+    }
+
+    sg_buffer_desc _sg_buffer_desc{};
+    _sg_buffer_desc.usage.storage_buffer = true;
+    _sg_buffer_desc.data = { state.src_keys.data(), sizeof(uint32_t) * count };
+    _sg_buffer_desc.label = "sort-src-keys";
+    state.src_keys_buf = sg_make_buffer(&_sg_buffer_desc);
+    _sg_buffer_desc.data = { state.src_values.data(), sizeof(uint32_t) * count };
+    _sg_buffer_desc.label = "sort-src-values";
+    state.src_values_buf = sg_make_buffer(&_sg_buffer_desc);
+
+    _sg_buffer_desc.data = {};
+    _sg_buffer_desc.size = sizeof(uint32_t) * count;
+    _sg_buffer_desc.label = "sort-keys";
+    state.keys_buf = sg_make_buffer(&_sg_buffer_desc);
+    _sg_buffer_desc.label = "sort-values";
+    state.values_buf = sg_make_buffer(&_sg_buffer_desc);
+}
+
+void destroy_sort_buffers() {
+    sg_destroy_buffer(state.src_keys_buf);
+    sg_destroy_buffer(state.src_values_buf);
+    sg_destroy_buffer(state.keys_buf);
+    sg_destroy_buffer(state.values_buf);
+}
+
+// compare the last GPU result with the CPU reference, returns the CPU time in ms
+bool validate(double* cpu_ms) {
+    std::vector<uint32_t> gpu_keys(state.num_items);
+    std::vector<uint32_t> gpu_values(state.num_items);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    read_buffer(state.keys_buf, gpu_keys.data(), sizeof(uint32_t) * state.num_items);
+    read_buffer(state.values_buf, gpu_values.data(), sizeof(uint32_t) * state.num_items);
+
+    std::vector<uint32_t> keys = state.src_keys;
+    std::vector<uint32_t> values = state.src_values;
+    const uint64_t start = stm_now();
+    radix_sort_reference(keys, values, state.config.key_bits);
+    *cpu_ms = stm_ms(stm_since(start));
+
+    return (keys == gpu_keys) && (values == gpu_values);
+}
+
+void init() {
+    sg_desc _sg_desc{};
+    _sg_desc.environment = sglue_environment();
+    _sg_desc.logger.func = slog_func;
+    sg_setup(&_sg_desc);
+    stm_setup();
+
+    state.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.0f, 0.0f, 0.0f, 1.0f} };
+
+    const uint32_t max_count = *std::max_element(state.config.counts.begin(), state.config.counts.end());
+    radix_sort_init(&state.sorter, max_count);
+    gpu_timer_init(&state.timer);
+    create_sort_buffers(state.config.counts[0]);
+}
+
+void frame() {
+    gpu_timer_begin_frame(&state.timer);
+
+    // the sort is in place, restore the unsorted input first
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    copy_buffer(state.src_keys_buf, state.keys_buf, sizeof(uint32_t) * state.num_items);
+    copy_buffer(state.src_values_buf, state.values_buf, sizeof(uint32_t) * state.num_items);
+    gpu_timer_stamp(&state.timer, "copy");
+
+    sg_pass _sort_pass = { .compute=true, .label="sort-pass" };
+    sg_begin_pass(&_sort_pass);
+    radix_sort(&state.sorter, state.keys_buf, state.values_buf, state.num_items, state.config.key_bits);
+    sg_end_pass();
+    gpu_timer_stamp(&state.timer, "sort");
+
+    sg_pass _pass = { .action=state.pass_action, .swapchain=sglue_swapchain() };
+    sg_begin_pass(&_pass);
+    sg_end_pass();
+    sg_commit();
+
+    state.frame++;
+    if (state.frame == SORT_WARMUP_FRAMES) {
+        gpu_timer_reset(&state.timer);
+    }
+    if ((state.frame < SORT_WARMUP_FRAMES) || (state.timer.num_samples < SORT_MEASURE_FRAMES)) {
+        return;
+    }
+
+    const double sort_ms = gpu_timer_ms(&state.timer, "sort");
+    printf("sort %10u keys (%u bit): gpu %.3fms | %8.1f Mkeys/s",
+        state.num_items,
+        state.config.key_bits,
+        sort_ms,
+        state.num_items / (sort_ms * 1.0e3));
+    if (state.config.validate) {
+        double cpu_ms = 0.0;
+        const bool ok = validate(&cpu_ms);
+        printf(" | cpu reference %.3fms | %8.1f Mkeys/s | %s",
+            cpu_ms,
+            state.num_items / (cpu_ms * 1.0e3),
+            ok ? "ok" : "MISMATCH");
+    }
+    printf("\n");
+    fflush(stdout);
+
+    destroy_sort_buffers();
+    state.count_index++;
+    if (state.count_index >= state.config.counts.size()) {
+        sapp_request_quit();
+        return;
+    }
+    create_sort_buffers(state.config.counts[state.count_index]);
+    gpu_timer_reset(&state.timer);
+}
+
+void cleanup() {
+    if (state.count_index < state.config.counts.size()) {
+        destroy_sort_buffers();
+    }
+    radix_sort_shutdown(&state.sorter);
+    gpu_timer_shutdown(&state.timer);
+    sg_shutdown();
+}
+
+// parse a key count with an optional k/m suffix (e.g. "16m")
+uint32_t parse_count(const char* str) {
+    char* end = nullptr;
+    unsigned long long count = strtoull(str, &end, 10);
+    if ((*end == 'k') || (*end == 'K')) {
+        count *= 1024;
+    } else if ((*end == 'm') || (*end == 'M')) {
+        count *= 1024 * 1024;
+    }
+    return (uint32_t)std::clamp(count, 1ull, 64ull * 1024 * 1024);
+}
+
+// options can be given on the command line or through environment variables:
+//   --count=N,N,...    SORT_COUNT        key counts to benchmark, k/m suffix allowed (default: 64k,256k,1m,4m,16m)
+//   --bits=N           SORT_BITS         sort by the lowest N key bits (default: 32)
+//   --no-validate      SORT_NO_VALIDATE  skip the readback and CPU reference check
+void parse_args(int argc, char* argv[]) {
+    const char* counts = getenv("SORT_COUNT");
+    const char* bits = getenv("SORT_BITS");
+    state.config.validate = getenv("SORT_NO_VALIDATE") == nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strncmp(argv[i], "--count=", 8)) {
+            counts = argv[i] + 8;
+        } else if (0 == strncmp(argv[i], "--bits=", 7)) {
+            bits = argv[i] + 7;
+        } else if (0 == strcmp(argv[i], "--no-validate")) {
+            state.config.validate = false;
+        }
+    }
+    state.config.key_bits = bits ? (uint32_t)std::clamp(atoi(bits), 1, 32) : 32;
+    std::string list = counts ? counts : "64k,256k,1m,4m,16m";
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            state.config.counts.push_back(parse_count(list.substr(start, end - start).c_str()));
+        }
+        start = end + 1;
+    }
+    if (state.config.counts.empty()) {
+        state.config.counts.push_back(1024 * 1024);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    parse_args(argc, argv);
+
+    sapp_desc desc = {0};
+    desc.init_cb = init;
+    desc.frame_cb = frame;
+    desc.cleanup_cb = cleanup,
+    desc.width  = SCREEN_WIDTH,
+    desc.height = SCREEN_HEIGHT,
+    desc.window_title = "sokol cs radix sort (GL4.3)",
+    desc.icon.sokol_default = true,
+    desc.logger.func = slog_func;
+    sapp_run(&desc);
+
+    return 0;
+}
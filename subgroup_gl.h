@@ -0,0 +1,137 @@
+#pragma once
+// Workgroup-wide reductions and scans for GLSL compute shaders.
+//
+// gpu_workgroup_glsl() returns GLSL that defines
+//   vec4 wg_add(vec4 v), vec4 wg_min(vec4 v), vec4 wg_max(vec4 v)
+//   uint wg_add_uint(uint v)
+//   uint wg_exclusive_add(uint v, out uint total)
+// for a 1D workgroup of group_size invocations (a power of two). Every
+// invocation of the workgroup gets the result, so the calls must be made in
+// uniform control flow. With subgroups each subgroup reduces in registers
+// (GL_KHR_shader_subgroup) and only one value per subgroup goes through
+// shared memory, without them a shared memory tree does the whole job. The
+// text contains #extension directives and has to follow #version directly.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// subgroup paths are used when the driver has them, GPU_SUBGROUPS=0 forces
+// the shared memory fallback
+inline bool gpu_subgroups_default() {
+    const char* env = getenv("GPU_SUBGROUPS");
+    if (env && (0 == strcmp(env, "0"))) {
+        return false;
+    }
+    return sg_query_features().compute_subgroups;
+}
+
+inline std::string gpu_workgroup_glsl(bool subgroups, uint32_t group_size) {
+    const std::string n = std::to_string(group_size);
+    std::string src;
+    if (subgroups) {
+        src = R"(
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+shared vec4 wg_scratch_f[)" + n + R"(];
+shared uint wg_scratch_u[)" + n + R"(];
+)";
+    } else {
+        src = R"(
+shared vec4 wg_scratch_f[)" + n + R"(];
+shared uint wg_scratch_u[)" + n + R"(];
+)";
+    }
+
+    // type, name, subgroup op, combine of two values, scratch array
+    struct op_t { const char* type; const char* name; const char* subgroup_op; const char* combine; const char* scratch; };
+    const op_t ops[] = {
+        { "vec4", "wg_add", "subgroupAdd", "a + b", "wg_scratch_f" },
+        { "vec4", "wg_min", "subgroupMin", "min(a, b)", "wg_scratch_f" },
+        { "vec4", "wg_max", "subgroupMax", "max(a, b)", "wg_scratch_f" },
+        { "uint", "wg_add_uint", "subgroupAdd", "a + b", "wg_scratch_u" },
+    };
+    for (const op_t& op : ops) {
+        const std::string type = op.type;
+        const std::string scratch = op.scratch;
+        src += type + " " + op.name + "_combine(" + type + " a, " + type + " b) { return " + op.combine + "; }\n";
+        if (subgroups) {
+            // the leading barrier keeps the scratch of a previous call alive
+            // until every invocation has read it
+            src += type + " " + op.name + "(" + type + " v) {\n"
+                "  v = " + op.subgroup_op + "(v);\n"
+                "  barrier();\n"
+                "  if (subgroupElect()) {\n"
+                "    " + scratch + "[gl_SubgroupID] = v;\n"
+                "  }\n"
+                "  barrier();\n"
+                "  " + type + " r = " + scratch + "[0];\n"
+                "  for (uint i = 1u; i < gl_NumSubgroups; i++) {\n"
+                "    r = " + op.name + "_combine(r, " + scratch + "[i]);\n"
+                "  }\n"
+                "  return r;\n"
+                "}\n";
+        } else {
+            src += type + " " + op.name + "(" + type + " v) {\n"
+                "  uint t = gl_LocalInvocationIndex;\n"
+                "  barrier();\n"
+                "  " + scratch + "[t] = v;\n"
+                "  for (uint stride = " + std::to_string(group_size / 2) + "u; stride > 0u; stride >>= 1) {\n"
+                "    barrier();\n"
+                "    if (t < stride) {\n"
+                "      " + scratch + "[t] = " + op.name + "_combine(" + scratch + "[t], " + scratch + "[t + stride]);\n"
+                "    }\n"
+                "  }\n"
+                "  barrier();\n"
+                "  return " + scratch + "[0];\n"
+                "}\n";
+        }
+    }
+
+    if (subgroups) {
+        src += R"(
+uint wg_exclusive_add(uint v, out uint total) {
+  uint inclusive = subgroupInclusiveAdd(v);
+  barrier();
+  if (gl_SubgroupInvocationID == gl_SubgroupSize - 1u) {
+    wg_scratch_u[gl_SubgroupID] = inclusive;
+  }
+  barrier();
+  uint offset = 0u;
+  total = 0u;
+  for (uint i = 0u; i < gl_NumSubgroups; i++) {
+    uint s = wg_scratch_u[i];
+    offset += (i < gl_SubgroupID) ? s : 0u;
+    total += s;
+  }
+  return offset + inclusive - v;
+}
+)";
+    } else {
+        src += R"(
+uint wg_exclusive_add(uint v, out uint total) {
+  uint t = gl_LocalInvocationIndex;
+  barrier();
+  wg_scratch_u[t] = v;
+  for (uint offset = 1u; offset < )" + n + R"(u; offset <<= 1u) {
+    barrier();
+    uint s = (t >= offset) ? wg_scratch_u[t - offset] : 0u;
+    barrier();
+    wg_scratch_u[t] += s;
+  }
+  barrier();
+  total = wg_scratch_u[)" + std::to_string(group_size - 1) + R"(];
+  return wg_scratch_u[t] - v;
+}
+)";
+    }
+    return src;
+}
+
+// source with the workgroup functions inserted right behind its #version line
+inline std::string gpu_workgroup_source(const std::string& source, bool subgroups, uint32_t group_size) {
+    const size_t version_end = source.find('\n', source.find("#version"));
+    return source.substr(0, version_end + 1) + gpu_workgroup_glsl(subgroups, group_size) + source.substr(version_end + 1);
+}